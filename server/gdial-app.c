@@ -20,16 +20,18 @@
 #include <string.h>
 #include <gio/gio.h>
 #include <stdlib.h>
-#include <libxml/tree.h>
 
 #include "gdial-config.h"
 #include "gdial-util.h"
 #include "gdial-plat-app.h"
 #include "gdial-app.h"
+#include "gdial-xml.h"
 
 
 typedef struct _GDialAppPrivate {
   gpointer state_cb_data;
+  /* error the platform pushed along with the last state */
+  GDialAppError state_error;
   GHashTable *additional_dial_data;
   gchar *payload;
 } GDialAppPrivate;
@@ -49,6 +51,29 @@ enum {
 
 static  GList *application_instances_ = NULL;
 
+/*
+ * Serialized GET /apps/<app> response, kept per app name so that it outlives
+ * the short-lived instances created for stopped apps. @generation is bumped
+ * whenever anything the response is built from changes.
+ */
+typedef struct {
+  guint generation;
+  /*
+   * the stored additional dial_data as last seen, every new instance reads
+   * it again and only a different one bumps @generation
+   */
+  gchar *dial_data;
+  guint cached_generation;
+  GDialAppState cached_state;
+  const gchar *cached_dial_ver;
+  const gchar *cached_xmlns;
+  GBytes *cached_response;
+} GDialAppResponseCache;
+
+static GHashTable *response_caches_ = NULL;
+static guint64 response_cache_hits_ = 0;
+static guint64 response_cache_misses_ = 0;
+
 static guint gdial_app_signals[N_SIGNALS] =  {0};
 
 G_DEFINE_TYPE_WITH_PRIVATE(GDialApp, gdial_app, G_TYPE_OBJECT)
@@ -63,6 +88,54 @@ static gint GCompareFunc_match_instance_instance_id(gconstpointer a, gconstpoint
   return (app->instance_id == *((gint *)b)) ? 0 : 1;
 }
 
+static void gdial_app_response_cache_free(gpointer data) {
+  GDialAppResponseCache *cache = (GDialAppResponseCache *)data;
+  if (cache->cached_response) g_bytes_unref(cache->cached_response);
+  g_free(cache->dial_data);
+  g_free(cache);
+}
+
+static GDialAppResponseCache *gdial_app_response_cache_get(const gchar *app_name) {
+  if (response_caches_ == NULL) {
+    response_caches_ = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, gdial_app_response_cache_free);
+  }
+  GDialAppResponseCache *cache = (GDialAppResponseCache *)g_hash_table_lookup(response_caches_, app_name);
+  if (cache == NULL) {
+    cache = g_new0(GDialAppResponseCache, 1);
+    g_hash_table_insert(response_caches_, g_strdup(app_name), cache);
+  }
+  return cache;
+}
+
+static void gdial_app_invalidate_response(GDialApp *app) {
+  if (app->name) gdial_app_response_cache_get(app->name)->generation++;
+}
+
+/*
+ * @dial_data is what the app's dial_data file holds now, NULL when there is none
+ */
+static void gdial_app_dial_data_changed(GDialApp *app, const gchar *dial_data) {
+  GDialAppResponseCache *cache = gdial_app_response_cache_get(app->name);
+  if (g_strcmp0(cache->dial_data, dial_data) == 0) return;
+  g_free(cache->dial_data);
+  cache->dial_data = g_strdup(dial_data);
+  cache->generation++;
+}
+
+static void gdial_app_set_state(GDialApp *app, GDialAppState state) {
+  if (app->state != state) {
+    app->state = state;
+    gdial_app_invalidate_response(app);
+  }
+}
+
+static GDialAppError gdial_app_query_plat_state(GDialApp *app) {
+  GDialAppState state = app->state;
+  GDialAppError app_err = gdial_plat_application_state(app->name, app->instance_id, &state);
+  gdial_app_set_state(app, state);
+  return app_err;
+}
+
 static void gdial_app_dispose(GObject *gobject) {
   GDialApp *app = GDIAL_APP(gobject);
   GDialAppPrivate *priv = gdial_app_get_instance_private(GDIAL_APP(gobject));
@@ -91,7 +164,22 @@ static void gdial_plat_app_state_cb(gint instance_id, GDialAppState state, void
   GDialApp *app = gdial_app_find_instance_by_instance_id(instance_id);
   g_return_if_fail (app != NULL);
   GDialAppPrivate *priv = gdial_app_get_instance_private(app);
+  /* a handler may drop the last reference of a request that failed */
+  g_object_ref(app);
+  g_signal_emit(app, gdial_app_signals[SIGNAL_STATE_CHANGED], 0, app, priv->state_cb_data);
+  g_object_unref(app);
+}
+
+static void gdial_plat_app_state_changed_cb(const gchar *app_name, GDialAppState state, GDialAppError error, gpointer user_data) {
+  GDialApp *app = gdial_app_find_instance_by_name(app_name);
+  if (app == NULL) return;
+  GDialAppPrivate *priv = gdial_app_get_instance_private(app);
+  priv->state_error = error;
+  gdial_app_set_state(app, state);
+  /* a handler may drop the last reference of a request that failed */
+  g_object_ref(app);
   g_signal_emit(app, gdial_app_signals[SIGNAL_STATE_CHANGED], 0, app, priv->state_cb_data);
+  g_object_unref(app);
 }
 
 static void gdial_app_get_property (GObject *object, guint property_id, GValue *value, GParamSpec *pspec) {
@@ -121,7 +209,7 @@ static void gdial_app_set_property (GObject *object, guint property_id, const GV
       self->name = g_value_dup_string(value);
       break;
     case PROP_STATE:
-      self->state = g_value_get_uint(value);
+      gdial_app_set_state(self, g_value_get_uint(value));
       break;
     case PROP_INSTANCE_ID:
       self->instance_id = g_value_get_int(value);
@@ -173,12 +261,14 @@ static void gdial_app_class_init (GDialAppClass *klass) {
 
   gdial_plat_init(g_main_context_default());
   gdial_plat_application_set_state_cb(gdial_plat_app_state_cb, NULL);
+  gdial_plat_register_state_changed_cb(gdial_plat_app_state_changed_cb, NULL);
 }
 
 static void gdial_app_init(GDialApp *self) {
   GDialAppPrivate *priv = gdial_app_get_instance_private(self);
   priv->payload = NULL;
   priv->state_cb_data = NULL;
+  priv->state_error = GDIAL_APP_ERROR_NONE;
   application_instances_ = g_list_prepend(application_instances_, self);
 }
 
@@ -189,19 +279,20 @@ GDialApp *gdial_app_new(const gchar *app_name) {
   return app;
 };
 
-GDialAppError gdial_app_start(GDialApp *app, const gchar *payload, const gchar *query, const gchar *additional_data_url, gpointer state_cb_data) {
+GDialAppError gdial_app_start(GDialApp *app, GDialLaunchRequest *launch_request, gpointer state_cb_data) {
   g_return_val_if_fail (GDIAL_IS_APP (app), GDIAL_APP_ERROR_BAD_REQUEST);
 
   GDialAppPrivate *priv = gdial_app_get_instance_private(app);
   priv->state_cb_data = state_cb_data;
-  GDialAppError app_err = gdial_plat_application_start(app->name, payload, query, additional_data_url, &app->instance_id);
+  priv->state_error = GDIAL_APP_ERROR_NONE;
+  GDialAppError app_err = gdial_plat_application_start(app->name, launch_request, &app->instance_id);
   if (app_err == GDIAL_APP_ERROR_NONE || app->instance_id != GDIAL_APP_INSTANCE_NONE) {
     gdial_plat_application_state_async(app->name, app->instance_id, app);
-    app_err = gdial_plat_application_state(app->name, app->instance_id, &app->state);
+    app_err = gdial_app_query_plat_state(app);
     g_warn_if_fail(app->state == GDIAL_APP_STATE_RUNNING);
   }
   else {
-    app->state = GDIAL_APP_STATE_STOPPED;
+    gdial_app_set_state(app, GDIAL_APP_STATE_STOPPED);
   }
   return app_err;
 }
@@ -211,9 +302,12 @@ GDialAppError gdial_app_hide(GDialApp *app) {
   g_return_val_if_fail (app->name != NULL, GDIAL_APP_ERROR_BAD_REQUEST);
   g_return_val_if_fail (app->instance_id != GDIAL_APP_INSTANCE_NONE, GDIAL_APP_ERROR_BAD_REQUEST);
 
+  GDialAppPrivate *priv = gdial_app_get_instance_private(app);
+  /* errors pushed for an earlier request do not apply to this one */
+  priv->state_error = GDIAL_APP_ERROR_NONE;
   GDialAppError app_err =  gdial_plat_application_hide(app->name, app->instance_id);
   if (app_err == GDIAL_APP_ERROR_NONE) {
-    app_err = gdial_plat_application_state(app->name, app->instance_id, &app->state);
+    app_err = gdial_app_query_plat_state(app);
   }
   else {
   }
@@ -227,7 +321,7 @@ GDialAppError gdial_app_resume(GDialApp *app) {
 
   GDialAppError app_err =  gdial_plat_application_resume(app->name, app->instance_id);
   if (app_err == GDIAL_APP_ERROR_NONE) {
-    app_err = gdial_plat_application_state(app->name, app->instance_id, &app->state);
+    app_err = gdial_app_query_plat_state(app);
   }
   else {
   }
@@ -237,9 +331,11 @@ GDialAppError gdial_app_resume(GDialApp *app) {
 GDialAppError gdial_app_stop(GDialApp *app) {
   g_return_val_if_fail (GDIAL_IS_APP (app), GDIAL_APP_ERROR_INTERNAL);
   g_return_val_if_fail (app->name != NULL, GDIAL_APP_ERROR_INTERNAL);
+  GDialAppPrivate *priv = gdial_app_get_instance_private(app);
+  priv->state_error = GDIAL_APP_ERROR_NONE;
   GDialAppError app_err =  gdial_plat_application_stop(app->name, app->instance_id);
   if (app_err == GDIAL_APP_ERROR_NONE) {
-    app_err = gdial_plat_application_state(app->name, app->instance_id, &app->state);
+    app_err = gdial_app_query_plat_state(app);
   }
   else {
   }
@@ -251,14 +347,14 @@ GDialAppError gdial_app_state(GDialApp *app) {
   g_return_val_if_fail (app->name != NULL, GDIAL_APP_ERROR_INTERNAL);
 
   if (app->instance_id == GDIAL_APP_INSTANCE_NONE) {
-    app->state = GDIAL_APP_STATE_STOPPED;
+    gdial_app_set_state(app, GDIAL_APP_STATE_STOPPED);
     return GDIAL_APP_ERROR_NONE;
   }
 
   GDialAppState app_state = GDIAL_APP_STATE_MAX;
   GDialAppError app_err = gdial_plat_application_state(app->name, app->instance_id, &app_state);
   if (app_err == GDIAL_APP_ERROR_NONE) {
-    app->state = app_state;
+    gdial_app_set_state(app, app_state);
   }
   return app_err;
 }
@@ -274,6 +370,12 @@ const gchar *gdial_app_state_to_string(GDialAppState state) {
   }
 }
 
+GDialAppError gdial_app_get_state_error(GDialApp *app) {
+  g_return_val_if_fail(GDIAL_IS_APP(app), GDIAL_APP_ERROR_INTERNAL);
+  GDialAppPrivate *priv = gdial_app_get_instance_private(app);
+  return priv->state_error;
+}
+
 void gdial_app_force_shutdown(GDialApp *app) {
   g_warn_if_reached();
 }
@@ -313,12 +415,14 @@ void gdial_app_set_additional_dial_data(GDialApp *app, GHashTable *additional_di
     g_hash_table_destroy(priv->additional_dial_data);
   }
   priv->additional_dial_data = gdial_util_str_str_hashtable_dup(additional_dial_data);
+  gdial_app_invalidate_response(app);
   /* cache the additional_dial_data */
   size_t length = 0;
   gchar *query_str = gdial_util_str_str_hashtable_to_string(additional_dial_data, NULL, TRUE, &length);
   if (query_str) {
     gdial_app_write_additional_dial_data(app->name, query_str, length);
   }
+  gdial_app_dial_data_changed(app, query_str);
   g_free(query_str);
 }
 
@@ -343,9 +447,11 @@ void gdial_app_refresh_additional_dial_data(GDialApp *app) {
       /* we are ready to convert to hashtable*/
       gdial_util_str_str_hashtable_from_string(data, length, priv->additional_dial_data);
       g_print("gdial_app_refresh_additional_dial_data [%s]\r\n", data);
-      g_free(data);
     }
   }
+  /* the file may have been written since the cached response was built */
+  gdial_app_dial_data_changed(app, data);
+  g_free(data);
 }
 
 void gdial_app_clear_additional_dial_data(GDialApp *app) {
@@ -355,6 +461,8 @@ void gdial_app_clear_additional_dial_data(GDialApp *app) {
   if(priv->additional_dial_data) {
     g_hash_table_remove_all(priv->additional_dial_data);
   }
+  gdial_app_invalidate_response(app);
+  gdial_app_dial_data_changed(app, NULL);
   gdial_app_remove_additional_dial_data_file(app->name);
 }
 
@@ -474,35 +582,69 @@ gchar * gdial_app_state_response_new(GDialApp *app, const gchar *dial_ver, const
   g_return_val_if_fail(dial_ver && xmlns && len, NULL);
   GDialAppPrivate *priv = gdial_app_get_instance_private(app);
 
-  xmlDocPtr xdoc = NULL;
-  xdoc = xmlNewDoc(BAD_CAST "1.0");
-  xmlNodePtr nservice = xmlNewNode(NULL, BAD_CAST "service");
-  xmlDocSetRootElement(xdoc, nservice); {
-    xmlNewProp(nservice, BAD_CAST "xmlns", BAD_CAST xmlns);
-    xmlNewProp(nservice, BAD_CAST "dialVer", BAD_CAST dial_ver);
-  }
-  xmlNewChild(nservice, NULL, BAD_CAST "name", BAD_CAST app->name);
-  xmlNodePtr noptions = xmlNewChild(nservice, NULL, BAD_CAST "options", BAD_CAST NULL); {
-    xmlNewProp(noptions, BAD_CAST "allowStop", BAD_CAST "true");
-  }
-  xmlNewChild(nservice, NULL, BAD_CAST "state", BAD_CAST gdial_app_state_to_string(app->state));
+  GDialXmlWriter writer;
+  gdial_xml_writer_init(&writer, GDIAL_APP_STATE_RESPONSE_SIZE_HINT);
+  gdial_xml_writer_start_element(&writer, "service");
+  gdial_xml_writer_attribute(&writer, "xmlns", xmlns);
+  gdial_xml_writer_attribute(&writer, "dialVer", dial_ver);
+  gdial_xml_writer_element(&writer, "name", app->name);
+  gdial_xml_writer_start_element(&writer, "options");
+  gdial_xml_writer_attribute(&writer, "allowStop", "true");
+  gdial_xml_writer_end_element(&writer);
+  gdial_xml_writer_element(&writer, "state", gdial_app_state_to_string(app->state));
   if (app->state != GDIAL_APP_STATE_STOPPED) {
-    xmlNodePtr nlink  = xmlNewChild(nservice, NULL, BAD_CAST "link", BAD_CAST NULL);
-    xmlNewProp(nlink, BAD_CAST "rel", BAD_CAST "run");
-    xmlNewProp(nlink, BAD_CAST "href", BAD_CAST "run");
+    gdial_xml_writer_start_element(&writer, "link");
+    gdial_xml_writer_attribute(&writer, "rel", "run");
+    gdial_xml_writer_attribute(&writer, "href", "run");
+    gdial_xml_writer_end_element(&writer);
   }
-  xmlNodePtr naddtnl  = xmlNewChild(nservice, NULL, BAD_CAST "additionalData", BAD_CAST NULL); {
+  gdial_xml_writer_start_element(&writer, "additionalData");
+  if (priv->additional_dial_data) {
     GHashTableIter iter;
     gpointer key, value;
     g_hash_table_iter_init(&iter, priv->additional_dial_data);
     while (g_hash_table_iter_next(&iter, &key, &value)) {
-      xmlNewChild(naddtnl, NULL, BAD_CAST (gchar*)key, BAD_CAST (gchar*)value);
+      /* values are escaped, but a key that is no XML name cannot be represented */
+      if (!gdial_xml_is_valid_name((const gchar *)key)) {
+        g_printerr("skipping dial_data key [%s] of [%s]\r\n", (const gchar *)key, app->name);
+        continue;
+      }
+      gdial_xml_writer_element(&writer, (const gchar *)key, (const gchar *)value);
     }
   }
-  xmlChar *app_state_response = NULL;
-  xmlDocDumpMemory(xdoc, &app_state_response, len);
-  xmlFreeDoc(xdoc);
-  return (gchar *)app_state_response;
+  gdial_xml_writer_end_element(&writer);
+
+  gsize length = 0;
+  gchar *app_state_response = gdial_xml_writer_finish(&writer, &length);
+  *len = (int)length;
+  return app_state_response;
+}
+
+GBytes *gdial_app_state_response_ref(GDialApp *app, const gchar *dial_ver, const gchar *xmlns) {
+  g_return_val_if_fail(app && app->name && strlen(app->name), NULL);
+  GDialAppResponseCache *cache = gdial_app_response_cache_get(app->name);
+  if (cache->cached_response && cache->cached_generation == cache->generation && cache->cached_state == app->state &&
+      cache->cached_dial_ver == dial_ver && cache->cached_xmlns == xmlns) {
+    response_cache_hits_++;
+    return g_bytes_ref(cache->cached_response);
+  }
+
+  response_cache_misses_++;
+  int len = 0;
+  gchar *response = gdial_app_state_response_new(app, dial_ver, xmlns, &len);
+  g_return_val_if_fail(response != NULL, NULL);
+  if (cache->cached_response) g_bytes_unref(cache->cached_response);
+  cache->cached_response = g_bytes_new_take(response, len);
+  cache->cached_generation = cache->generation;
+  cache->cached_state = app->state;
+  cache->cached_dial_ver = dial_ver;
+  cache->cached_xmlns = xmlns;
+  return g_bytes_ref(cache->cached_response);
+}
+
+void gdial_app_dump_stats(void) {
+  g_print("app: state response cache hits=%" G_GUINT64_FORMAT " misses=%" G_GUINT64_FORMAT "\r\n",
+    response_cache_hits_, response_cache_misses_);
 }
 
 GDialAppError gdial_system_app(GHashTable *query)
@@ -0,0 +1,150 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <libsoup/soup.h>
+
+#include "gdial-config.h"
+#include "gdial-arena.h"
+
+#define GDIAL_ARENA_ALIGN (2 * sizeof(gpointer))
+#define gdial_arena_align(offset) (((offset) + GDIAL_ARENA_ALIGN - 1) & ~(GDIAL_ARENA_ALIGN - 1))
+
+typedef struct _GDialArenaChunk {
+  struct _GDialArenaChunk *next;
+  gchar *data;
+  gsize size;
+  gsize used;
+} GDialArenaChunk;
+
+struct _GDialArena {
+  GDialArenaChunk *current;
+  /* its data is the tail of the arena allocation */
+  GDialArenaChunk first;
+};
+
+GDialArena *gdial_arena_new(gsize size) {
+  GDialArena *arena = g_malloc(gdial_arena_align(sizeof(GDialArena)) + size);
+  arena->first.next = NULL;
+  arena->first.data = (gchar *)arena + gdial_arena_align(sizeof(GDialArena));
+  arena->first.size = size;
+  arena->first.used = 0;
+  arena->current = &arena->first;
+  return arena;
+}
+
+void gdial_arena_free(GDialArena *arena) {
+  if (arena == NULL) return;
+  GDialArenaChunk *chunk = arena->current;
+  while (chunk != &arena->first) {
+    GDialArenaChunk *next = chunk->next;
+    g_free(chunk);
+    chunk = next;
+  }
+  g_free(arena);
+}
+
+static gsize gdial_arena_available(GDialArena *arena) {
+  GDialArenaChunk *chunk = arena->current;
+  gsize offset = gdial_arena_align(chunk->used);
+  return offset < chunk->size ? chunk->size - offset : 0;
+}
+
+gpointer gdial_arena_alloc(GDialArena *arena, gsize size) {
+  g_return_val_if_fail(arena != NULL, NULL);
+
+  GDialArenaChunk *chunk = arena->current;
+  gsize offset = gdial_arena_align(chunk->used);
+  if (offset + size > chunk->size) {
+    /* chunks double, and an oversized request gets a chunk of its own size */
+    gsize chunk_size = MAX(chunk->size * 2, size);
+    GDialArenaChunk *next = g_malloc(gdial_arena_align(sizeof(GDialArenaChunk)) + chunk_size);
+    next->next = chunk;
+    next->data = (gchar *)next + gdial_arena_align(sizeof(GDialArenaChunk));
+    next->size = chunk_size;
+    next->used = 0;
+    arena->current = chunk = next;
+    offset = 0;
+  }
+  chunk->used = offset + size;
+  return chunk->data + offset;
+}
+
+gchar *gdial_arena_strndup(GDialArena *arena, const gchar *str, gsize len) {
+  if (str == NULL) return NULL;
+  gchar *dup = gdial_arena_alloc(arena, len + 1);
+  memcpy(dup, str, len);
+  dup[len] = '\0';
+  return dup;
+}
+
+gchar *gdial_arena_printf(GDialArena *arena, const gchar *format, ...) {
+  g_return_val_if_fail(arena != NULL && format != NULL, NULL);
+
+  /*
+   * format straight into the free tail of the current chunk, and only
+   * format a second time if it did not fit
+   */
+  va_list args;
+  gsize available = gdial_arena_available(arena);
+  GDialArenaChunk *chunk = arena->current;
+  gchar *tail = chunk->data + gdial_arena_align(chunk->used);
+  va_start(args, format);
+  gint len = g_vsnprintf(available ? tail : NULL, available, format, args);
+  va_end(args);
+  g_return_val_if_fail(len >= 0, NULL);
+
+  if ((gsize)len < available) {
+    return gdial_arena_alloc(arena, len + 1);
+  }
+  gchar *str = gdial_arena_alloc(arena, len + 1);
+  va_start(args, format);
+  g_vsnprintf(str, len + 1, format, args);
+  va_end(args);
+  return str;
+}
+
+gchar *gdial_arena_uri_encode(GDialArena *arena, const gchar *str, GDialUriEncodeMode mode) {
+  if (str == NULL) return NULL;
+  gsize len = strlen(str);
+  gsize encoded_len = 0;
+  gdial_uri_scan(str, len, mode, &encoded_len);
+  gchar *encoded = gdial_arena_alloc(arena, encoded_len + 1);
+  *gdial_uri_encode_to(encoded, str, len, mode) = '\0';
+  return encoded;
+}
+
+static GQuark gdial_arena_quark(void) {
+  static GQuark quark = 0;
+  if (G_UNLIKELY(quark == 0)) quark = g_quark_from_static_string("gdial-arena");
+  return quark;
+}
+
+GDialArena *gdial_arena_for_message(SoupMessage *msg) {
+  g_return_val_if_fail(SOUP_IS_MESSAGE(msg), NULL);
+  GDialArena *arena = g_object_get_qdata(G_OBJECT(msg), gdial_arena_quark());
+  if (arena == NULL) {
+    arena = gdial_arena_new(GDIAL_REST_ARENA_SIZE);
+    g_object_set_qdata_full(G_OBJECT(msg), gdial_arena_quark(), arena, (GDestroyNotify)gdial_arena_free);
+  }
+  return arena;
+}
@@ -0,0 +1,52 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GDIAL_ARENA_H_
+#define GDIAL_ARENA_H_
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <libsoup/soup.h>
+#include "gdial-uri.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Bump-pointer arena for short-lived strings. Allocations are never freed
+ * on their own, the whole arena goes at once. The first chunk is part of
+ * the arena's own allocation, further chunks are only added on overflow.
+ * An arena is not thread-safe.
+ */
+typedef struct _GDialArena GDialArena;
+
+GDialArena *gdial_arena_new(gsize size);
+void gdial_arena_free(GDialArena *arena);
+gpointer gdial_arena_alloc(GDialArena *arena, gsize size);
+gchar *gdial_arena_strndup(GDialArena *arena, const gchar *str, gsize len);
+gchar *gdial_arena_printf(GDialArena *arena, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+gchar *gdial_arena_uri_encode(GDialArena *arena, const gchar *str, GDialUriEncodeMode mode);
+
+/*
+ * The arena of @msg, created on first use and released together with
+ * the message once soup is done with it.
+ */
+GDialArena *gdial_arena_for_message(SoupMessage *msg);
+
+G_END_DECLS
+#endif
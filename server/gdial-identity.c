@@ -0,0 +1,78 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glib.h>
+#include "gdial-identity.h"
+
+static GDialDeviceIdentity *current_identity_ = NULL;
+/*
+ * readers between loading current_identity_ and taking their reference;
+ * a publisher waits for it to drain before dropping the old snapshot.
+ */
+static gint identity_readers_ = 0;
+
+GDialDeviceIdentity *gdial_device_identity_new(const gchar *friendly_name, const gchar *manufacturer, const gchar *model_name, const gchar *uuid) {
+  GDialDeviceIdentity *identity = g_new0(GDialDeviceIdentity, 1);
+  identity->ref_count = 1;
+  identity->friendly_name = g_strdup(friendly_name);
+  identity->manufacturer = g_strdup(manufacturer);
+  identity->model_name = g_strdup(model_name);
+  identity->uuid = g_strdup(uuid);
+  return identity;
+}
+
+GDialDeviceIdentity *gdial_device_identity_ref(GDialDeviceIdentity *identity) {
+  g_return_val_if_fail(identity != NULL, NULL);
+  g_atomic_int_inc(&identity->ref_count);
+  return identity;
+}
+
+void gdial_device_identity_unref(GDialDeviceIdentity *identity) {
+  if (identity == NULL) return;
+  if (!g_atomic_int_dec_and_test(&identity->ref_count)) return;
+  g_free(identity->friendly_name);
+  g_free(identity->manufacturer);
+  g_free(identity->model_name);
+  g_free(identity->uuid);
+  g_free(identity);
+}
+
+GDialDeviceIdentity *gdial_device_identity_get() {
+  g_atomic_int_inc(&identity_readers_);
+  GDialDeviceIdentity *identity = g_atomic_pointer_get(&current_identity_);
+  if (identity) g_atomic_int_inc(&identity->ref_count);
+  g_atomic_int_add(&identity_readers_, -1);
+  return identity;
+}
+
+void gdial_device_identity_publish(GDialDeviceIdentity *identity) {
+  GDialDeviceIdentity *old_identity = g_atomic_pointer_get(&current_identity_);
+  while (!g_atomic_pointer_compare_and_exchange(&current_identity_, old_identity, identity)) {
+    old_identity = g_atomic_pointer_get(&current_identity_);
+  }
+  /*
+   * a reader that loaded the old pointer is still inside its few
+   * instructions of gdial_device_identity_get(); any later reader sees
+   * the new snapshot.
+   */
+  while (g_atomic_int_get(&identity_readers_) != 0) {
+    g_thread_yield();
+  }
+  gdial_device_identity_unref(old_identity);
+}
@@ -0,0 +1,58 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GDIAL_IDENTITY_H_
+#define GDIAL_IDENTITY_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Immutable, refcounted snapshot of what the device advertises about itself
+ * (interface addresses are per interface and live in gdial-ssdp.c).
+ * A change publishes a new snapshot; readers on any thread take a reference
+ * to the current one without locking and keep using it until they drop it.
+ */
+typedef struct {
+  /*< private >*/
+  gint ref_count;
+  /*< public >*/
+  gchar *friendly_name;
+  gchar *manufacturer;
+  gchar *model_name;
+  gchar *uuid;
+} GDialDeviceIdentity;
+
+GDialDeviceIdentity *gdial_device_identity_new(const gchar *friendly_name, const gchar *manufacturer, const gchar *model_name, const gchar *uuid);
+GDialDeviceIdentity *gdial_device_identity_ref(GDialDeviceIdentity *identity);
+void gdial_device_identity_unref(GDialDeviceIdentity *identity);
+
+/*
+ * Returns a new reference to the current snapshot, or NULL before the first
+ * gdial_device_identity_publish().
+ */
+GDialDeviceIdentity *gdial_device_identity_get();
+/*
+ * Replace the current snapshot, taking ownership of @identity (may be NULL).
+ */
+void gdial_device_identity_publish(GDialDeviceIdentity *identity);
+
+G_END_DECLS
+#endif
@@ -0,0 +1,255 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <glib.h>
+#include <glib-unix.h>
+#include <gio/gio.h>
+
+#include "gdial-netlink.h"
+
+typedef struct {
+  struct in_addr address;
+  gboolean secondary;
+} NetlinkAddress;
+
+typedef struct {
+  /* NetlinkAddress in kernel order */
+  GArray *addresses;
+  /* filled by a running dump, replaces addresses once it is done */
+  GArray *dump_addresses;
+  struct in_addr selected;
+  gboolean has_selected;
+} NetlinkIface;
+
+struct _GDialNetlinkMonitor {
+  int fd;
+  gchar **iface_names;
+  /* one per iface_names entry */
+  NetlinkIface *ifaces;
+  GSource *source;
+  GDialNetlinkAddressFunc func;
+  gpointer user_data;
+  guint32 dump_seq;
+  gboolean dump_running;
+  gboolean dump_pending;
+};
+
+static void netlink_addresses_update(GArray *addresses, gboolean added, const NetlinkAddress *address) {
+  for (guint i = 0; i < addresses->len; i++) {
+    NetlinkAddress *entry = &g_array_index(addresses, NetlinkAddress, i);
+    if (entry->address.s_addr != address->address.s_addr) continue;
+    /* a promoted secondary comes back as a new primary, in place */
+    if (added) *entry = *address;
+    else g_array_remove_index(addresses, i);
+    return;
+  }
+  if (added) g_array_append_val(addresses, *address);
+}
+
+/*
+ * The current address stays as long as the interface has it, so that a
+ * second address coming or going does not move the listeners. Otherwise
+ * the first primary address in kernel order wins, a secondary one only
+ * when there is no primary.
+ */
+static void netlink_monitor_select(GDialNetlinkMonitor *monitor, guint index) {
+  NetlinkIface *iface = &monitor->ifaces[index];
+  const NetlinkAddress *pick = NULL;
+  for (guint i = 0; i < iface->addresses->len; i++) {
+    const NetlinkAddress *address = &g_array_index(iface->addresses, NetlinkAddress, i);
+    if (iface->has_selected && address->address.s_addr == iface->selected.s_addr) {
+      pick = address;
+      break;
+    }
+    if (pick == NULL || (pick->secondary && !address->secondary)) pick = address;
+  }
+  if (pick && iface->has_selected && pick->address.s_addr == iface->selected.s_addr) return;
+  if (pick == NULL && !iface->has_selected) return;
+
+  gchar ipv4_address[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, pick ? &pick->address : &iface->selected, ipv4_address, sizeof(ipv4_address));
+  iface->has_selected = (pick != NULL);
+  if (pick) iface->selected = pick->address;
+  monitor->func(pick != NULL, monitor->iface_names[index], ipv4_address, monitor->user_data);
+}
+
+static void netlink_monitor_handle_addr(GDialNetlinkMonitor *monitor, const struct nlmsghdr *nlh) {
+  const struct ifaddrmsg *ifa = NLMSG_DATA(nlh);
+  if (ifa->ifa_family != AF_INET) return;
+
+  const gchar *label = NULL;
+  const void *local = NULL;
+  const void *address = NULL;
+  int length = IFA_PAYLOAD(nlh);
+  for (const struct rtattr *rta = IFA_RTA(ifa); RTA_OK(rta, length); rta = RTA_NEXT(rta, length)) {
+    switch (rta->rta_type) {
+      case IFA_LABEL: label = RTA_DATA(rta); break;
+      case IFA_LOCAL: local = RTA_DATA(rta); break;
+      case IFA_ADDRESS: address = RTA_DATA(rta); break;
+    }
+  }
+  /* IFA_ADDRESS is the peer on point-to-point links, IFA_LOCAL is ours */
+  if (local) address = local;
+  if (label == NULL || address == NULL) return;
+  guint index = 0;
+  while (monitor->iface_names[index] && strcmp(monitor->iface_names[index], label) != 0) index++;
+  if (monitor->iface_names[index] == NULL) return;
+
+  NetlinkIface *iface = &monitor->ifaces[index];
+  NetlinkAddress entry;
+  memcpy(&entry.address, address, sizeof(entry.address));
+  entry.secondary = (ifa->ifa_flags & IFA_F_SECONDARY) != 0;
+  const gboolean added = (nlh->nlmsg_type == RTM_NEWADDR);
+  if (monitor->dump_running && nlh->nlmsg_seq == monitor->dump_seq) {
+    /* a dump reply, the pick is made once the whole dump is in */
+    netlink_addresses_update(iface->dump_addresses, added, &entry);
+    return;
+  }
+  /* events that race with a dump also go into its result */
+  if (monitor->dump_running) netlink_addresses_update(iface->dump_addresses, added, &entry);
+  netlink_addresses_update(iface->addresses, added, &entry);
+  netlink_monitor_select(monitor, index);
+}
+
+/*
+ * Ask the kernel for every IPv4 address; the replies are RTM_NEWADDR
+ * messages and go through the same handler as the events. Only one dump
+ * can run per socket; an overrun during one resends it once it is done,
+ * since events that raced with the dump may have been dropped.
+ */
+static void netlink_monitor_request_dump(GDialNetlinkMonitor *monitor) {
+  if (monitor->dump_running) {
+    monitor->dump_pending = TRUE;
+    return;
+  }
+  struct {
+    struct nlmsghdr nlh;
+    struct ifaddrmsg ifa;
+  } request = {0};
+  request.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(request.ifa));
+  request.nlh.nlmsg_type = RTM_GETADDR;
+  request.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  request.nlh.nlmsg_seq = ++monitor->dump_seq;
+  request.ifa.ifa_family = AF_INET;
+  struct sockaddr_nl kernel = {0};
+  kernel.nl_family = AF_NETLINK;
+  if (sendto(monitor->fd, &request, request.nlh.nlmsg_len, 0, (struct sockaddr *)&kernel, sizeof(kernel)) < 0) {
+    g_printerr("gdial netlink: address dump request failed, %s\r\n", g_strerror(errno));
+    return;
+  }
+  monitor->dump_running = TRUE;
+  monitor->dump_pending = FALSE;
+}
+
+static void netlink_monitor_dump_done(GDialNetlinkMonitor *monitor, const struct nlmsghdr *nlh) {
+  if (!monitor->dump_running || nlh->nlmsg_seq != monitor->dump_seq) return;
+  monitor->dump_running = FALSE;
+  /*
+   * a complete dump is the whole truth, addresses whose removal was
+   * dropped go away here and only interfaces whose pick changed are
+   * reported; a failed or overrun one is thrown away
+   */
+  const gboolean complete = nlh->nlmsg_type == NLMSG_DONE && !monitor->dump_pending;
+  for (guint i = 0; monitor->iface_names[i]; i++) {
+    NetlinkIface *iface = &monitor->ifaces[i];
+    if (complete) {
+      GArray *addresses = iface->addresses;
+      iface->addresses = iface->dump_addresses;
+      iface->dump_addresses = addresses;
+    }
+    g_array_set_size(iface->dump_addresses, 0);
+    if (complete) netlink_monitor_select(monitor, i);
+  }
+  if (monitor->dump_pending) netlink_monitor_request_dump(monitor);
+}
+
+static gboolean netlink_monitor_recv_cb(gint fd, GIOCondition condition, gpointer user_data) {
+  GDialNetlinkMonitor *monitor = (GDialNetlinkMonitor *)user_data;
+  guint32 buffer[8192 / sizeof(guint32)];
+  ssize_t length;
+  while ((length = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    for (const struct nlmsghdr *nlh = (const struct nlmsghdr *)buffer; NLMSG_OK(nlh, length); nlh = NLMSG_NEXT(nlh, length)) {
+      if (nlh->nlmsg_type == RTM_NEWADDR || nlh->nlmsg_type == RTM_DELADDR) {
+        netlink_monitor_handle_addr(monitor, nlh);
+      }
+      else if (nlh->nlmsg_type == NLMSG_DONE || nlh->nlmsg_type == NLMSG_ERROR) {
+        netlink_monitor_dump_done(monitor, nlh);
+      }
+    }
+  }
+  if (length < 0 && errno == ENOBUFS) {
+    /* events were dropped, re-read the current addresses */
+    g_printerr("gdial netlink: receive buffer overrun, resyncing addresses\r\n");
+    netlink_monitor_request_dump(monitor);
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+GDialNetlinkMonitor *gdial_netlink_monitor_new(GMainContext *context, const gchar * const *iface_names, GDialNetlinkAddressFunc func, gpointer user_data, GError **error) {
+  g_return_val_if_fail(iface_names != NULL && func != NULL, NULL);
+
+  int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+  struct sockaddr_nl local = {0};
+  local.nl_family = AF_NETLINK;
+  local.nl_groups = RTMGRP_IPV4_IFADDR;
+  if (fd < 0 || bind(fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+    int saved_errno = errno;
+    g_set_error(error, G_IO_ERROR, g_io_error_from_errno(saved_errno), "gdial netlink: %s", g_strerror(saved_errno));
+    if (fd >= 0) close(fd);
+    return NULL;
+  }
+
+  GDialNetlinkMonitor *monitor = g_new0(GDialNetlinkMonitor, 1);
+  monitor->fd = fd;
+  monitor->iface_names = g_strdupv((gchar **)iface_names);
+  monitor->ifaces = g_new0(NetlinkIface, g_strv_length(monitor->iface_names));
+  for (guint i = 0; monitor->iface_names[i]; i++) {
+    monitor->ifaces[i].addresses = g_array_new(FALSE, FALSE, sizeof(NetlinkAddress));
+    monitor->ifaces[i].dump_addresses = g_array_new(FALSE, FALSE, sizeof(NetlinkAddress));
+  }
+  monitor->func = func;
+  monitor->user_data = user_data;
+  monitor->source = g_unix_fd_source_new(fd, G_IO_IN);
+  g_source_set_callback(monitor->source, (GSourceFunc)netlink_monitor_recv_cb, monitor, NULL);
+  g_source_attach(monitor->source, context);
+  /* the pick needs every address, not just the ones that change from now on */
+  netlink_monitor_request_dump(monitor);
+  return monitor;
+}
+
+void gdial_netlink_monitor_free(GDialNetlinkMonitor *monitor) {
+  if (monitor == NULL) return;
+  g_source_destroy(monitor->source);
+  g_source_unref(monitor->source);
+  close(monitor->fd);
+  for (guint i = 0; monitor->iface_names[i]; i++) {
+    g_array_free(monitor->ifaces[i].addresses, TRUE);
+    g_array_free(monitor->ifaces[i].dump_addresses, TRUE);
+  }
+  g_free(monitor->ifaces);
+  g_strfreev(monitor->iface_names);
+  g_free(monitor);
+}
@@ -0,0 +1,46 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GDIAL_NETLINK_H_
+#define GDIAL_NETLINK_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * rtnetlink listener for IPv4 address changes on the interfaces in
+ * @iface_names. Names are matched against the address label, so aliases
+ * such as "eth0:0" work.
+ *
+ * @func is called with the address picked for an interface whenever the
+ * pick changes: the current address is kept while the interface still has
+ * it, otherwise the first primary (not IFA_F_SECONDARY) one is taken.
+ * @added is FALSE once the interface has no IPv4 address left. The
+ * addresses are read once at start and again after a receive overrun;
+ * both only report interfaces whose pick changed.
+ */
+typedef struct _GDialNetlinkMonitor GDialNetlinkMonitor;
+typedef void (*GDialNetlinkAddressFunc)(gboolean added, const gchar *iface_name, const gchar *ipv4_address, gpointer user_data);
+
+GDialNetlinkMonitor *gdial_netlink_monitor_new(GMainContext *context, const gchar * const *iface_names, GDialNetlinkAddressFunc func, gpointer user_data, GError **error);
+void gdial_netlink_monitor_free(GDialNetlinkMonitor *monitor);
+
+G_END_DECLS
+#endif
@@ -40,11 +40,47 @@
 
 #define IFNAME_OPTION 'I'
 #define IFNAME_OPTION_LONG "network-interface"
-#define IFNAME_DESCRIPTION "network interface to be used"
+#define IFNAME_DESCRIPTION "network interface to be used, or a comma separated list of interfaces"
 
 #define APP_LIST_OPTION 'A'
 #define APP_LIST_OPTION_LONG "app-list"
-#define APP_LIST_DESCRIPTION "A preset list of apps to support"
+#define APP_LIST_DESCRIPTION "A preset list of apps to support, JSON of /apps/<name>/dial_data to origins or {origins, launch}"
+#define THROTTLE_RATE_OPTION 'T'
+#define THROTTLE_RATE_OPTION_LONG "throttle-rate"
+#define THROTTLE_RATE_DESCRIPTION "Requests per second admitted per client, 0 disables throttling"
+
+#define THROTTLE_BURST_OPTION 'B'
+#define THROTTLE_BURST_OPTION_LONG "throttle-burst"
+#define THROTTLE_BURST_DESCRIPTION "Requests a client may send back to back before throttling"
+
+#define THROTTLE_MAX_DELAY_OPTION 'D'
+#define THROTTLE_MAX_DELAY_OPTION_LONG "throttle-max-delay"
+#define THROTTLE_MAX_DELAY_DESCRIPTION "Longest delay in ms before a throttled request is rejected"
+
+#define NATIVE_SSDP_OPTION 'N'
+#define NATIVE_SSDP_OPTION_LONG "native-ssdp"
+#define NATIVE_SSDP_DESCRIPTION "Answer SSDP searches with the built-in rate limited responder instead of gssdp"
+
+#define NO_SSDP_FILTER_OPTION 'K'
+#define NO_SSDP_FILTER_OPTION_LONG "no-ssdp-filter"
+#define NO_SSDP_FILTER_DESCRIPTION "Do not attach the kernel M-SEARCH filter to the --native-ssdp sockets, for comparison runs"
+
+#define SSDP_NOTIFY_INTERVAL_OPTION 'S'
+#define SSDP_NOTIFY_INTERVAL_OPTION_LONG "ssdp-notify-interval"
+#define SSDP_NOTIFY_INTERVAL_DESCRIPTION "Steady-state ssdp:alive interval in seconds with --native-ssdp"
+
+#define DISCOVERY_PRIORITY_OPTION 'P'
+#define DISCOVERY_PRIORITY_OPTION_LONG "discovery-priority"
+#define DISCOVERY_PRIORITY_DESCRIPTION "Nice value of the SSDP and dd.xml thread, negative values need CAP_SYS_NICE"
+
+#define APP_STATE_STALENESS_OPTION 'C'
+#define APP_STATE_STALENESS_OPTION_LONG "app-state-staleness"
+#define APP_STATE_STALENESS_DESCRIPTION "Milliseconds a cached app state is trusted before a lookup refreshes it"
+
+#define APP_STATE_WAIT_OPTION 'W'
+#define APP_STATE_WAIT_OPTION_LONG "app-state-wait"
+#define APP_STATE_WAIT_DESCRIPTION "Milliseconds a launch, stop or hide request waits for the platform to confirm the new state, 0 answers at once"
+
 typedef struct {
   gchar *friendly_name;
   gchar *manufacturer;
@@ -52,6 +88,15 @@ typedef struct {
   gchar *uuid;
   gchar *iface_name;
   gchar *app_list;
+  gint throttle_rate;
+  gint throttle_burst;
+  gint throttle_max_delay;
+  gboolean native_ssdp;
+  gboolean no_ssdp_filter;
+  gint ssdp_notify_interval;
+  gint discovery_priority;
+  gint app_state_staleness;
+  gint app_state_wait;
 } GDialOptions;
 
 #endif
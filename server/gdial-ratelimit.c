@@ -0,0 +1,163 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glib.h>
+#include "gdial-ratelimit.h"
+
+/*
+ * tokens are kept in micro-tokens so that refill is pure integer math
+ */
+#define GDIAL_RATE_LIMITER_TOKEN G_GINT64_CONSTANT(1000000)
+
+typedef struct {
+  /* position in the limiter's lru, most recently used at the head */
+  GList link;
+  guint32 key;
+  gint64 tokens;
+  gint64 last_us;
+} GDialTokenBucket;
+
+struct _GDialRateLimiter {
+  guint rate;
+  guint burst;
+  guint max_keys;
+  GHashTable *buckets;
+  GQueue lru;
+  gint64 last_sweep_us;
+};
+
+GDialRateLimiter *gdial_rate_limiter_new(guint rate, guint burst, guint max_keys) {
+  GDialRateLimiter *limiter = g_new0(GDialRateLimiter, 1);
+  limiter->buckets = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+  limiter->max_keys = max_keys;
+  g_queue_init(&limiter->lru);
+  gdial_rate_limiter_set(limiter, rate, burst);
+  return limiter;
+}
+
+void gdial_rate_limiter_set(GDialRateLimiter *limiter, guint rate, guint burst) {
+  g_return_if_fail(limiter != NULL);
+  limiter->rate = rate;
+  limiter->burst = burst ? burst : 1;
+  /* buckets refill to the new capacity on their next use */
+  g_hash_table_remove_all(limiter->buckets);
+  g_queue_init(&limiter->lru);
+  limiter->last_sweep_us = 0;
+}
+
+static void gdial_token_bucket_refill(GDialRateLimiter *limiter, GDialTokenBucket *bucket, gint64 now_us) {
+  const gint64 capacity = limiter->burst * GDIAL_RATE_LIMITER_TOKEN;
+  if (now_us > bucket->last_us) {
+    bucket->tokens += (now_us - bucket->last_us) * limiter->rate;
+    bucket->last_us = now_us;
+  }
+  if (bucket->tokens > capacity) bucket->tokens = capacity;
+}
+
+static void gdial_rate_limiter_remove(GDialRateLimiter *limiter, GDialTokenBucket *bucket) {
+  g_queue_unlink(&limiter->lru, &bucket->link);
+  g_hash_table_remove(limiter->buckets, GUINT_TO_POINTER(bucket->key));
+}
+
+static void gdial_rate_limiter_sweep(GDialRateLimiter *limiter, gint64 now_us) {
+  /*
+   * drop buckets that have refilled completely, they carry no state. A
+   * bucket needs burst / rate seconds to refill, sweeping more often than
+   * that finds next to nothing.
+   */
+  const gint64 capacity = limiter->burst * GDIAL_RATE_LIMITER_TOKEN;
+  if (limiter->last_sweep_us && now_us - limiter->last_sweep_us < capacity / limiter->rate) return;
+  limiter->last_sweep_us = now_us;
+  GList *link = limiter->lru.head;
+  while (link) {
+    GDialTokenBucket *bucket = (GDialTokenBucket *)link->data;
+    link = link->next;
+    gdial_token_bucket_refill(limiter, bucket, now_us);
+    if (bucket->tokens >= capacity) {
+      gdial_rate_limiter_remove(limiter, bucket);
+    }
+  }
+}
+
+gint64 gdial_rate_limiter_acquire(GDialRateLimiter *limiter, guint32 key, gint64 now_us, gint64 max_wait_us) {
+  g_return_val_if_fail(limiter != NULL, 0);
+  if (limiter->rate == 0) return 0;
+
+  GDialTokenBucket *bucket = g_hash_table_lookup(limiter->buckets, GUINT_TO_POINTER(key));
+  if (bucket == NULL) {
+    if (limiter->max_keys && g_hash_table_size(limiter->buckets) >= limiter->max_keys) {
+      gdial_rate_limiter_sweep(limiter, now_us);
+      /* still full, the least recently used key starts over */
+      while (g_hash_table_size(limiter->buckets) >= limiter->max_keys) {
+        gdial_rate_limiter_remove(limiter, (GDialTokenBucket *)limiter->lru.tail->data);
+      }
+    }
+    bucket = g_new(GDialTokenBucket, 1);
+    bucket->link.data = bucket;
+    bucket->link.prev = bucket->link.next = NULL;
+    bucket->key = key;
+    bucket->tokens = limiter->burst * GDIAL_RATE_LIMITER_TOKEN;
+    bucket->last_us = now_us;
+    g_hash_table_insert(limiter->buckets, GUINT_TO_POINTER(key), bucket);
+    g_queue_push_head_link(&limiter->lru, &bucket->link);
+  }
+  else {
+    gdial_token_bucket_refill(limiter, bucket, now_us);
+    g_queue_unlink(&limiter->lru, &bucket->link);
+    g_queue_push_head_link(&limiter->lru, &bucket->link);
+  }
+
+  if (bucket->tokens >= GDIAL_RATE_LIMITER_TOKEN) {
+    bucket->tokens -= GDIAL_RATE_LIMITER_TOKEN;
+    return 0;
+  }
+
+  /*
+   * the token is borrowed from the future; tokens go negative so that
+   * later requests from the same key queue up behind this one.
+   */
+  const gint64 deficit = GDIAL_RATE_LIMITER_TOKEN - bucket->tokens;
+  const gint64 wait_us = (deficit + limiter->rate - 1) / limiter->rate;
+  if (wait_us > max_wait_us) {
+    return GDIAL_RATE_LIMITER_REJECT;
+  }
+  bucket->tokens -= GDIAL_RATE_LIMITER_TOKEN;
+  return wait_us;
+}
+
+guint gdial_rate_limiter_size(GDialRateLimiter *limiter) {
+  g_return_val_if_fail(limiter != NULL, 0);
+  return g_hash_table_size(limiter->buckets);
+}
+
+void gdial_rate_limiter_free(GDialRateLimiter *limiter) {
+  if (limiter == NULL) return;
+  g_hash_table_destroy(limiter->buckets);
+  g_free(limiter);
+}
+
+guint32 gdial_rate_limiter_key_from_bytes(const guint8 *bytes, gsize length) {
+  /* FNV-1a, an IPv4 address maps to a unique key in practice */
+  guint32 key = 2166136261u;
+  while (length--) {
+    key ^= *bytes++;
+    key *= 16777619u;
+  }
+  return key;
+}
@@ -0,0 +1,52 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GDIAL_RATELIMIT_H_
+#define GDIAL_RATELIMIT_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Keyed token buckets. Each key (e.g. a client IPv4 address) owns a bucket
+ * of @burst tokens refilled at @rate tokens per second. At most @max_keys
+ * (0 for no limit) keys are tracked; past that, refilled buckets are swept
+ * and then the least recently used key is forgotten.
+ */
+typedef struct _GDialRateLimiter GDialRateLimiter;
+
+#define GDIAL_RATE_LIMITER_REJECT (-1)
+
+GDialRateLimiter *gdial_rate_limiter_new(guint rate, guint burst, guint max_keys);
+void gdial_rate_limiter_set(GDialRateLimiter *limiter, guint rate, guint burst);
+/*
+ * Take one token for @key at time @now_us (monotonic).
+ * Returns 0 if admitted immediately, the number of microseconds the caller must
+ * wait before the token becomes valid, or GDIAL_RATE_LIMITER_REJECT if that wait
+ * would exceed @max_wait_us (no token is taken in that case).
+ */
+gint64 gdial_rate_limiter_acquire(GDialRateLimiter *limiter, guint32 key, gint64 now_us, gint64 max_wait_us);
+guint gdial_rate_limiter_size(GDialRateLimiter *limiter);
+void gdial_rate_limiter_free(GDialRateLimiter *limiter);
+
+guint32 gdial_rate_limiter_key_from_bytes(const guint8 *bytes, gsize length);
+
+G_END_DECLS
+#endif
@@ -21,6 +21,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
 #include <sys/socket.h>
 
 #include <glib.h>
@@ -29,11 +30,16 @@
 
 #include "gdial-rest.h"
 #include "gdial-util.h"
+#include "gdial-arena.h"
 #include "gdial-debug.h"
+#include "gdial-trie.h"
+#include "gdial-timer.h"
+#include "gdial-xml.h"
 
 #include "gdial-plat-util.h"
 #include "gdial-plat-dev.h"
 #include "gdial-plat-app.h"
+#include "gdial-launch.h"
 #include "gdial-rest-builder.h"
 
 typedef struct _GDialAppRegistry {
@@ -42,12 +48,43 @@ typedef struct _GDialAppRegistry {
   gboolean is_singleton;
   GList *allowed_origins;
   GList *app_prefixes;
+  /* allowed_origins compiled for suffix matching */
+  GDialTrie *allowed_origins_index;
+  gboolean allow_any_origin;
+  /* how long launch/stop/hide requests wait for the platform, 0 to not wait */
+  guint state_wait_ms;
 } GDialAppRegistry;
 
+/*
+ * Cached origin decision for one (app registry, Origin header) pair
+ */
+typedef struct {
+  GList link;
+  GDialAppRegistry *app_registry;
+  guint hash;
+  gchar *origin;
+  gboolean is_allowed;
+  /* Access-Control-Allow-Origin value for successful responses, NULL to omit */
+  gchar *allow_origin;
+} GDialOriginCacheEntry;
+
 typedef struct _GDialRestServerPrivate {
-  GList *registered_apps;
-  SoupServer *soup_instance;
+  /* app name -> GDialAppRegistry, owns the registries */
+  GHashTable *registered_apps;
+  /* app prefix -> GDialAppRegistry */
+  GDialTrie *registered_app_prefixes;
+  /* GDialOriginCacheEntry set, most recently used at the head of origin_lru */
+  GHashTable *origin_cache;
+  GQueue origin_lru;
+  /* one per interface, all of them serve the same apps */
+  GPtrArray *soup_instances;
   SoupServer *local_soup_instance;
+  /* the server whose request is being dispatched, a paused one is resumed on it */
+  SoupServer *dispatch_server;
+  gboolean enabled;
+  /* paused requests waiting for a state confirmation, and their timeouts */
+  GQueue state_waiters;
+  GDialTimerWheel *timer_wheel;
 } GDialRestServerPrivate;
 
 enum {
@@ -126,11 +163,10 @@ static void gdial_soup_message_set_http_error(SoupMessage *msg, guint state_code
   }\
 }
 
-#define gdial_soup_message_headers_replace_va(hdrs, name, format, ...) \
+#define gdial_soup_message_headers_replace_va(msg, name, format, ...) \
 {\
-  gchar *value = g_strdup_printf(format, __VA_ARGS__); \
-  soup_message_headers_replace(hdrs, name, value); \
-  g_free(value);\
+  soup_message_headers_replace(msg->response_headers, name, \
+    gdial_arena_printf(gdial_arena_for_message(msg), format, __VA_ARGS__)); \
 }
 
 #define gdial_soup_message_headers_replace_va2(hdrs, name, format, ...) \
@@ -150,15 +186,44 @@ static void gdial_soup_message_set_http_error(SoupMessage *msg, guint state_code
   g_string_free(value_buf, FALSE); \
 }
 
-static GList *gdial_rest_server_registered_apps_remove_and_free(GList *registered_apps, GList *found) {
-  GDialAppRegistry *app_registry = (GDialAppRegistry *)found->data;
-  registered_apps = g_list_remove_link(registered_apps, found);
+static void gdial_rest_server_app_registry_free(gpointer data) {
+  GDialAppRegistry *app_registry = (GDialAppRegistry *)data;
   g_free(app_registry->name);
   g_list_free_full(app_registry->allowed_origins, g_free);
   g_list_free_full(app_registry->app_prefixes, g_free);
+  gdial_trie_free(app_registry->allowed_origins_index);
   free(app_registry);
-  g_list_free(found);
-  return registered_apps;
+}
+
+static guint gdial_origin_cache_entry_hash(gconstpointer key) {
+  return ((const GDialOriginCacheEntry *)key)->hash;
+}
+
+static gboolean gdial_origin_cache_entry_equal(gconstpointer a, gconstpointer b) {
+  const GDialOriginCacheEntry *entry_a = (const GDialOriginCacheEntry *)a;
+  const GDialOriginCacheEntry *entry_b = (const GDialOriginCacheEntry *)b;
+  return entry_a->app_registry == entry_b->app_registry && strcmp(entry_a->origin, entry_b->origin) == 0;
+}
+
+static void gdial_origin_cache_entry_free(gpointer data) {
+  GDialOriginCacheEntry *entry = (GDialOriginCacheEntry *)data;
+  g_free(entry->origin);
+  g_free(entry->allow_origin);
+  g_free(entry);
+}
+
+static void gdial_rest_server_origin_cache_clear(GDialRestServerPrivate *priv) {
+  /* decisions refer to registries by pointer, drop them whenever the registry set changes */
+  g_hash_table_remove_all(priv->origin_cache);
+  g_queue_init(&priv->origin_lru);
+}
+
+static void gdial_rest_server_index_app_prefixes(GDialRestServerPrivate *priv, GDialAppRegistry *app_registry) {
+  GList *app_prefixes = app_registry->app_prefixes;
+  while (app_prefixes) {
+    gdial_trie_insert(priv->registered_app_prefixes, (const gchar *)app_prefixes->data, app_registry);
+    app_prefixes = app_prefixes->next;
+  }
 }
 
 GDIAL_STATIC gboolean gdial_rest_server_should_relaunch_app(GDialApp *app, const gchar *payload) {
@@ -188,70 +253,81 @@ GDIAL_STATIC gboolean gdial_rest_server_should_relaunch_app(GDialApp *app, const
   return TRUE;
 }
 
-static gint GCompareFunc_match_registry_app_name(gconstpointer a, gconstpointer b) {
-  GDialAppRegistry *app_registry = (GDialAppRegistry *)a;
-  int is_matched = 0;
-  /* match by prefix first */
-  GList *app_prefixes = app_registry->app_prefixes;
-  while (app_prefixes) {
-    gchar *app_prefix = (gchar *)app_prefixes->data;
-    if (GDIAL_STR_STARTS_WITH(b, app_prefix)) {
-      is_matched = 1;
-      break;
-    }
-    app_prefixes = app_prefixes->next;
-  }
-  /* match by exact name */
-  if (!is_matched) is_matched = (g_strcmp0(app_registry->name, b) == 0);
-  return is_matched ? 0 : 1;
-}
-
+/*
+ * An app name resolves to the registry of that exact name, otherwise to the
+ * registry owning the longest app prefix the name starts with.
+ */
 GDIAL_STATIC GDialAppRegistry *gdial_rest_server_find_app_registry(GDialRestServer *self, const gchar *app_name) {
   g_return_val_if_fail(self != NULL && app_name != NULL, FALSE);
   GDialRestServerPrivate *priv = gdial_rest_server_get_instance_private(self);
-  GList *found = g_list_find_custom(priv->registered_apps, app_name, GCompareFunc_match_registry_app_name);
-  if (found) {
-    return (GDialAppRegistry *)found->data;
+  GDialAppRegistry *app_registry = (GDialAppRegistry *)g_hash_table_lookup(priv->registered_apps, app_name);
+  if (app_registry == NULL) {
+    app_registry = (GDialAppRegistry *)gdial_trie_lookup_prefix(priv->registered_app_prefixes, app_name);
   }
-  return NULL;
+  return app_registry;
 }
 
-GDIAL_STATIC gboolean gdial_rest_server_is_allowed_origin(GDialRestServer *self, const gchar *header_origin, const gchar *app_name) {
-  if (self == NULL) return FALSE;
+/*
+ * Only origins with a web scheme are subject to the allowed_origins list, same
+ * schemes soup_uri_new() would report as http, https or file.
+ */
+static gboolean gdial_rest_server_origin_has_web_scheme(const gchar *origin) {
+  const gchar *p = origin;
+  while (g_ascii_isspace(*p)) p++;
+  const gchar *scheme = p;
+  while (g_ascii_isalnum(*p) || *p == '+' || *p == '-' || *p == '.') p++;
+  if (*p != ':') return FALSE;
+  const gsize len = p - scheme;
+  return (len == 4 && g_ascii_strncasecmp(scheme, "http", 4) == 0) ||
+         (len == 5 && g_ascii_strncasecmp(scheme, "https", 5) == 0) ||
+         (len == 4 && g_ascii_strncasecmp(scheme, "file", 4) == 0);
+}
+
+static gboolean gdial_rest_server_registry_allows_origin(GDialAppRegistry *app_registry, const gchar *header_origin) {
   if (header_origin == NULL) return TRUE;
   if (!g_strcmp0(header_origin, "")) return TRUE;
+  if (!gdial_rest_server_origin_has_web_scheme(header_origin)) return TRUE;
+  if (app_registry == NULL) return FALSE;
+  if (app_registry->allow_any_origin) return TRUE;
+  return gdial_trie_lookup_suffix(app_registry->allowed_origins_index, header_origin) != NULL;
+}
 
-  gboolean is_allowed = FALSE;
-
-  SoupURI *origin_uri = soup_uri_new(header_origin);
-  const gchar *uri_scheme = origin_uri ? soup_uri_get_scheme(origin_uri) : NULL;
-
-  if (origin_uri && uri_scheme &&
-    (uri_scheme == SOUP_URI_SCHEME_HTTP || uri_scheme == SOUP_URI_SCHEME_HTTPS || uri_scheme == SOUP_URI_SCHEME_FILE)) {
-    GDialAppRegistry *app_registry = gdial_rest_server_find_app_registry(self, app_name);
-    if (app_registry) {
-      GList *allowed_origins = app_registry->allowed_origins;
-      while (allowed_origins) {
-        gchar *origin = (gchar *)allowed_origins->data;
-        if (GDIAL_STR_ENDS_WITH(header_origin, origin)) {
-          is_allowed = TRUE;
-          break;
-        }
-        allowed_origins = allowed_origins->next;
-      }
-    }
-    else {
-    }
+static const GDialOriginCacheEntry *gdial_rest_server_lookup_origin(GDialRestServerPrivate *priv, GDialAppRegistry *app_registry, const gchar *header_origin) {
+  GDialOriginCacheEntry key;
+  key.app_registry = app_registry;
+  key.origin = (gchar *)header_origin;
+  key.hash = g_str_hash(header_origin) ^ GPOINTER_TO_UINT(app_registry);
+
+  GDialOriginCacheEntry *entry = (GDialOriginCacheEntry *)g_hash_table_lookup(priv->origin_cache, &key);
+  if (entry) {
+    g_queue_unlink(&priv->origin_lru, &entry->link);
+    g_queue_push_head_link(&priv->origin_lru, &entry->link);
+    return entry;
   }
-  else {
-    is_allowed = TRUE;
+
+  if (g_queue_get_length(&priv->origin_lru) >= GDIAL_REST_ORIGIN_CACHE_SIZE) {
+    GList *oldest = g_queue_pop_tail_link(&priv->origin_lru);
+    g_hash_table_remove(priv->origin_cache, oldest->data);
   }
-  if (origin_uri) soup_uri_free(origin_uri);
+  entry = g_new0(GDialOriginCacheEntry, 1);
+  entry->link.data = entry;
+  entry->app_registry = app_registry;
+  entry->hash = key.hash;
+  entry->origin = g_strdup(header_origin);
+  entry->is_allowed = gdial_rest_server_registry_allows_origin(app_registry, header_origin);
+  entry->allow_origin = strlen(header_origin) ? g_strdup(header_origin) : NULL;
+  g_hash_table_add(priv->origin_cache, entry);
+  g_queue_push_head_link(&priv->origin_lru, &entry->link);
+  return entry;
+}
 
-  return is_allowed;
+GDIAL_STATIC gboolean gdial_rest_server_is_allowed_origin(GDialRestServer *self, const gchar *header_origin, const gchar *app_name) {
+  if (self == NULL) return FALSE;
+  if (header_origin == NULL) return TRUE;
+  return gdial_rest_server_registry_allows_origin(gdial_rest_server_find_app_registry(self, app_name), header_origin);
 }
 
-GDIAL_STATIC gchar *gdial_rest_server_new_additional_data_url(guint listening_port, const gchar *app_name, gboolean encode) {
+GDIAL_STATIC gchar *gdial_rest_server_new_additional_data_url(GDialArena *arena, guint listening_port, const gchar *app_name, gboolean encode) {
   /*
    * The specifciation of additionalDataUrl in form of /apps/<app_name>/dial_data
    * thus the instance data must be included in the query or payload, not the path.
@@ -260,17 +336,8 @@ GDIAL_STATIC gchar *gdial_rest_server_new_additional_data_url(guint listening_po
    * [[The additionalDataUrl value MUST be URL-encoded using the rules defined in [5]
    * for MIME type application/x-www-form-urlencoded.]]
    */
-  GString *url_buf = g_string_new("");
-  g_string_printf(url_buf, "http://%s:%d%s/%s%s", "localhost", listening_port, GDIAL_REST_HTTP_APPS_URI, app_name, GDIAL_REST_HTTP_DIAL_DATA_URI);
-  gchar *unencoded = g_string_free(url_buf, FALSE);
-  if (encode) {
-    gchar *encoded = soup_uri_encode(unencoded, NULL);
-    g_free(unencoded);
-    return encoded;
-  }
-  else {
-    return unencoded;
-  }
+  gchar *unencoded = gdial_arena_printf(arena, "http://%s:%d%s/%s%s", "localhost", listening_port, GDIAL_REST_HTTP_APPS_URI, app_name, GDIAL_REST_HTTP_DIAL_DATA_URI);
+  return encode ? gdial_arena_uri_encode(arena, unencoded, GDIAL_URI_ENCODE_DEFAULT) : unencoded;
 }
 
 static void gdial_rest_app_state_changed_cb(GDialApp *app, gpointer signal_param_user_data, gpointer user_data) {
@@ -282,7 +349,6 @@ static void gdial_rest_app_state_changed_cb(GDialApp *app, gpointer signal_param
 static void gdial_rest_server_handle_OPTIONS(SoupMessage *msg, const gchar *allow_methods) {
   soup_message_headers_replace(msg->response_headers, "Access-Control-Allow-Methods", allow_methods);
   soup_message_headers_replace(msg->response_headers, "Access-Control-Max-Age", "86400");
-  gdial_soup_message_headers_set_Allow_Origin(msg, TRUE);
   soup_message_set_status(msg, SOUP_STATUS_NO_CONTENT);
 }
 
@@ -316,14 +382,136 @@ static GDialApp *gdial_rest_server_check_instance(GDialApp *app, const gchar *in
   return app_by_instance;
 }
 
-static void gdial_rest_server_handle_POST_hide(SoupMessage *msg, GDialApp *app) {
+/*
+ * A request paused until the platform confirms the state it asked for. The
+ * response is set up as if the platform had already confirmed; a reported
+ * error turns it into an error response, a timeout sends it as it is.
+ */
+typedef struct {
+  GList link;
+  GDialRestServer *gdial_rest_server;
+  SoupServer *server;
+  SoupMessage *msg;
+  GDialApp *app;
+  GDialAppState expected_state;
+  /* a reported error fails the request, otherwise it is answered as set up */
+  gboolean fail_on_error;
+  /* the request owns an app reference that goes with a failure */
+  gboolean unref_app_on_failure;
+  gulong state_changed_id;
+  gulong finished_id;
+  gint64 paused_at;
+  GDialTimer timer;
+} GDialRestStateWaiter;
+
+static guint64 state_waits_confirmed_ = 0;
+static guint64 state_waits_failed_ = 0;
+static guint64 state_waits_timed_out_ = 0;
+
+static guint gdial_rest_server_app_error_status(GDialAppError app_error) {
+  switch (app_error) {
+    case GDIAL_APP_ERROR_FORBIDDEN:       return SOUP_STATUS_FORBIDDEN;
+    case GDIAL_APP_ERROR_UNAUTH:          return SOUP_STATUS_UNAUTHORIZED;
+    case GDIAL_APP_ERROR_NOT_IMPLEMENTED: return SOUP_STATUS_NOT_IMPLEMENTED;
+    default:                              return SOUP_STATUS_SERVICE_UNAVAILABLE;
+  }
+}
+
+static void gdial_rest_state_waiter_free(GDialRestStateWaiter *waiter) {
+  GDialRestServerPrivate *priv = gdial_rest_server_get_instance_private(waiter->gdial_rest_server);
+  g_queue_unlink(&priv->state_waiters, &waiter->link);
+  gdial_timer_cancel(priv->timer_wheel, &waiter->timer);
+  g_signal_handler_disconnect(waiter->app, waiter->state_changed_id);
+  g_signal_handler_disconnect(waiter->msg, waiter->finished_id);
+  g_object_unref(waiter->app);
+  g_object_unref(waiter->msg);
+  g_object_unref(waiter->server);
+  g_free(waiter);
+}
+
+/*
+ * Answer the paused request, with @failure_status in place of the response
+ * set up by the handler unless it is SOUP_STATUS_NONE.
+ */
+static void gdial_rest_state_waiter_complete(GDialRestStateWaiter *waiter, guint failure_status) {
+  SoupMessage *msg = waiter->msg;
+  g_print("%s [%s] %s after %" G_GINT64_FORMAT " ms, state = %d\r\n", msg->method, waiter->app->name,
+    failure_status == SOUP_STATUS_NONE ? "answered" : "failed",
+    (g_get_monotonic_time() - waiter->paused_at) / 1000, waiter->app->state);
+  if (failure_status != SOUP_STATUS_NONE) {
+    soup_message_headers_remove(msg->response_headers, "Location");
+    soup_message_headers_remove(msg->response_headers, "Access-Control-Allow-Origin");
+    gdial_soup_message_set_http_error(msg, failure_status);
+    if (waiter->unref_app_on_failure) g_object_unref(waiter->app);
+  }
+  /* stop listening before the message can finish */
+  SoupServer *server = g_object_ref(waiter->server);
+  g_object_ref(msg);
+  gdial_rest_state_waiter_free(waiter);
+  soup_server_unpause_message(server, msg);
+  g_object_unref(msg);
+  g_object_unref(server);
+}
+
+static void gdial_rest_state_waiter_state_changed_cb(GDialApp *app, gpointer signal_param_user_data, gpointer user_data) {
+  GDialRestStateWaiter *waiter = (GDialRestStateWaiter *)user_data;
+  if (app->state == waiter->expected_state) {
+    state_waits_confirmed_++;
+    gdial_rest_state_waiter_complete(waiter, SOUP_STATUS_NONE);
+  }
+  else if (gdial_app_get_state_error(app) != GDIAL_APP_ERROR_NONE) {
+    state_waits_failed_++;
+    gdial_rest_state_waiter_complete(waiter, waiter->fail_on_error ? gdial_rest_server_app_error_status(gdial_app_get_state_error(app)) : SOUP_STATUS_NONE);
+  }
+}
+
+static void gdial_rest_state_waiter_timeout_cb(GDialTimer *timer, gpointer user_data) {
+  state_waits_timed_out_++;
+  gdial_rest_state_waiter_complete((GDialRestStateWaiter *)user_data, SOUP_STATUS_NONE);
+}
+
+static void gdial_rest_state_waiter_finished_cb(SoupMessage *msg, gpointer user_data) {
+  /* the connection went away with the request, nothing left to answer */
+  gdial_rest_state_waiter_free((GDialRestStateWaiter *)user_data);
+}
+
+/*
+ * Pause @msg until @app reports @expected_state, for at most the app's wait
+ * budget. Returns FALSE, leaving @msg to be answered at once, if the app is
+ * there already or the app does not wait.
+ */
+static gboolean gdial_rest_server_wait_for_state(GDialRestServer *gdial_rest_server, SoupMessage *msg, GDialAppRegistry *app_registry,
+    GDialApp *app, GDialAppState expected_state, gboolean fail_on_error, gboolean unref_app_on_failure) {
+  if (app_registry == NULL || app_registry->state_wait_ms == 0 || app->state == expected_state) {
+    return FALSE;
+  }
+  GDialRestServerPrivate *priv = gdial_rest_server_get_instance_private(gdial_rest_server);
+  GDialRestStateWaiter *waiter = g_new0(GDialRestStateWaiter, 1);
+  waiter->link.data = waiter;
+  waiter->gdial_rest_server = gdial_rest_server;
+  waiter->server = g_object_ref(priv->dispatch_server);
+  waiter->msg = g_object_ref(msg);
+  waiter->app = g_object_ref(app);
+  waiter->expected_state = expected_state;
+  waiter->fail_on_error = fail_on_error;
+  waiter->unref_app_on_failure = unref_app_on_failure;
+  waiter->paused_at = g_get_monotonic_time();
+  waiter->state_changed_id = g_signal_connect(app, "state-changed", G_CALLBACK(gdial_rest_state_waiter_state_changed_cb), waiter);
+  waiter->finished_id = g_signal_connect(msg, "finished", G_CALLBACK(gdial_rest_state_waiter_finished_cb), waiter);
+  gdial_timer_schedule(priv->timer_wheel, &waiter->timer, app_registry->state_wait_ms, gdial_rest_state_waiter_timeout_cb, waiter);
+  g_queue_push_tail_link(&priv->state_waiters, &waiter->link);
+  soup_server_pause_message(waiter->server, msg);
+  return TRUE;
+}
+
+static void gdial_rest_server_handle_POST_hide(GDialRestServer *gdial_rest_server, SoupMessage *msg, GDialAppRegistry *app_registry, GDialApp *app) {
   gdial_rest_server_http_return_if_fail((gdial_app_state(app) == GDIAL_APP_ERROR_NONE), msg, SOUP_STATUS_NOT_FOUND);
   gdial_rest_server_http_return_if_fail((GDIAL_APP_GET_STATE(app) == GDIAL_APP_STATE_RUNNING) || (GDIAL_APP_GET_STATE(app) == GDIAL_APP_STATE_HIDE), msg, SOUP_STATUS_NOT_FOUND);
 
   GDialAppError app_error = GDIAL_APP_ERROR_NONE;
 
   if ( (app_error = gdial_app_hide(app)) == GDIAL_APP_ERROR_NONE) {
-     g_warn_if_fail(gdial_app_state(app) == GDIAL_APP_ERROR_NONE && GDIAL_APP_GET_STATE(app) == GDIAL_APP_STATE_HIDE);
+     g_warn_if_fail(gdial_app_state(app) == GDIAL_APP_ERROR_NONE);
   }
   else if (app_error == GDIAL_APP_ERROR_NOT_IMPLEMENTED) {
     gdial_rest_server_http_return_if_fail(FALSE, msg, SOUP_STATUS_NOT_IMPLEMENTED);
@@ -335,16 +523,19 @@ static void gdial_rest_server_handle_POST_hide(SoupMessage *msg, GDialApp *app)
 
   soup_message_set_status(msg, SOUP_STATUS_OK);
   soup_message_headers_replace(msg->response_headers, "Content-Type", "text/plain; charset=utf-8");
-  gdial_soup_message_headers_set_Allow_Origin(msg, TRUE);
+  if (!gdial_rest_server_wait_for_state(gdial_rest_server, msg, app_registry, app, GDIAL_APP_STATE_HIDE, TRUE, FALSE)) {
+    g_warn_if_fail(GDIAL_APP_GET_STATE(app) == GDIAL_APP_STATE_HIDE);
+  }
 }
 
-static void gdial_rest_server_handle_DELETE(SoupMessage *msg, GHashTable *query, GDialApp *app) {
+static void gdial_rest_server_handle_DELETE(GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query, GDialAppRegistry *app_registry, GDialApp *app) {
   gdial_rest_server_http_return_if_fail(g_strcmp0(app->name, "system") != 0, msg, SOUP_STATUS_FORBIDDEN);
   gdial_rest_server_http_return_if_fail((gdial_app_state(app) == GDIAL_APP_ERROR_NONE), msg, SOUP_STATUS_NOT_FOUND);
   gdial_rest_server_http_return_if_fail((GDIAL_APP_GET_STATE(app) == GDIAL_APP_STATE_RUNNING) || (GDIAL_APP_GET_STATE(app) == GDIAL_APP_STATE_HIDE), msg, SOUP_STATUS_NOT_FOUND);
 
-  if (gdial_app_stop(app) == GDIAL_APP_ERROR_NONE) {
-    g_warn_if_fail(gdial_app_state(app) == GDIAL_APP_ERROR_NONE && GDIAL_APP_GET_STATE(app) == GDIAL_APP_STATE_STOPPED);
+  gboolean stopped = (gdial_app_stop(app) == GDIAL_APP_ERROR_NONE);
+  if (stopped) {
+    g_warn_if_fail(gdial_app_state(app) == GDIAL_APP_ERROR_NONE);
   }
   else {
     g_printerr("gdial_app_stop(%s) failed, force shutdown\r\n", app->name);
@@ -352,17 +543,27 @@ static void gdial_rest_server_handle_DELETE(SoupMessage *msg, GHashTable *query,
   }
 
   soup_message_headers_replace(msg->response_headers, "Content-Type", "text/plain; charset=utf-8");
-  gdial_soup_message_headers_set_Allow_Origin(msg, TRUE);
   soup_message_set_status(msg, SOUP_STATUS_OK);
+  /*
+   * a stop is answered with 200 whatever the platform says, waiting only
+   * saves the client from polling for the stopped state
+   */
+  if (stopped && !gdial_rest_server_wait_for_state(gdial_rest_server, msg, app_registry, app, GDIAL_APP_STATE_STOPPED, FALSE, FALSE)) {
+    g_warn_if_fail(GDIAL_APP_GET_STATE(app) == GDIAL_APP_STATE_STOPPED);
+  }
   g_object_unref(app);
 }
 
-static void gdial_rest_server_handle_POST(GDialRestServer *gdial_rest_server, SoupMessage* msg, GHashTable *query, const gchar *app_name) {
-  GDialAppRegistry *app_registry = gdial_rest_server_find_app_registry(gdial_rest_server, app_name);
+static void gdial_rest_server_handle_POST(GDialRestServer *gdial_rest_server, SoupMessage* msg, GHashTable *query, GDialAppRegistry *app_registry) {
   gdial_rest_server_http_return_if_fail(app_registry, msg, SOUP_STATUS_NOT_FOUND);
+  /*
+   * the body is validated and its encoded length measured in one scan,
+   * the launch request then encodes it without looking again
+   */
+  GDialLaunchPayload payload = {NULL, 0, 0};
   if (msg->request_body && msg->request_body->data && msg->request_body->length) {
     gdial_rest_server_http_return_if_fail(msg->request_body->length <= GDIAL_REST_HTTP_MAX_PAYLOAD, msg, SOUP_STATUS_REQUEST_ENTITY_TOO_LARGE);
-    gdial_rest_server_http_return_if_fail(!gdial_rest_server_is_bad_payload(msg->request_body->data, msg->request_body->length), msg, SOUP_STATUS_BAD_REQUEST);
+    gdial_rest_server_http_return_if_fail(gdial_launch_payload_init(&payload, msg->request_body->data, msg->request_body->length), msg, SOUP_STATUS_BAD_REQUEST);
   }
   guint listening_port = soup_address_get_port(soup_message_get_address(msg));
   gdial_rest_server_http_return_if_fail(listening_port != 0, msg, SOUP_STATUS_INTERNAL_SERVER_ERROR);
@@ -398,52 +599,29 @@ static void gdial_rest_server_handle_POST(GDialRestServer *gdial_rest_server, So
   if (new_app_instance) {
     gchar *additional_data_url = NULL;
     if (app_registry->use_additional_data) {
-      additional_data_url = gdial_rest_server_new_additional_data_url(listening_port, app_registry->name, FALSE);
+      additional_data_url = gdial_rest_server_new_additional_data_url(gdial_arena_for_message(msg), listening_port, app_registry->name, FALSE);
     }
-    gchar *additional_data_url_safe = soup_uri_encode(additional_data_url, NULL);
-    g_print("additionalDataUrl = %s, %s\r\n", additional_data_url, additional_data_url_safe);
+    g_print("additionalDataUrl = %s\r\n", additional_data_url);
     g_signal_connect_object(app, "state-changed", G_CALLBACK(gdial_rest_app_state_changed_cb), gdial_rest_server, 0);
+    /*
+     * the query string is passed on as soup has it, the body is encoded
+     * (per the app's launch template) straight into the launch request
+     */
     const gchar *query_str = soup_uri_get_query(soup_message_get_uri(msg));
-    gchar *query_str_safe = NULL;
-    const int use_query_directly_from_soup = 1;
-    if(query_str && strlen(query_str)) {
-    g_print("query = %s\r\n", query_str);
-      if (!use_query_directly_from_soup) {
-        char *tmp = soup_uri_encode(query_str, NULL);
-        // note that we later g_free(query_str_safe) which doesn't necessarily work with malloc'ed memory (seems to depend on glib version)
-        query_str_safe = g_strdup(tmp);
-        free(tmp);
-      }
-      else {
-        query_str_safe = g_strdup(query_str);
-      }
-    }
-    const gchar *payload = msg->request_body->data;
-    gchar *payload_safe = NULL;
-    if (payload && strlen(payload)) {
-      if (g_strcmp0(app->name, "YouTube") == 0) {
-        /* temporary disabling encoding payload for YouTube till cloud side changed*/
-        payload_safe = g_strdup(payload);
-      }
-      else {
-        char *tmp = soup_uri_encode(payload, "=&");
-        // note that we later g_free(payload_safe) which doesn't necessarily work with malloc'ed memory (seems to depend on glib version)
-        payload_safe = g_strdup(tmp);
-        free(tmp);
-      }
+    if (query_str && strlen(query_str)) {
+      g_print("query = %s\r\n", query_str);
     }
-    start_error = gdial_app_start(app, payload_safe, query_str_safe, additional_data_url_safe, gdial_rest_server);
-    if (query_str_safe) g_free(query_str_safe);
-    if (payload_safe) g_free(payload_safe);
-    free(additional_data_url_safe);
-    g_free(additional_data_url);
+    GDialLaunchRequest *launch_request = gdial_launch_request_new(gdial_launch_template_lookup(app->name),
+      &payload, query_str, additional_data_url);
+    start_error = gdial_app_start(app, launch_request, gdial_rest_server);
+    gdial_launch_request_unref(launch_request);
   }
   else {
     /*
      * start_error = NONE;
      * app exist, and could be in hidden state, so resume;
      */
-    start_error = gdial_app_start(app, NULL, NULL, NULL, gdial_rest_server);
+    start_error = gdial_app_start(app, NULL, gdial_rest_server);
   }
 
   /*
@@ -451,12 +629,14 @@ static void gdial_rest_server_handle_POST(GDialRestServer *gdial_rest_server, So
    * to RUNNING yet. so started == TRUE, there will be followed by a
    * RUNNING callback. if started == FAUSE, then the instance is not
    * created;
+   *
+   * Apps with a state wait budget hold the response until that callback
+   * confirms the start, or reports why it failed.
    */
   if (start_error == GDIAL_APP_ERROR_NONE) {
     soup_message_headers_replace(msg->response_headers, "Content-Type", "text/plain; charset=utf-8");
-    gdial_soup_message_headers_replace_va(msg->response_headers, "Location", "http://%s:%d%s/%s/run",
+    gdial_soup_message_headers_replace_va(msg, "Location", "http://%s:%d%s/%s/run",
       soup_uri_get_host(soup_message_get_uri(msg)), listening_port, GDIAL_REST_HTTP_APPS_URI, app->name);
-    gdial_soup_message_headers_set_Allow_Origin(msg, TRUE);
     if (new_app_instance) {
       soup_message_set_status(msg, SOUP_STATUS_CREATED);
       /*
@@ -472,10 +652,13 @@ static void gdial_rest_server_handle_POST(GDialRestServer *gdial_rest_server, So
       }
     }
     else {
-      if(app->state != GDIAL_APP_STATE_RUNNING) {
+      soup_message_set_status(msg, SOUP_STATUS_OK);
+    }
+    /* a resumed singleton was not referenced by this request, so a failure must not drop it */
+    if (!gdial_rest_server_wait_for_state(gdial_rest_server, msg, app_registry, app, GDIAL_APP_STATE_RUNNING, TRUE, new_app_instance)) {
+      if(!new_app_instance && app->state != GDIAL_APP_STATE_RUNNING) {
         g_warn_if_reached();
       }
-      soup_message_set_status(msg, SOUP_STATUS_OK);
     }
   }
   else {
@@ -486,7 +669,7 @@ static void gdial_rest_server_handle_POST(GDialRestServer *gdial_rest_server, So
   }
 }
 
-static void gdial_rest_server_handle_GET_app(GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query, const gchar *app_name, gint instance_id) {
+static void gdial_rest_server_handle_GET_app(GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query, const gchar *app_name, GDialAppRegistry *app_registry, gint instance_id) {
   gdouble client_dial_version = 0.;
   if (query) {
     gchar *client_dial_version_str = g_hash_table_lookup(query, "clientDialVer");
@@ -496,7 +679,6 @@ static void gdial_rest_server_handle_GET_app(GDialRestServer *gdial_rest_server,
     }
   }
 
-  GDialAppRegistry *app_registry = gdial_rest_server_find_app_registry(gdial_rest_server, app_name);
   gdial_rest_server_http_return_if_fail(app_registry, msg, SOUP_STATUS_NOT_FOUND);
 
   GDialApp *app = gdial_app_find_instance_by_name(app_name);
@@ -526,23 +708,18 @@ static void gdial_rest_server_handle_GET_app(GDialRestServer *gdial_rest_server,
     }
   }
 
-  gdial_soup_message_headers_set_Allow_Origin(msg, TRUE);
   soup_message_set_status(msg, SOUP_STATUS_OK);
-  #if 0
-  void *builder = GET_APP_response_builder_new(app_name);
-  GET_APP_response_builder_set_option(builder, "allowStop", "true");
-  GET_APP_response_builder_set_state(builder, app_state);
-  GET_APP_response_builder_set_additionalData(builder, " ");
-  gsize response_len = 0;
-  gchar *response_str =  GET_APP_response_builder_build(builder, &response_len);
-  //g_printf("############ response_str ##########\r\n%s\r\n", response_str);
-  soup_message_set_response(msg, "text/xml", SOUP_MEMORY_TAKE, response_str, response_len);
-  GET_APP_response_builder_destroy(builder);
-  #else
-  int response_len = 0;
-  gchar *response_str = gdial_app_state_response_new(app, GDIAL_PROTOCOL_VERSION_STR, GDIAL_PROTOCOL_XMLNS_SCHEMA, &response_len);
-  #endif
-  soup_message_set_response(msg, "text/xml; charset=utf-8", SOUP_MEMORY_TAKE, response_str, response_len);
+  GBytes *response = gdial_app_state_response_ref(app, GDIAL_PROTOCOL_VERSION_STR, GDIAL_PROTOCOL_XMLNS_SCHEMA);
+  if (response) {
+    /* the body shares the cached bytes, no copy per request */
+    gsize response_len = 0;
+    gconstpointer response_data = g_bytes_get_data(response, &response_len);
+    SoupBuffer *response_buffer = soup_buffer_new_with_owner(response_data, response_len, response, (GDestroyNotify)g_bytes_unref);
+    soup_message_headers_replace(msg->response_headers, "Content-Type", "text/xml; charset=utf-8");
+    soup_message_body_truncate(msg->response_body);
+    soup_message_body_append_buffer(msg->response_body, response_buffer);
+    soup_buffer_free(response_buffer);
+  }
   if (app_state == GDIAL_APP_STATE_STOPPED) {
     g_print("deleting app instance from state %d \r\n", app_state);
     g_object_unref(app);
@@ -640,82 +817,243 @@ static void gdial_rest_http_server_system_callback(SoupServer *server,
 
 }
 
+/*
+ * Valid http paths (DIAL 2.1)
+ *
+ * Minimum URI must start with "/apps" -- ensured by soup
+ * Minimum URI must be larger than "/apps/"
+ *
+ * Default <instance> is "run", but this is not guarnteed
+ *
+ * POST http://<ip>:<port>/apps/Netflix -- launch app
+ * GET  http://<ip>:<port>/apps/Netflix -- get app state, and instance URL
+ * GET  http://<ip>:<port>/apps/Netflix/<instance> -- get instance state
+ * DELETE http://<ip>:<port>/apps/Netflix/<instance> -- stop instance
+ * POST http://<ip>:<port>/apps/Netflix/<instance>/hide -- hide instance
+ * POST http://<ip>:<port>/apps/Netflix/dial_data
+ *
+ * The path is split on '/' into at most 4 elements (the last one keeps the
+ * remainder), empty elements are skipped and every element must be shorter
+ * than GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN.
+ */
+GDIAL_STATIC gboolean gdial_rest_server_route_path(const gchar *path, GDialRestRoute *route) {
+  g_return_val_if_fail(path != NULL && route != NULL, FALSE);
+  memset(route, 0, offsetof(GDialRestRoute, buffer));
+  if (path[0] == '/') path++;
+  const gsize path_len = strlen(path);
+  if (path_len >= sizeof(route->buffer)) return FALSE;
+  memcpy(route->buffer, path, path_len + 1);
+
+  const gchar *elements[GDIAL_REST_ROUTE_MAX_ELEMENTS] = {NULL};
+  gchar *start = route->buffer;
+  int tokens = 0;
+  int element_num = 0;
+  while (start != NULL) {
+    gchar *end = (++tokens < GDIAL_REST_ROUTE_MAX_ELEMENTS) ? strchr(start, '/') : NULL;
+    if (end) *end = '\0';
+    const gsize len = end ? (gsize)(end - start) : strlen(start);
+    if (len > 0) {
+      if (len >= GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN) return FALSE;
+      elements[element_num++] = start;
+    }
+    start = end ? end + 1 : NULL;
+  }
+
+  /*
+   * element_num == 2:
+   *   apps/Netflix
+   *
+   * element_num == 3:
+   *   apps/Netflix/run
+   *   apps/Netflix/12345
+   *   apps/Netflix/dial_data
+   *
+   * element_num == 4:
+   *   apps/Netflix/run/hide
+   *   apps/Netflix/12345/hide
+   */
+  if (element_num < 2) return FALSE;
+  route->base = elements[0];
+  route->app_name = elements[1];
+  route->instance = elements[2];
+  if (element_num == 2) {
+    route->type = GDIAL_REST_ROUTE_APP;
+  }
+  else if (element_num == 3) {
+    route->type = (strcmp(elements[2], &GDIAL_REST_HTTP_DIAL_DATA_URI[1]) == 0) ? GDIAL_REST_ROUTE_APP_DIAL_DATA : GDIAL_REST_ROUTE_APP_INSTANCE;
+  }
+  else if (strcmp(elements[3], &GDIAL_REST_HTTP_HIDE_URI[1]) == 0) {
+    route->type = GDIAL_REST_ROUTE_APP_HIDE;
+  }
+  return route->type != GDIAL_REST_ROUTE_INVALID;
+}
+
+static GDialRestMethod gdial_rest_server_route_method(SoupMessage *msg) {
+  /* soup interns method names, pointer compare is enough */
+  if (msg->method == SOUP_METHOD_GET) return GDIAL_REST_METHOD_GET;
+  if (msg->method == SOUP_METHOD_POST) return GDIAL_REST_METHOD_POST;
+  if (msg->method == SOUP_METHOD_DELETE) return GDIAL_REST_METHOD_DELETE;
+  if (msg->method == SOUP_METHOD_OPTIONS) return GDIAL_REST_METHOD_OPTIONS;
+  return GDIAL_REST_METHOD_OTHER;
+}
+
+typedef void (*GDialRestRouteHandler)(GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query,
+  SoupClientContext *client, const GDialRestRoute *route);
+
+static const gchar *gdial_rest_route_allow_methods[GDIAL_REST_ROUTE_N] = {
+  [GDIAL_REST_ROUTE_APP] = "GET, POST, OPTIONS",
+  [GDIAL_REST_ROUTE_APP_INSTANCE] = "DELETE, OPTIONS",
+  [GDIAL_REST_ROUTE_APP_DIAL_DATA] = "POST, OPTIONS",
+  [GDIAL_REST_ROUTE_APP_HIDE] = "POST, OPTIONS",
+};
+
+static void gdial_rest_route_OPTIONS(GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query,
+    SoupClientContext *client, const GDialRestRoute *route) {
+  gdial_rest_server_handle_OPTIONS(msg, gdial_rest_route_allow_methods[route->type]);
+}
+
+static void gdial_rest_route_not_found(GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query,
+    SoupClientContext *client, const GDialRestRoute *route) {
+  gdial_soup_message_set_http_error(msg, SOUP_STATUS_NOT_FOUND);
+}
+
+static void gdial_rest_route_POST_app(GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query,
+    SoupClientContext *client, const GDialRestRoute *route) {
+  gdial_rest_server_handle_POST(gdial_rest_server, msg, query, route->app_registry);
+}
+
+static void gdial_rest_route_GET_app(GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query,
+    SoupClientContext *client, const GDialRestRoute *route) {
+  /*
+   * GET_app will get app state...there is no instance_id in URL
+   */
+  gdial_rest_server_handle_GET_app(gdial_rest_server, msg, query, route->app_name, route->app_registry, GDIAL_APP_INSTANCE_NULL);
+}
+
+static void gdial_rest_route_DELETE_instance(GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query,
+    SoupClientContext *client, const GDialRestRoute *route) {
+  GDialApp *app = gdial_app_find_instance_by_name(route->app_name);
+  GDialApp *app_by_instance = gdial_rest_server_check_instance(app, route->instance);
+  if (app_by_instance) {
+    gdial_rest_server_handle_DELETE(gdial_rest_server, msg, query, route->app_registry, app);
+  }
+  else {
+    g_printerr("app to delete is not found\r\n");
+    gdial_soup_message_set_http_error(msg, SOUP_STATUS_NOT_FOUND);
+  }
+}
+
+static void gdial_rest_route_POST_hide(GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query,
+    SoupClientContext *client, const GDialRestRoute *route) {
+  GDialApp *app = gdial_app_find_instance_by_name(route->app_name);
+  GDialApp *app_by_instance = gdial_rest_server_check_instance(app, route->instance);
+  if (app_by_instance) {
+    gdial_rest_server_handle_POST_hide(gdial_rest_server, msg, route->app_registry, app);
+  }
+  else {
+    g_printerr("app to hide is not found\r\n");
+    gdial_rest_server_http_return_if_fail(FALSE, msg, SOUP_STATUS_NOT_FOUND);
+  }
+}
+
+static void gdial_rest_route_POST_dial_data(GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query,
+    SoupClientContext *client, const GDialRestRoute *route) {
+  gdial_rest_server_handle_POST_dial_data(gdial_rest_server, msg, query, route->app_name);
+}
+
+static void gdial_rest_route_local_POST_dial_data(GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query,
+    SoupClientContext *client, const GDialRestRoute *route) {
+  gdial_rest_server_http_return_if_fail(route->app_registry, msg, SOUP_STATUS_NOT_FOUND);
+  gdial_rest_server_handle_POST_dial_data(gdial_rest_server, msg, query, route->app_name);
+}
+
+/*
+ * Unlisted (route, method) pairs are answered with 501
+ */
+static const GDialRestRouteHandler gdial_rest_routes[GDIAL_REST_ROUTE_N][GDIAL_REST_METHOD_N] = {
+  [GDIAL_REST_ROUTE_APP] = {
+    [GDIAL_REST_METHOD_OPTIONS] = gdial_rest_route_OPTIONS,
+    [GDIAL_REST_METHOD_POST] = gdial_rest_route_POST_app,
+    [GDIAL_REST_METHOD_GET] = gdial_rest_route_GET_app,
+  },
+  [GDIAL_REST_ROUTE_APP_INSTANCE] = {
+    [GDIAL_REST_METHOD_OPTIONS] = gdial_rest_route_OPTIONS,
+    [GDIAL_REST_METHOD_DELETE] = gdial_rest_route_DELETE_instance,
+    [GDIAL_REST_METHOD_POST] = gdial_rest_route_not_found,
+  },
+  [GDIAL_REST_ROUTE_APP_DIAL_DATA] = {
+    [GDIAL_REST_METHOD_OPTIONS] = gdial_rest_route_OPTIONS,
+    [GDIAL_REST_METHOD_POST] = gdial_rest_route_POST_dial_data,
+  },
+  [GDIAL_REST_ROUTE_APP_HIDE] = {
+    [GDIAL_REST_METHOD_OPTIONS] = gdial_rest_route_OPTIONS,
+    [GDIAL_REST_METHOD_POST] = gdial_rest_route_POST_hide,
+    [GDIAL_REST_METHOD_DELETE] = gdial_rest_route_not_found,
+  },
+};
+
+static const GDialRestRouteHandler gdial_local_rest_routes[GDIAL_REST_ROUTE_N][GDIAL_REST_METHOD_N] = {
+  [GDIAL_REST_ROUTE_APP_DIAL_DATA] = {
+    [GDIAL_REST_METHOD_POST] = gdial_rest_route_local_POST_dial_data,
+  },
+};
+
+static void gdial_rest_server_dispatch(const GDialRestRouteHandler routes[GDIAL_REST_ROUTE_N][GDIAL_REST_METHOD_N], SoupServer *server,
+    GDialRestServer *gdial_rest_server, SoupMessage *msg, GHashTable *query, SoupClientContext *client, const GDialRestRoute *route) {
+  GDialRestRouteHandler handler = routes[route->type][gdial_rest_server_route_method(msg)];
+  if (handler) {
+    GDialRestServerPrivate *priv = gdial_rest_server_get_instance_private(gdial_rest_server);
+    priv->dispatch_server = server;
+    handler(gdial_rest_server, msg, query, client, route);
+    priv->dispatch_server = NULL;
+  }
+  else {
+    gdial_soup_message_set_http_error(msg, SOUP_STATUS_NOT_IMPLEMENTED);
+  }
+}
+
+/*
+ * Every request is logged with its peer, formatted on the stack so that a
+ * plain GET does not need the message arena.
+ */
+static void gdial_rest_server_remote_address_to_buf(SoupClientContext *client, gchar buf[INET6_ADDRSTRLEN]) {
+  GInetAddress *address = g_inet_socket_address_get_address(G_INET_SOCKET_ADDRESS(soup_client_context_get_remote_address(client)));
+  gboolean is_ipv4 = g_inet_address_get_family(address) == G_SOCKET_FAMILY_IPV4;
+  if (inet_ntop(is_ipv4 ? AF_INET : AF_INET6, g_inet_address_to_bytes(address), buf, INET6_ADDRSTRLEN) == NULL) {
+    buf[0] = '\0';
+  }
+}
+
 static void gdial_local_rest_http_server_callback(SoupServer *server,
             SoupMessage *msg, const gchar *path, GHashTable *query,
             SoupClientContext  *client, gpointer user_data) {
-  gchar *remote_address_str = g_inet_address_to_string(g_inet_socket_address_get_address(G_INET_SOCKET_ADDRESS(soup_client_context_get_remote_address(client))));
+  gchar remote_address_str[INET6_ADDRSTRLEN];
+  gdial_rest_server_remote_address_to_buf(client, remote_address_str);
   g_print_with_timestamp("gdial_local_rest_http_server_callback() %s path=%s recv from [%s], in thread %lx\r\n", msg->method, path, remote_address_str, pthread_self());
-  g_free(remote_address_str);
   GDialRestServer *gdial_rest_server = (GDIAL_REST_SERVER(user_data));
-  gchar **elements = g_strsplit(&path[1], "/", 4);
-  gdial_rest_server_http_return_if_fail(elements != NULL, msg, SOUP_STATUS_NOT_IMPLEMENTED);
-  gchar base[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN] = {0};
-  gchar app_name[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN] = {0};
-  gchar instance[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN] = {0};
-  gchar last_elem[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN] = {0};
-  int i = 0;
-  int j = 0;
-  for (i = 0; elements[i] != NULL; i++) {
-    /* do not allow any element to be empty, stop on first one */
-    if ((strlen(elements[i])) == 0) {
-      g_printerr("Warn: empty elements in URI path\r\n");
-      continue;
-    }
-    if (j == 0) g_strlcpy(base, elements[i], sizeof(base));
-    else if (j == 1) g_strlcpy(app_name, elements[i], sizeof(app_name));
-    else if (j == 2) g_strlcpy(instance, elements[i], sizeof(instance));
-    g_strlcpy(last_elem, elements[i], sizeof(last_elem));
-    j++;
-  }
-  g_strfreev(elements);
-  const int element_num = j;
-  printf("there are %d non-empty elems\r\n", element_num);
-  if(element_num == 3 && g_strcmp0(instance,"dial_data") == 0)
-  {
-     GDialAppRegistry *app_registry = gdial_rest_server_find_app_registry(gdial_rest_server, app_name);
-     gdial_rest_server_http_return_if_fail(app_registry, msg, SOUP_STATUS_NOT_FOUND);
-     if (msg->method == SOUP_METHOD_POST) {
-        gdial_rest_server_handle_POST_dial_data(gdial_rest_server, msg, query, app_name);
-     }
-    else {
-        gdial_rest_server_http_return_if_fail(msg->method == SOUP_METHOD_POST, msg, SOUP_STATUS_NOT_IMPLEMENTED);
-     }
-  }
-  else {
-    gdial_soup_message_set_http_error(msg,SOUP_STATUS_NOT_IMPLEMENTED);
-  }
+  GDialRestRoute route;
+  gdial_rest_server_http_return_if_fail(gdial_rest_server_route_path(path, &route), msg, SOUP_STATUS_NOT_IMPLEMENTED);
+  route.app_registry = gdial_rest_server_find_app_registry(gdial_rest_server, route.app_name);
+  gdial_rest_server_dispatch(gdial_local_rest_routes, server, gdial_rest_server, msg, query, client, &route);
 }
 
+/* requests that reached the /apps handler, to relate platform IPC to */
+static guint64 apps_requests_ = 0;
+
 static void gdial_rest_http_server_apps_callback(SoupServer *server,
             SoupMessage *msg, const gchar *path, GHashTable *query,
             SoupClientContext  *client, gpointer user_data) {
-  gchar *remote_address_str = g_inet_address_to_string(g_inet_socket_address_get_address(G_INET_SOCKET_ADDRESS(soup_client_context_get_remote_address(client))));
+  apps_requests_++;
+  gchar remote_address_str[INET6_ADDRSTRLEN];
+  gdial_rest_server_remote_address_to_buf(client, remote_address_str);
   g_print_with_timestamp("gdial_rest_http_server_apps_callback() %s path=%s recv from [%s], in thread %lx\r\n", msg->method, path, remote_address_str, pthread_self());
-  g_free(remote_address_str);
 
   gdial_rest_server_http_return_if_fail(server && msg && path && client && user_data, msg, SOUP_STATUS_INTERNAL_SERVER_ERROR);
   GDialRestServer *gdial_rest_server = (GDIAL_REST_SERVER(user_data));
 
-  /*
-   * Valid http paths (DIAL 2.1)
-   *
-   * Minimum URI must start with "/apps" -- ensured by soup
-   * Minimum URI must be larger than "/apps/"
-   * URI must not end with '/'
-   *
-   * Default <instance> is "run", but this is not guarnteed
-   *
-   * POST http://<ip>:<port>/apps/Netflix -- launch app
-   * GET  http://<ip>:<port>/apps/Netflix -- get app state, and instance URL
-   * GET  http://<ip>:<port>/apps/Netflix/<instance> -- get instance state
-   * DELETE http://<ip>:<port>/apps/Netflix/<instance> -- stop instance
-   * POST http://<ip>:<port>/apps/Netflix/<instance>/hide -- hide instance
-   * POST http://<ip>:<port>/apps/Netflix/dial_data
-   */
   gdial_rest_server_http_return_if_fail(
     g_socket_address_get_family(soup_client_context_get_remote_address(client)) == G_SOCKET_FAMILY_IPV4, msg, SOUP_STATUS_NOT_IMPLEMENTED);
   gdial_rest_server_http_return_if_fail(gdial_soup_message_security_check(msg), msg, SOUP_STATUS_INTERNAL_SERVER_ERROR);
-  gdial_rest_server_http_return_if_fail(path != NULL, msg, SOUP_STATUS_INTERNAL_SERVER_ERROR);
 
   size_t path_len = strlen(path);
   gdial_rest_server_http_return_if_fail(path_len < GDIAL_REST_HTTP_MAX_URI_LEN, msg, SOUP_STATUS_INTERNAL_SERVER_ERROR);
@@ -725,68 +1063,22 @@ static void gdial_rest_http_server_apps_callback(SoupServer *server,
   const gchar *header_host = soup_message_headers_get_one(msg->request_headers, "Host");
   gdial_rest_server_http_return_if_fail(header_host, msg, SOUP_STATUS_FORBIDDEN);
 
-  /*
-   * @TODO remote consecutive slashes.
-   */
-  gchar **elements = g_strsplit(&path[1], "/", 4);
-  gdial_rest_server_http_return_if_fail(elements != NULL, msg, SOUP_STATUS_NOT_IMPLEMENTED);
-
-  gchar base[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN] = {0};
-  gchar app_name[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN] = {0};
-  gchar instance[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN] = {0};
-  gchar last_elem[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN] = {0};
-
-  gboolean invalid_uri = FALSE;
-
-  int i = 0;
-  int j = 0;
-  for (i = 0; elements[i] != NULL; i++) {
-    /* do not allow any element to be empty, stop on first one */
-    if ((strlen(elements[i])) == 0) {
-      g_printerr("Warn: empty elements in URI path\r\n");
-      //invalid_uri = invalid_uri || TRUE;
-      //break;
-      continue;
-    }
-    if (j == 0) g_strlcpy(base, elements[i], sizeof(base));
-    else if (j == 1) g_strlcpy(app_name, elements[i], sizeof(app_name));
-    else if (j == 2) g_strlcpy(instance, elements[i], sizeof(instance));
-    g_strlcpy(last_elem, elements[i], sizeof(last_elem));
-    j++;
-  }
-
-  const int element_num = j;
-  printf("there are %d non-empty elems\r\n", element_num);
-  /*
-   * Make sure path remains same as given
-   */
-  const gchar *copied_str[] = {base, app_name, instance, last_elem};
-  i = 0; j = 0;
-  while (i < element_num && i < sizeof(copied_str)/sizeof(copied_str[0])) {
-    if (strlen(elements[j]) == 0) {
-      j++;
-      continue;
-    }
-    invalid_uri = invalid_uri || g_strcmp0(copied_str[i], elements[j]);
-    gdial_rest_server_http_return_if_fail(!invalid_uri, msg, SOUP_STATUS_NOT_IMPLEMENTED);
-    j++;i++;
-  }
-
-  g_strfreev(elements);
-
-  invalid_uri = invalid_uri || (i > 4 || i < 2);
-  invalid_uri = invalid_uri || (g_strcmp0(base, &GDIAL_REST_HTTP_APPS_URI[1]) != 0);
-  invalid_uri = invalid_uri || (strlen(app_name) == 0);
-
-  gdial_rest_server_http_return_if_fail(!invalid_uri, msg, SOUP_STATUS_NOT_IMPLEMENTED);
+  GDialRestRoute route;
+  gdial_rest_server_http_return_if_fail(gdial_rest_server_route_path(path, &route), msg, SOUP_STATUS_NOT_IMPLEMENTED);
+  gdial_rest_server_http_return_if_fail(strcmp(route.base, &GDIAL_REST_HTTP_APPS_URI[1]) == 0, msg, SOUP_STATUS_NOT_IMPLEMENTED);
 
+  route.app_registry = gdial_rest_server_find_app_registry(gdial_rest_server, route.app_name);
   const gchar *header_origin = soup_message_headers_get_one(msg->request_headers, "Origin");
   g_printerr("Origin %s, Host: %s, Method: %s\r\n", header_origin, header_host, msg->method);
-  if (!gdial_rest_server_is_allowed_origin(gdial_rest_server, header_origin, app_name)) {
-    gdial_rest_server_http_print_and_return_if_fail(FALSE, msg, SOUP_STATUS_FORBIDDEN, "origin %s is not allowed\r\n", header_origin);
+  const GDialOriginCacheEntry *origin_decision = NULL;
+  if (header_origin) {
+    origin_decision = gdial_rest_server_lookup_origin(gdial_rest_server_get_instance_private(gdial_rest_server), route.app_registry, header_origin);
+    if (!origin_decision->is_allowed) {
+      gdial_rest_server_http_print_and_return_if_fail(FALSE, msg, SOUP_STATUS_FORBIDDEN, "origin %s is not allowed\r\n", header_origin);
+    }
   }
 
-  if(!gdial_rest_server_is_app_registered(gdial_rest_server, app_name)) {
+  if(route.app_registry == NULL) {
     /*
      * Any request only respond to app name that is among registered apps
      */
@@ -794,127 +1086,55 @@ static void gdial_rest_http_server_apps_callback(SoupServer *server,
     gdial_rest_server_http_return_if_fail(FALSE, msg, SOUP_STATUS_NOT_FOUND);
   }
 
-  /*
-   * element_num == 2:
-   *   apps/Netflix
-   *
-   * element_num == 3:
-   *   apps/Netflix/run
-   *   apps/Netflix/12345
-   *   apps/Netflix/dial_data
-   *
-   * element_num == 4:
-   *   apps/Netflix/run/hide
-   *   apps/Netflix/12345/hide
-   */
-  if (element_num == 2) {
-    // URL ends with app name
-    g_print("app_name is %s\r\n", app_name);
-    if (!header_host || !gdial_rest_server_is_allowed_origin(gdial_rest_server, header_origin, app_name)) {
-      gdial_rest_server_http_return_if_fail(FALSE, msg, SOUP_STATUS_FORBIDDEN);
-    }
-    else if (msg->method == SOUP_METHOD_OPTIONS) {
-      gdial_rest_server_handle_OPTIONS(msg, "GET, POST, OPTIONS");
-    }
-    else if (msg->method == SOUP_METHOD_POST) {
-      gdial_rest_server_handle_POST(gdial_rest_server, msg, query, app_name);
-    }
-    else if (msg->method == SOUP_METHOD_GET) {
-      /*
-       * GET_app will get app state...there is no instance_id in URL
-       */
-      gdial_rest_server_handle_GET_app(gdial_rest_server, msg, query, app_name, GDIAL_APP_INSTANCE_NULL);
-    }
-    else {
-      gdial_rest_server_http_return_if_fail(FALSE, msg, SOUP_STATUS_NOT_IMPLEMENTED);
-    }
+  g_print("app_name is %s, instance is %s\r\n", route.app_name, route.instance ? route.instance : "");
+  if (route.type == GDIAL_REST_ROUTE_APP_DIAL_DATA) {
+    // URL ends with dial_data, only accepted when originating from localhost
+    GSocketAddress *remote_address = soup_client_context_get_remote_address(client);
+    GError *error = NULL;
+    struct sockaddr_in saddr;
+    gdial_rest_server_http_return_if_fail(remote_address && g_socket_address_to_native(remote_address, &saddr, sizeof(saddr), &error) && !error, msg, SOUP_STATUS_INTERNAL_SERVER_ERROR);
+    gdial_rest_server_http_return_if_fail(saddr.sin_addr.s_addr == htonl(INADDR_LOOPBACK), msg, SOUP_STATUS_INTERNAL_SERVER_ERROR);
   }
-  else if (element_num == 3) {
-    if (g_strcmp0(last_elem, &GDIAL_REST_HTTP_DIAL_DATA_URI[1]) ==0) {
-      // URL ends with dial_data, only accepted when originating from localhost
-      g_print("for [%s] app_name is %s\r\n", last_elem, app_name);
-      GSocketAddress *remote_address = soup_client_context_get_remote_address(client);
-      GError *error = NULL;
-      struct sockaddr_in saddr;
-      gdial_rest_server_http_return_if_fail(remote_address && g_socket_address_to_native(remote_address, &saddr, sizeof(saddr), &error) && !error, msg, SOUP_STATUS_INTERNAL_SERVER_ERROR);
-      gdial_rest_server_http_return_if_fail(saddr.sin_addr.s_addr == htonl(INADDR_LOOPBACK), msg, SOUP_STATUS_INTERNAL_SERVER_ERROR);
-
-      if (msg->method == SOUP_METHOD_OPTIONS) {
-        gdial_rest_server_handle_OPTIONS(msg, "POST, OPTIONS");
-      }
-      else {
-        gdial_rest_server_http_return_if_fail(msg->method == SOUP_METHOD_POST, msg, SOUP_STATUS_NOT_IMPLEMENTED);
-      }
+  gdial_rest_server_dispatch(gdial_rest_routes, server, gdial_rest_server, msg, query, client, &route);
+  if (origin_decision && SOUP_STATUS_IS_SUCCESSFUL(msg->status_code)) {
+    /* CORS header of every successful /apps response comes from the cached decision */
+    if (origin_decision->allow_origin) {
+      soup_message_headers_replace(msg->response_headers, "Access-Control-Allow-Origin", origin_decision->allow_origin);
     }
     else {
-      // URL ends with .../run or some app specific instance Id .../<instance_id>
-      g_print("for instance [%s] app_name is %s\r\n", last_elem, app_name);
-      if (!header_host || !gdial_rest_server_is_allowed_origin(gdial_rest_server, header_origin, app_name)) {
-        gdial_rest_server_http_return_if_fail(FALSE, msg, SOUP_STATUS_FORBIDDEN);
-      }
-      else if (msg->method == SOUP_METHOD_OPTIONS) {
-        gdial_rest_server_handle_OPTIONS(msg, "DELETE, OPTIONS");
-      }
-      else if (msg->method == SOUP_METHOD_DELETE) {
-        GDialApp *app = gdial_app_find_instance_by_name(app_name);
-        GDialApp *app_by_instance = gdial_rest_server_check_instance(app, instance);
-        if (app_by_instance) {
-          gdial_rest_server_handle_DELETE(msg, query, app);
-        }
-        else {
-          g_printerr("app to delete is not found\r\n");
-          gdial_soup_message_set_http_error(msg, SOUP_STATUS_NOT_FOUND);
-        }
-      }
-      else if (msg->method == SOUP_METHOD_POST) {
-          gdial_soup_message_set_http_error(msg, SOUP_STATUS_NOT_FOUND);
-      }
-      else {
-        gdial_rest_server_http_return_if_fail(FALSE, msg, SOUP_STATUS_NOT_IMPLEMENTED);
-      }
+      soup_message_headers_remove(msg->response_headers, "Access-Control-Allow-Origin");
     }
   }
-  else if (element_num == 4) {
-    if (g_strcmp0(last_elem, &GDIAL_REST_HTTP_HIDE_URI[1]) == 0) {
-      // URL ends with hide
-      g_print("for [%s] app_name is %s, instance is %s\r\n", last_elem, app_name, instance);
-      if (msg->method == SOUP_METHOD_OPTIONS) {
-        gdial_rest_server_handle_OPTIONS(msg, "POST, OPTIONS");
-      }
-      else if (msg->method == SOUP_METHOD_POST) {
-
-        GDialApp *app = gdial_app_find_instance_by_name(app_name);
-        GDialApp *app_by_instance = gdial_rest_server_check_instance(app, instance);
-        if (app_by_instance) {
-          gdial_rest_server_handle_POST_hide(msg, app);
-        }
-        else {
-          g_printerr("app to hide is not found\r\n");
-          gdial_rest_server_http_return_if_fail(FALSE, msg, SOUP_STATUS_NOT_FOUND);
-        }
-      }
-      else if (msg->method == SOUP_METHOD_DELETE) {
-        gdial_rest_server_http_return_if_fail(msg->method == SOUP_METHOD_POST, msg, SOUP_STATUS_NOT_FOUND);
-      }
-      else {
-        gdial_rest_server_http_return_if_fail(msg->method == SOUP_METHOD_POST, msg, SOUP_STATUS_NOT_IMPLEMENTED);
-      }
-    }
-    else {
-      invalid_uri = TRUE;
-    }
-  }
-
-  gdial_rest_server_http_return_if_fail(!invalid_uri, msg, SOUP_STATUS_NOT_IMPLEMENTED);
 }
 
 static void gdial_rest_server_dispose(GObject *object) {
   GDialRestServerPrivate *priv = gdial_rest_server_get_instance_private(GDIAL_REST_SERVER(object));
-  soup_server_remove_handler(priv->soup_instance, GDIAL_REST_HTTP_APPS_URI);
-  g_object_unref(priv->soup_instance);
-  g_object_unref(priv->local_soup_instance);
-  while (priv->registered_apps) {
-    priv->registered_apps = gdial_rest_server_registered_apps_remove_and_free(priv->registered_apps, priv->registered_apps);
+  /* answer whatever is still waiting while the servers are around */
+  while (!g_queue_is_empty(&priv->state_waiters)) {
+    gdial_rest_state_waiter_complete((GDialRestStateWaiter *)g_queue_peek_head(&priv->state_waiters), SOUP_STATUS_NONE);
+  }
+  if (priv->timer_wheel) {
+    gdial_timer_wheel_free(priv->timer_wheel);
+    priv->timer_wheel = NULL;
+  }
+  if (priv->soup_instances) {
+    for (guint i = 0; i < priv->soup_instances->len; i++) {
+      soup_server_remove_handler(g_ptr_array_index(priv->soup_instances, i), GDIAL_REST_HTTP_APPS_URI);
+    }
+    g_ptr_array_free(priv->soup_instances, TRUE);
+    priv->soup_instances = NULL;
+  }
+  g_clear_object(&priv->local_soup_instance);
+  if (priv->registered_apps) {
+    g_hash_table_destroy(priv->registered_apps);
+    priv->registered_apps = NULL;
+  }
+  gdial_trie_free(priv->registered_app_prefixes);
+  priv->registered_app_prefixes = NULL;
+  if (priv->origin_cache) {
+    gdial_rest_server_origin_cache_clear(priv);
+    g_hash_table_destroy(priv->origin_cache);
+    priv->origin_cache = NULL;
   }
   G_OBJECT_CLASS (gdial_rest_server_parent_class)->dispose (object);
 }
@@ -924,7 +1144,8 @@ static void gdial_rest_server_get_property (GObject *object, guint property_id,
 
   switch (property_id) {
     case PROP_SOUP_INSTANCE:
-      g_value_set_object(value, priv->soup_instance);
+      /* the first one, the others are added with gdial_rest_server_add_soup_instance() */
+      g_value_set_object(value, priv->soup_instances->len ? g_ptr_array_index(priv->soup_instances, 0) : NULL);
       break;
     case PROP_LOCAL_SOUP_INSTANCE:
       g_value_set_object(value, priv->local_soup_instance);
@@ -941,23 +1162,23 @@ static void gdial_rest_server_set_property (GObject *object, guint property_id,
 
   switch (property_id) {
     case PROP_SOUP_INSTANCE:
-      priv->soup_instance = g_value_get_object(value);
+      if (g_value_get_object(value)) gdial_rest_server_add_soup_instance(self, g_value_get_object(value));
       break;
     case PROP_LOCAL_SOUP_INSTANCE:
       priv->local_soup_instance = g_value_get_object(value);
       break;
     case PROP_ENABLE:
-      if(priv->soup_instance)
-      {
-          if(g_value_get_boolean(value))
+      priv->enabled = g_value_get_boolean(value);
+      g_print("gdial_rest_server_set_property %s handler\n", priv->enabled ? "add" : "remove");
+      for (guint i = 0; i < priv->soup_instances->len; i++) {
+          SoupServer *soup_instance = g_ptr_array_index(priv->soup_instances, i);
+          if(priv->enabled)
           {
-              g_print("gdial_rest_server_set_property add handler\n");
-              soup_server_add_handler(priv->soup_instance, GDIAL_REST_HTTP_APPS_URI, gdial_rest_http_server_apps_callback, object, NULL);
+              soup_server_add_handler(soup_instance, GDIAL_REST_HTTP_APPS_URI, gdial_rest_http_server_apps_callback, object, NULL);
           }
           else
           {
-              g_print("gdial_rest_server_set_property remove handler\n");
-              soup_server_remove_handler(priv->soup_instance, GDIAL_REST_HTTP_APPS_URI);
+              soup_server_remove_handler(soup_instance, GDIAL_REST_HTTP_APPS_URI);
           }
       }
       break;
@@ -1021,24 +1242,40 @@ static void gdial_rest_server_class_init(GDialRestServerClass *klass) {
 
 static void gdial_rest_server_init(GDialRestServer *self) {
   GDialRestServerPrivate *priv = gdial_rest_server_get_instance_private(self);
-  priv->registered_apps = NULL;
+  priv->registered_apps = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, gdial_rest_server_app_registry_free);
+  priv->registered_app_prefixes = gdial_trie_new();
+  priv->origin_cache = g_hash_table_new_full(gdial_origin_cache_entry_hash, gdial_origin_cache_entry_equal, NULL, gdial_origin_cache_entry_free);
+  g_queue_init(&priv->origin_lru);
+  g_queue_init(&priv->state_waiters);
+  priv->soup_instances = g_ptr_array_new_with_free_func(g_object_unref);
+  priv->timer_wheel = gdial_timer_wheel_new(GDIAL_REST_STATE_WAIT_TICK_MS, GDIAL_REST_STATE_WAIT_SLOTS);
 }
 
 GDialRestServer *gdial_rest_server_new(SoupServer *rest_http_server,SoupServer * local_rest_http_server) {
   g_return_val_if_fail(rest_http_server != NULL, NULL);
   g_return_val_if_fail(local_rest_http_server != NULL, NULL);
   g_object_ref(local_rest_http_server);
-  g_object_ref(rest_http_server);
   gpointer object = g_object_new(GDIAL_TYPE_REST_SERVER, GDIAL_REST_SERVER_SOUP_INSTANCE, rest_http_server,GDIAL_LOCAL_REST_SERVER_SOUP_INSTANCE,local_rest_http_server, NULL);
 
-  soup_server_add_handler(rest_http_server, "/apps/system", gdial_rest_http_server_system_callback, object, NULL);
-
   g_print("gdial_local_rest_http_server_callback add handler\n");
 
   soup_server_add_handler(local_rest_http_server, GDIAL_REST_HTTP_APPS_URI, gdial_local_rest_http_server_callback, object, NULL);
   return object;
 }
 
+void gdial_rest_server_add_soup_instance(GDialRestServer *self, SoupServer *rest_http_server) {
+  g_return_if_fail(self != NULL && rest_http_server != NULL);
+  GDialRestServerPrivate *priv = gdial_rest_server_get_instance_private(self);
+  for (guint i = 0; i < priv->soup_instances->len; i++) {
+    if (g_ptr_array_index(priv->soup_instances, i) == rest_http_server) return;
+  }
+  g_ptr_array_add(priv->soup_instances, g_object_ref(rest_http_server));
+  soup_server_add_handler(rest_http_server, "/apps/system", gdial_rest_http_server_system_callback, self, NULL);
+  if (priv->enabled) {
+    soup_server_add_handler(rest_http_server, GDIAL_REST_HTTP_APPS_URI, gdial_rest_http_server_apps_callback, self, NULL);
+  }
+}
+
 gboolean gdial_rest_server_register_app(GDialRestServer *self, const gchar *app_name, const GList *app_prefixes, gboolean is_singleton, gboolean use_additional_data, const GList *allowed_origins) {
 
   g_return_val_if_fail(self != NULL && app_name != NULL, FALSE);
@@ -1048,7 +1285,7 @@ gboolean gdial_rest_server_register_app(GDialRestServer *self, const gchar *app_
   g_return_val_if_fail(is_singleton, FALSE);
 
   GDialRestServerPrivate *priv = gdial_rest_server_get_instance_private(self);
-  if (g_list_find_custom(priv->registered_apps, app_name, GCompareFunc_match_registry_app_name) != NULL) {
+  if (gdial_rest_server_find_app_registry(self, app_name) != NULL) {
    /*
     * Do not support duplicate registration with different param
     *
@@ -1068,22 +1305,39 @@ gboolean gdial_rest_server_register_app(GDialRestServer *self, const gchar *app_
     }
     app_prefixes = app_prefixes->next;
   }
+  app_registry->allowed_origins_index = gdial_trie_new();
   while (allowed_origins) {
     app_registry->allowed_origins = g_list_prepend(app_registry->allowed_origins, g_strdup(allowed_origins->data));
+    if (allowed_origins->data == NULL || strlen(allowed_origins->data) == 0) {
+      /* an empty entry is a suffix of every origin */
+      app_registry->allow_any_origin = TRUE;
+    }
+    else {
+      gdial_trie_insert_reversed(app_registry->allowed_origins_index, allowed_origins->data, app_registry);
+    }
     allowed_origins = allowed_origins->next;
   }
-  priv->registered_apps = g_list_prepend(priv->registered_apps, app_registry);
+  g_hash_table_insert(priv->registered_apps, app_registry->name, app_registry);
+  gdial_rest_server_index_app_prefixes(priv, app_registry);
+  gdial_rest_server_origin_cache_clear(priv);
 
   /*
    * when an app is registered, we also check if it is already running
    * @TODO
    */
 
-  g_return_val_if_fail(priv->registered_apps != NULL, FALSE);
   g_return_val_if_fail(gdial_rest_server_is_app_registered(self, app_name), FALSE);
   return TRUE;
 }
 
+gboolean gdial_rest_server_set_app_state_wait(GDialRestServer *self, const gchar *app_name, guint wait_ms) {
+  g_return_val_if_fail(self != NULL && app_name != NULL, FALSE);
+  GDialAppRegistry *app_registry = gdial_rest_server_find_app_registry(self, app_name);
+  g_return_val_if_fail(app_registry != NULL, FALSE);
+  app_registry->state_wait_ms = wait_ms;
+  return TRUE;
+}
+
 gboolean gdial_rest_server_is_app_registered(GDialRestServer *self, const gchar *app_name) {
   return gdial_rest_server_find_app_registry(self, app_name) != NULL;
 }
@@ -1091,9 +1345,18 @@ gboolean gdial_rest_server_is_app_registered(GDialRestServer *self, const gchar
 gboolean gdial_rest_server_unregister_app(GDialRestServer *self, const gchar *app_name) {
   g_return_val_if_fail(self != NULL && app_name != NULL, FALSE);
   GDialRestServerPrivate *priv = gdial_rest_server_get_instance_private(self);
-  GList *found = g_list_find_custom(priv->registered_apps, app_name, GCompareFunc_match_registry_app_name);
-  if (found == NULL) return FALSE;
-  priv->registered_apps = gdial_rest_server_registered_apps_remove_and_free(priv->registered_apps, found);
+  GDialAppRegistry *app_registry = gdial_rest_server_find_app_registry(self, app_name);
+  if (app_registry == NULL) return FALSE;
+  gdial_rest_server_origin_cache_clear(priv);
+  g_hash_table_remove(priv->registered_apps, app_registry->name);
+  /* unregistration is rare, rebuild the prefix index from what is left */
+  gdial_trie_remove_all(priv->registered_app_prefixes);
+  GHashTableIter iter;
+  gpointer value;
+  g_hash_table_iter_init(&iter, priv->registered_apps);
+  while (g_hash_table_iter_next(&iter, NULL, &value)) {
+    gdial_rest_server_index_app_prefixes(priv, (GDialAppRegistry *)value);
+  }
   return TRUE;
 }
 
@@ -1168,31 +1431,31 @@ GDIAL_STATIC_INLINE void *GET_APP_response_builder_set_additionalData(void *buil
 
 GDIAL_STATIC_INLINE gchar *GET_APP_response_builder_build(void *builder, gsize *length) {
   GDialServerResponseBuilderGetApp * rbuilder = (GDialServerResponseBuilderGetApp *)builder;
-  GString *rbuf = g_string_new_len('\0', 128);
-  gsize options_length = 0;
-  gchar *options_str = gdial_util_str_str_hashtable_to_xml_string(rbuilder->options, &options_length);
-
-  g_string_append_printf(rbuf, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n");
-  g_string_append_printf(rbuf, "<service xmlns=\"%s\" dialVer=\"%s\">\r\n", GDIAL_PROTOCOL_XMLNS_SCHEMA, rbuilder->dialVer);
-  g_string_append_printf(rbuf, "  <name>%s</name>\r\n", rbuilder->app_name);
-  if (options_str) {
-  g_string_append_printf(rbuf, "  <options %s/>\r\n", options_str);
-  g_free(options_str);
-  }
-  g_string_append_printf(rbuf, "  <state>%s</state>\r\n", gdial_app_state_to_string(rbuilder->state));
+  GDialXmlWriter writer;
+  gdial_xml_writer_init(&writer, GDIAL_APP_STATE_RESPONSE_SIZE_HINT);
+  gdial_xml_writer_start_element(&writer, "service");
+  gdial_xml_writer_attribute(&writer, "xmlns", GDIAL_PROTOCOL_XMLNS_SCHEMA);
+  gdial_xml_writer_attribute(&writer, "dialVer", rbuilder->dialVer);
+  gdial_xml_writer_element(&writer, "name", rbuilder->app_name);
+  gdial_xml_writer_start_element(&writer, "options");
+  GHashTableIter iter;
+  gpointer key, value;
+  g_hash_table_iter_init(&iter, rbuilder->options);
+  while (g_hash_table_iter_next(&iter, &key, &value)) {
+    gdial_xml_writer_attribute(&writer, (const gchar *)key, (const gchar *)value);
+  }
+  gdial_xml_writer_end_element(&writer);
+  gdial_xml_writer_element(&writer, "state", gdial_app_state_to_string(rbuilder->state));
   if (rbuilder->state != GDIAL_APP_STATE_STOPPED) {
-  g_string_append_printf(rbuf, "  <link rel=\"run\" href=\"%s\"/>\r\n", rbuilder->link_href);
+    gdial_xml_writer_start_element(&writer, "link");
+    gdial_xml_writer_attribute(&writer, "rel", "run");
+    gdial_xml_writer_attribute(&writer, "href", rbuilder->link_href);
+    gdial_xml_writer_end_element(&writer);
   }
   if (rbuilder->additionalData) {
-  g_string_append_printf(rbuf, "  <additionalData>%s</additionalData>\r\n", "");
-  }
-  g_string_append_printf(rbuf, "</service>\r\n");
-
-  if (length) {
-    *length = rbuf->len;
+    gdial_xml_writer_element(&writer, "additionalData", NULL);
   }
-
-  return g_string_free(rbuf, FALSE);
+  return gdial_xml_writer_finish(&writer, length);
 }
 
 GDIAL_STATIC_INLINE void GET_APP_response_builder_destroy(void *builder) {
@@ -1206,3 +1469,14 @@ GDIAL_STATIC_INLINE void GET_APP_response_builder_destroy(void *builder) {
 
   g_free(builder);
 }
+
+void gdial_rest_server_dump_stats(void) {
+  GDialPlatIpcStats ipc;
+  gdial_plat_get_ipc_stats(&ipc);
+  g_print("rest: apps requests=%" G_GUINT64_FORMAT " ipc=%" G_GUINT64_FORMAT " (%.2f per request)\r\n",
+    apps_requests_, ipc.notifies, apps_requests_ ? (gdouble)ipc.notifies / apps_requests_ : 0.0);
+  g_print("rest: app state queries=%" G_GUINT64_FORMAT " refreshes=%" G_GUINT64_FORMAT " pushed updates=%" G_GUINT64_FORMAT "\r\n",
+    ipc.state_queries, ipc.state_refreshes, ipc.state_updates);
+  g_print("rest: state waits confirmed=%" G_GUINT64_FORMAT " failed=%" G_GUINT64_FORMAT " timed out=%" G_GUINT64_FORMAT "\r\n",
+    state_waits_confirmed_, state_waits_failed_, state_waits_timed_out_);
+}
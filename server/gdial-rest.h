@@ -26,6 +26,7 @@
 
 #include "gdial-config.h"
 #include "gdial-app.h"
+#include "gdial-arena.h"
 
 G_BEGIN_DECLS
 
@@ -39,16 +40,61 @@ struct _GDialRestServer {
 };
 
 GDialRestServer *gdial_rest_server_new(SoupServer *rest_http_server,SoupServer *local_rest_http_server);
+/*
+ * Serve the same apps on another server, one per interface so that an
+ * address change only rebinds the listener of that interface. Adding a
+ * server twice does nothing.
+ */
+void gdial_rest_server_add_soup_instance(GDialRestServer *self, SoupServer *rest_http_server);
 gboolean gdial_rest_server_register_app(GDialRestServer *self, const gchar *app_name, const GList *app_prefixes, gboolean is_singleton, gboolean use_additional_data, const GList *allowed_origin);
 gboolean gdial_rest_server_is_app_registered(GDialRestServer *self, const gchar *app_name);
 gboolean gdial_rest_server_unregister_app(GDialRestServer *self, const gchar *app_name);
+/*
+ * Hold launch, stop and hide requests for @app_name (paused) for up to
+ * @wait_ms until the platform confirms the new state. 0 answers at once.
+ */
+gboolean gdial_rest_server_set_app_state_wait(GDialRestServer *self, const gchar *app_name, guint wait_ms);
 GDialApp *gdial_rest_server_find_app(GDialRestServer *self, const gchar *app_name);
+void gdial_rest_server_dump_stats(void);
 
 typedef struct _GDialAppRegistry GDialAppRegistry;
 
+typedef enum {
+  GDIAL_REST_ROUTE_INVALID = 0,
+  GDIAL_REST_ROUTE_APP,           /* apps/<app> */
+  GDIAL_REST_ROUTE_APP_INSTANCE,  /* apps/<app>/run, apps/<app>/<instance> */
+  GDIAL_REST_ROUTE_APP_DIAL_DATA, /* apps/<app>/dial_data */
+  GDIAL_REST_ROUTE_APP_HIDE,      /* apps/<app>/<instance>/hide */
+  GDIAL_REST_ROUTE_N
+} GDialRestRouteType;
+
+typedef enum {
+  GDIAL_REST_METHOD_OTHER = 0,
+  GDIAL_REST_METHOD_GET,
+  GDIAL_REST_METHOD_POST,
+  GDIAL_REST_METHOD_DELETE,
+  GDIAL_REST_METHOD_OPTIONS,
+  GDIAL_REST_METHOD_N
+} GDialRestMethod;
+
+/*
+ * A routed request path. The elements point into @buffer, which holds the
+ * path with its separators replaced by NUL.
+ */
+typedef struct {
+  GDialRestRouteType type;
+  const gchar *base;
+  const gchar *app_name;
+  const gchar *instance;
+  /* resolved once per request by the callback */
+  GDialAppRegistry *app_registry;
+  gchar buffer[GDIAL_REST_HTTP_MAX_URI_LEN];
+} GDialRestRoute;
+
 GDIAL_STATIC gboolean gdial_rest_server_is_allowed_origin(GDialRestServer *self, const gchar *header_origin, const gchar *app_name);
-GDIAL_STATIC gchar *gdial_rest_server_new_additional_data_url(guint listening_port, const gchar *app_name, gboolean encode);
+GDIAL_STATIC gchar *gdial_rest_server_new_additional_data_url(GDialArena *arena, guint listening_port, const gchar *app_name, gboolean encode);
 GDIAL_STATIC GDialAppRegistry *gdial_rest_server_find_app_registry(GDialRestServer *self, const gchar *app_name);
+GDIAL_STATIC gboolean gdial_rest_server_route_path(const gchar *path, GDialRestRoute *route);
 
 G_END_DECLS
 
@@ -19,49 +19,274 @@
 
 #include <stdio.h>
 #include <glib.h>
-#include <assert.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/tcp.h>
 #include <libsoup/soup.h>
 
 #include "gdial-config.h"
 #include "gdial-debug.h"
+#include "gdial-ratelimit.h"
+#include "gdial-shield.h"
+#include "gdial-timer.h"
 
 typedef struct DialShieldConnectionContext {
+  /* links the context into either the free list or the active list */
+  struct DialShieldConnectionContext *next;
+  struct DialShieldConnectionContext *prev;
+  GDialShield *shield;
+  SoupMessage *msg;
   GSocket *read_gsocket;
-  guint read_timeout_source;
+  GDialTimer read_timer;
+  SoupServer *server;
+  guint32 client_key;
+  GDialTimer throttle_timer;
+  gboolean rejected;
+  GDialTimer budget_timer;
+  guint64 bytes_base;
+  gint64 first_byte_us;
+  /* set while paused by the throttle, no bytes arrive and the byte rate check is off */
+  gint64 throttled_at_us;
+  gboolean headers_done;
+  gboolean closed;
 } DialShieldConnectionContext;
 
-static GHashTable *active_conns_ = NULL;
+/*
+ * A shield is only ever touched from the thread whose main context serves
+ * its SoupServers, so none of this needs locking.
+ */
+struct _GDialShield {
+  gchar *name;
+  GDialTimerWheel *timer_wheel;
+  GSList *conn_slabs;
+  DialShieldConnectionContext *free_conns;
+  DialShieldConnectionContext active_conns;
+  guint active_conns_count;
+  guint half_read_conns;
+  GDialRateLimiter *rate_limiter;
+  gint64 throttle_max_delay_us;
+  GDialShieldStats stats;
+};
+
+static GQuark conn_context_quark_ = 0;
+
+static DialShieldConnectionContext *conn_context_alloc(GDialShield *shield) {
+  if (shield->free_conns == NULL) {
+    DialShieldConnectionContext *slab = g_new(DialShieldConnectionContext, GDIAL_SHIELD_CONN_SLAB_SIZE);
+    int i;
+    for (i = 0; i < GDIAL_SHIELD_CONN_SLAB_SIZE; i++) {
+      slab[i].next = shield->free_conns;
+      shield->free_conns = &slab[i];
+    }
+    shield->conn_slabs = g_slist_prepend(shield->conn_slabs, slab);
+  }
+  DialShieldConnectionContext *conn_context = shield->free_conns;
+  shield->free_conns = conn_context->next;
+  memset(conn_context, 0, sizeof(*conn_context));
+  conn_context->shield = shield;
+
+  conn_context->next = shield->active_conns.next;
+  conn_context->prev = &shield->active_conns;
+  shield->active_conns.next->prev = conn_context;
+  shield->active_conns.next = conn_context;
+  shield->active_conns_count++;
+  shield->half_read_conns++;
+  return conn_context;
+}
+
+static void conn_context_release(gpointer data) {
+  DialShieldConnectionContext *conn_context = (DialShieldConnectionContext *)data;
+  GDialShield *shield = conn_context->shield;
+  if (gdial_timer_is_pending(&conn_context->read_timer)) {
+    g_print_with_timestamp("conn_context_release tid=[%lx] msg=%p read timer removed\r\n",
+      pthread_self(), conn_context->msg);
+  }
+  gdial_timer_cancel(shield->timer_wheel, &conn_context->read_timer);
+  gdial_timer_cancel(shield->timer_wheel, &conn_context->throttle_timer);
+  gdial_timer_cancel(shield->timer_wheel, &conn_context->budget_timer);
+  if (!conn_context->closed) shield->half_read_conns--;
+
+  conn_context->prev->next = conn_context->next;
+  conn_context->next->prev = conn_context->prev;
+  shield->active_conns_count--;
+  conn_context->next = shield->free_conns;
+  shield->free_conns = conn_context;
+}
+
+static DialShieldConnectionContext *soup_message_get_conn_context(SoupMessage *msg) {
+  return (DialShieldConnectionContext *)g_object_get_qdata(G_OBJECT(msg), conn_context_quark_);
+}
 
-static void soup_message_weak_ref_callback(gpointer user_data, GObject *obj);
 static void server_request_remove_callback (SoupMessage *msg) {
-  DialShieldConnectionContext * conn_context = (DialShieldConnectionContext *) g_hash_table_lookup(active_conns_, msg);
+  /*
+   * steal first, the qdata destroy notify only covers messages that are
+   * finalized while still being read.
+   */
+  DialShieldConnectionContext * conn_context = (DialShieldConnectionContext *)g_object_steal_qdata(G_OBJECT(msg), conn_context_quark_);
   if (conn_context) {
-    if (conn_context->read_timeout_source != 0) {
-      g_print_with_timestamp("server_request_remove_callback tid=[%lx] msg=%p timeout source %d removed\r\n",
-        pthread_self(), msg, conn_context->read_timeout_source);
-      g_source_remove(conn_context->read_timeout_source);
+    conn_context_release(conn_context);
+  }
+}
+
+/*
+ * Close a connection whose request is still being read. The context stays
+ * attached until soup reports the abort, but it no longer counts as half-read.
+ */
+static void conn_context_close(DialShieldConnectionContext *conn_context, guint64 *counter, const gchar *reason) {
+  GDialShield *shield = conn_context->shield;
+  if (conn_context->closed) return;
+  conn_context->closed = TRUE;
+  shield->half_read_conns--;
+  (*counter)++;
+  g_print_with_timestamp("conn_context_close tid=[%lx] msg=%p %s\r\n", pthread_self(), conn_context->msg, reason);
+  gdial_timer_cancel(shield->timer_wheel, &conn_context->read_timer);
+  gdial_timer_cancel(shield->timer_wheel, &conn_context->budget_timer);
+  g_socket_close(conn_context->read_gsocket, NULL);//this will trigger abort callback
+  if (gdial_timer_is_pending(&conn_context->throttle_timer)) {
+    /* a paused message does no io and would never notice the close */
+    gdial_timer_cancel(shield->timer_wheel, &conn_context->throttle_timer);
+    soup_server_unpause_message(conn_context->server, conn_context->msg);
+  }
+}
+
+static void soup_message_read_timeout_callback(GDialTimer *timer, gpointer user_data) {
+  DialShieldConnectionContext * conn_context = (DialShieldConnectionContext *)user_data;
+  conn_context_close(conn_context, &conn_context->shield->stats.closed_timeout, "read timeout");
+}
+
+static gboolean conn_context_get_bytes_received(DialShieldConnectionContext *conn_context, guint64 *bytes) {
+  struct tcp_info info;
+  socklen_t len = sizeof(info);
+  memset(&info, 0, sizeof(info));
+  if (getsockopt(g_socket_get_fd(conn_context->read_gsocket), IPPROTO_TCP, TCP_INFO, &info, &len) != 0) {
+    return FALSE;
+  }
+  /* kernels before 4.1 return a shorter struct without the byte counter */
+  if (len < offsetof(struct tcp_info, tcpi_bytes_received) + sizeof(info.tcpi_bytes_received)) {
+    return FALSE;
+  }
+  *bytes = info.tcpi_bytes_received;
+  return TRUE;
+}
+
+/*
+ * Byte budgets, sampled from the kernel's per-socket receive counter on the
+ * timer wheel. A request that has started to arrive must keep up a minimum
+ * byte rate, and its header may not exceed GDIAL_SHIELD_MAX_HEADER_BYTES.
+ * Idle keep-alive connections (nothing received yet) are left to the read timeout.
+ */
+static void soup_message_budget_callback(GDialTimer *timer, gpointer user_data) {
+  DialShieldConnectionContext * conn_context = (DialShieldConnectionContext *)user_data;
+  GDialShield *shield = conn_context->shield;
+  guint64 bytes = 0;
+  if (!conn_context_get_bytes_received(conn_context, &bytes)) {
+    return;
+  }
+  bytes -= conn_context->bytes_base;
+  const gint64 now_us = g_get_monotonic_time();
+
+  if (!conn_context->headers_done && bytes > GDIAL_SHIELD_MAX_HEADER_BYTES) {
+    conn_context_close(conn_context, &shield->stats.closed_oversize, "header budget exceeded");
+    return;
+  }
+  if (bytes > 0 && conn_context->first_byte_us == 0) {
+    conn_context->first_byte_us = now_us;
+  }
+  if (conn_context->first_byte_us != 0) {
+    const gint64 elapsed_us = now_us - conn_context->first_byte_us;
+    if (elapsed_us >= GDIAL_SHIELD_BYTE_RATE_GRACE_MS * G_GINT64_CONSTANT(1000) &&
+        bytes * G_USEC_PER_SEC < (guint64)elapsed_us * GDIAL_SHIELD_MIN_BYTE_RATE) {
+      conn_context_close(conn_context, &shield->stats.closed_slow, "byte rate too low");
+      return;
     }
-    g_hash_table_remove(active_conns_, msg);
-    g_free(conn_context);
   }
+  gdial_timer_schedule(shield->timer_wheel, &conn_context->budget_timer, GDIAL_SHIELD_BUDGET_CHECK_MS, soup_message_budget_callback, conn_context);
 }
 
-static gboolean soup_message_read_timeout_callback(gpointer user_data) {
-  SoupMessage *msg = (SoupMessage*)user_data;
-  DialShieldConnectionContext * conn_context = (DialShieldConnectionContext *)g_hash_table_lookup(active_conns_, msg);
-  g_print_with_timestamp("soup_message_read_timeout_callback tid=[%lx] msg=%p\r\n", pthread_self(), msg);
-  if (conn_context) {
-    conn_context->read_timeout_source = 0;
-    g_socket_close(conn_context->read_gsocket, NULL);//this will trigger abort callback
+static void conn_context_evict_oldest(GDialShield *shield) {
+  /* contexts are added at the head, the oldest half-read one is nearest the tail */
+  DialShieldConnectionContext *conn_context = shield->active_conns.prev;
+  while (conn_context != &shield->active_conns && conn_context->closed) {
+    conn_context = conn_context->prev;
+  }
+  if (conn_context != &shield->active_conns) {
+    conn_context_close(conn_context, &shield->stats.evicted, "half-read limit reached");
   }
-  return G_SOURCE_REMOVE;;
+}
+
+static void soup_message_throttle_release_callback(GDialTimer *timer, gpointer user_data) {
+  DialShieldConnectionContext * conn_context = (DialShieldConnectionContext *)user_data;
+  GDialShield *shield = conn_context->shield;
+  if (conn_context->throttled_at_us) {
+    /* the pause is not charged to the client's byte rate */
+    if (conn_context->first_byte_us) conn_context->first_byte_us += g_get_monotonic_time() - conn_context->throttled_at_us;
+    conn_context->throttled_at_us = 0;
+    gdial_timer_schedule(shield->timer_wheel, &conn_context->budget_timer, GDIAL_SHIELD_BUDGET_CHECK_MS, soup_message_budget_callback, conn_context);
+  }
+  soup_server_unpause_message(conn_context->server, conn_context->msg);
+}
+
+static guint32 soup_client_context_get_throttle_key(SoupClientContext *context) {
+  GSocketAddress *remote_address = soup_client_context_get_remote_address(context);
+  if (remote_address && G_IS_INET_SOCKET_ADDRESS(remote_address)) {
+    GInetAddress *inet_address = g_inet_socket_address_get_address(G_INET_SOCKET_ADDRESS(remote_address));
+    return gdial_rate_limiter_key_from_bytes(g_inet_address_to_bytes(inet_address), g_inet_address_get_native_size(inet_address));
+  }
+  return 0;
+}
+
+/*
+ * Admission runs once the request line and headers are in, so that idle
+ * keep-alive time is not charged to the client. A request over its budget is
+ * paused (not slept on) until its token is due; one that would wait longer than
+ * the configured maximum is answered with 503 instead of reaching the handler.
+ */
+static void soup_message_got_headers_callback(SoupMessage *msg, gpointer user_data) {
+  DialShieldConnectionContext * conn_context = soup_message_get_conn_context(msg);
+  if (!conn_context || conn_context->closed) return;
+  GDialShield *shield = conn_context->shield;
+  conn_context->headers_done = TRUE;
+
+  gint64 wait_us = gdial_rate_limiter_acquire(shield->rate_limiter, conn_context->client_key, g_get_monotonic_time(), shield->throttle_max_delay_us);
+  if (wait_us == 0) {
+    shield->stats.admitted++;
+    return;
+  }
+  if (wait_us == GDIAL_RATE_LIMITER_REJECT) {
+    shield->stats.rejected++;
+    conn_context->rejected = TRUE;
+    return;
+  }
+
+  guint wait_ms = (guint)((wait_us + 999) / 1000);
+  shield->stats.delayed++;
+  shield->stats.delay_ms_total += wait_ms;
+  g_print_with_timestamp("soup_message_got_headers_callback tid=[%lx] msg=%p delayed %u ms\r\n", pthread_self(), msg, wait_ms);
+  if (gdial_timer_is_pending(&conn_context->read_timer)) {
+    /* time spent paused must not count against the read timeout */
+    gdial_timer_schedule(shield->timer_wheel, &conn_context->read_timer, GDIAL_SHIELD_READ_TIMEOUT_MS + wait_ms,
+      soup_message_read_timeout_callback, conn_context);
+  }
+  if (gdial_timer_is_pending(&conn_context->budget_timer)) {
+    gdial_timer_cancel(shield->timer_wheel, &conn_context->budget_timer);
+    conn_context->throttled_at_us = g_get_monotonic_time();
+  }
+  soup_server_pause_message(conn_context->server, msg);
+  gdial_timer_schedule(shield->timer_wheel, &conn_context->throttle_timer, wait_ms, soup_message_throttle_release_callback, conn_context);
 }
 
 
 static void server_request_read_callback (SoupServer *server, SoupMessage *msg,
     SoupClientContext *context, gpointer data) {
   g_print_with_timestamp("server_request_read_callback tid=[%lx] msg=%p\r\n", pthread_self(), msg);
-  g_object_weak_unref(G_OBJECT(msg), (GWeakNotify)soup_message_weak_ref_callback, msg);
+  DialShieldConnectionContext * conn_context = soup_message_get_conn_context(msg);
+  if (conn_context && conn_context->rejected) {
+    /* a status set here keeps soup from calling the handler */
+    soup_message_headers_replace(msg->response_headers, "Retry-After", "1");
+    soup_message_headers_replace(msg->response_headers, "Connection", "close");
+    soup_message_set_status(msg, SOUP_STATUS_SERVICE_UNAVAILABLE);
+  }
   server_request_remove_callback(msg);
 }
 
@@ -72,55 +297,87 @@ static void server_request_finished_callback (SoupServer *server, SoupMessage *m
 static void server_request_aborted_callback (SoupServer *server, SoupMessage *msg,
     SoupClientContext *context, gpointer data) {
   g_print_with_timestamp("server_request_aborted_callback tid=[%lx] msg=%p\r\n", pthread_self(), msg);
-  g_object_weak_unref(G_OBJECT(msg), (GWeakNotify)soup_message_weak_ref_callback, msg);
-  server_request_remove_callback(msg);
-}
-
-static void soup_message_weak_ref_callback(gpointer user_data, GObject *obj) {
-  SoupMessage *msg0=(SoupMessage*)obj;
-  SoupMessage *msg=(SoupMessage*)user_data;
-  assert(msg0==msg);
-  g_print_with_timestamp("soup_message_weak_ref_callback tid=[%lx] msg=%p\r\n", pthread_self(), msg);
   server_request_remove_callback(msg);
 }
 
 static void server_request_started_callback (SoupServer *server, SoupMessage *msg,
     SoupClientContext *context, gpointer data) {
+  GDialShield *shield = (GDialShield *)data;
 
-  static const int throttle = GDIAL_THROTTLE_DELAY_US;
-  DialShieldConnectionContext *conn_context = g_new(DialShieldConnectionContext, 1);
-  guint read_timeout_source = g_timeout_add(2000, (GSourceFunc)soup_message_read_timeout_callback, msg);
+  if (shield->half_read_conns >= GDIAL_SHIELD_MAX_HALF_READ_CONNS) {
+    conn_context_evict_oldest(shield);
+  }
+  DialShieldConnectionContext *conn_context = conn_context_alloc(shield);
+  conn_context->msg = msg;
   conn_context->read_gsocket = soup_client_context_get_gsocket(context);
-  conn_context->read_timeout_source = read_timeout_source;
-  g_print_with_timestamp("server_request_started_callback tid=[%lx] msg=%p timeout source %d added with socket fd = %d\r\n",
-    pthread_self(), msg, read_timeout_source, g_socket_get_fd(conn_context->read_gsocket));
-  g_hash_table_insert(active_conns_, msg, conn_context);
-  g_object_weak_ref(G_OBJECT(msg), (GWeakNotify)soup_message_weak_ref_callback, msg);
-  usleep(throttle);
-}
-
-void gdial_shield_init(void) {
-  active_conns_ = g_hash_table_new(g_direct_hash, g_direct_equal);
-}
-
-void gdial_shield_server(SoupServer *server) {
-  g_return_if_fail(server != NULL);
-  g_signal_connect(server, "request_started", G_CALLBACK(server_request_started_callback),  NULL);
-  g_signal_connect(server, "request_read",    G_CALLBACK(server_request_read_callback),     NULL);
-  g_signal_connect(server, "request_finished",G_CALLBACK(server_request_finished_callback), NULL);
-  g_signal_connect(server, "request_aborted", G_CALLBACK(server_request_aborted_callback),  NULL);
-}
-
-void gdial_shield_term(void) {
-  GHashTableIter iter;
-  gpointer key, value;
-  printf("gdial_shield_term: hash_table_size start= %d\r\n", g_hash_table_size(active_conns_));
-  g_hash_table_iter_init(&iter, (GHashTable *)active_conns_);
-  while (g_hash_table_iter_next(&iter, &key, &value)) {
-    SoupMessage *msg = (SoupMessage *)key;
-    server_request_remove_callback(msg);
-  }
-  printf("gdial_shield_term: hash_table_size end= %d\r\n", g_hash_table_size(active_conns_));
-  g_hash_table_unref(active_conns_);
-  active_conns_ = NULL;
+  conn_context->server = server;
+  conn_context->client_key = soup_client_context_get_throttle_key(context);
+  gdial_timer_schedule(shield->timer_wheel, &conn_context->read_timer, GDIAL_SHIELD_READ_TIMEOUT_MS, soup_message_read_timeout_callback, conn_context);
+  if (conn_context_get_bytes_received(conn_context, &conn_context->bytes_base)) {
+    gdial_timer_schedule(shield->timer_wheel, &conn_context->budget_timer, GDIAL_SHIELD_BUDGET_CHECK_MS, soup_message_budget_callback, conn_context);
+  }
+  g_print_with_timestamp("server_request_started_callback tid=[%lx] msg=%p read timer added with socket fd = %d\r\n",
+    pthread_self(), msg, g_socket_get_fd(conn_context->read_gsocket));
+  /* the destroy notify releases the context should the message go away unread */
+  g_object_set_qdata_full(G_OBJECT(msg), conn_context_quark_, conn_context, conn_context_release);
+  g_signal_connect(msg, "got-headers", G_CALLBACK(soup_message_got_headers_callback), NULL);
+}
+
+GDialShield *gdial_shield_new(const gchar *name) {
+  if (conn_context_quark_ == 0) {
+    conn_context_quark_ = g_quark_from_static_string("gdial-shield-conn-context");
+  }
+  GDialShield *shield = g_new0(GDialShield, 1);
+  shield->name = g_strdup(name);
+  shield->active_conns.next = shield->active_conns.prev = &shield->active_conns;
+  shield->timer_wheel = gdial_timer_wheel_new(GDIAL_SHIELD_TIMER_TICK_MS, GDIAL_SHIELD_TIMER_SLOTS);
+  shield->rate_limiter = gdial_rate_limiter_new(GDIAL_THROTTLE_RATE_DEFAULT, GDIAL_THROTTLE_BURST_DEFAULT, GDIAL_THROTTLE_MAX_CLIENTS);
+  shield->throttle_max_delay_us = GDIAL_THROTTLE_MAX_DELAY_MS_DEFAULT * G_GINT64_CONSTANT(1000);
+  return shield;
+}
+
+void gdial_shield_set_throttle(GDialShield *shield, guint rate, guint burst, guint max_delay_ms) {
+  g_return_if_fail(shield != NULL);
+  g_print("gdial_shield_set_throttle %s rate=%u/s burst=%u max_delay=%ums\r\n", shield->name, rate, burst, max_delay_ms);
+  gdial_rate_limiter_set(shield->rate_limiter, rate, burst);
+  shield->throttle_max_delay_us = max_delay_ms * G_GINT64_CONSTANT(1000);
+}
+
+void gdial_shield_get_stats(GDialShield *shield, GDialShieldStats *stats) {
+  g_return_if_fail(shield != NULL && stats != NULL);
+  *stats = shield->stats;
+  stats->clients = gdial_rate_limiter_size(shield->rate_limiter);
+  stats->half_read = shield->half_read_conns;
+}
+
+void gdial_shield_dump_stats(GDialShield *shield) {
+  GDialShieldStats stats;
+  gdial_shield_get_stats(shield, &stats);
+  g_print("shield[%s]: admitted=%" G_GUINT64_FORMAT " delayed=%" G_GUINT64_FORMAT " rejected=%" G_GUINT64_FORMAT " delay_total=%" G_GUINT64_FORMAT "ms clients=%u\r\n",
+    shield->name, stats.admitted, stats.delayed, stats.rejected, stats.delay_ms_total, stats.clients);
+  g_print("shield[%s]: closed timeout=%" G_GUINT64_FORMAT " slow=%" G_GUINT64_FORMAT " oversize=%" G_GUINT64_FORMAT " evicted=%" G_GUINT64_FORMAT " half_read=%u\r\n",
+    shield->name, stats.closed_timeout, stats.closed_slow, stats.closed_oversize, stats.evicted, stats.half_read);
+}
+
+void gdial_shield_server(GDialShield *shield, SoupServer *server) {
+  g_return_if_fail(shield != NULL && server != NULL);
+  g_signal_connect(server, "request_started", G_CALLBACK(server_request_started_callback),  shield);
+  g_signal_connect(server, "request_read",    G_CALLBACK(server_request_read_callback),     shield);
+  g_signal_connect(server, "request_finished",G_CALLBACK(server_request_finished_callback), shield);
+  g_signal_connect(server, "request_aborted", G_CALLBACK(server_request_aborted_callback),  shield);
+}
+
+void gdial_shield_free(GDialShield *shield) {
+  if (shield == NULL) return;
+  printf("gdial_shield_free: %s active connections start= %u\r\n", shield->name, shield->active_conns_count);
+  while (shield->active_conns.next != &shield->active_conns) {
+    server_request_remove_callback(shield->active_conns.next->msg);
+  }
+  printf("gdial_shield_free: %s active connections end= %u\r\n", shield->name, shield->active_conns_count);
+  g_slist_free_full(shield->conn_slabs, g_free);
+  gdial_timer_wheel_free(shield->timer_wheel);
+  gdial_shield_dump_stats(shield);
+  gdial_rate_limiter_free(shield->rate_limiter);
+  g_free(shield->name);
+  g_free(shield);
 }
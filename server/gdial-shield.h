@@ -23,8 +23,31 @@
 #include <libsoup/soup.h>
 #include "gdial-config.h"
 
-void gdial_shield_init(void);
-void gdial_shield_server(SoupServer *server);
-void gdial_shield_term(void);
+typedef struct {
+  guint64 admitted;
+  guint64 delayed;
+  guint64 rejected;
+  guint64 delay_ms_total;
+  guint clients;
+  /* connections closed before their request was read */
+  guint64 closed_timeout;
+  guint64 closed_slow;
+  guint64 closed_oversize;
+  guint64 evicted;
+  guint half_read;
+} GDialShieldStats;
+
+/*
+ * Connection guard for SoupServers. A shield and the servers it guards must
+ * all run on the thread-default main context the shield was created on.
+ */
+typedef struct _GDialShield GDialShield;
+
+GDialShield *gdial_shield_new(const gchar *name);
+void gdial_shield_server(GDialShield *shield, SoupServer *server);
+void gdial_shield_free(GDialShield *shield);
+void gdial_shield_set_throttle(GDialShield *shield, guint rate, guint burst, guint max_delay_ms);
+void gdial_shield_get_stats(GDialShield *shield, GDialShieldStats *stats);
+void gdial_shield_dump_stats(GDialShield *shield);
 
 #endif
@@ -0,0 +1,67 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "gdial-ssdp-announcer.h"
+
+void gdial_ssdp_announcer_init(GDialSsdpAnnouncer *announcer, guint burst_count, guint burst_interval_ms, guint steady_interval_ms) {
+  g_return_if_fail(announcer != NULL);
+  memset(announcer, 0, sizeof(*announcer));
+  announcer->burst_count = MAX(burst_count, 1);
+  announcer->burst_interval_ms = MAX(burst_interval_ms, 1);
+  announcer->steady_interval_ms = MAX(steady_interval_ms, announcer->burst_interval_ms);
+}
+
+void gdial_ssdp_announcer_activate(GDialSsdpAnnouncer *announcer, gint64 now_ms) {
+  g_return_if_fail(announcer != NULL);
+  announcer->active = TRUE;
+  announcer->burst_left = announcer->burst_count;
+  announcer->interval_ms = announcer->burst_interval_ms;
+  announcer->due_ms = now_ms;
+  announcer->stats.bursts++;
+}
+
+gboolean gdial_ssdp_announcer_deactivate(GDialSsdpAnnouncer *announcer) {
+  g_return_val_if_fail(announcer != NULL, FALSE);
+  if (!announcer->active) return FALSE;
+  announcer->active = FALSE;
+  announcer->stats.byebye_sent++;
+  return TRUE;
+}
+
+gboolean gdial_ssdp_announcer_poll(GDialSsdpAnnouncer *announcer, gint64 now_ms) {
+  g_return_val_if_fail(announcer != NULL, FALSE);
+  if (!announcer->active || now_ms < announcer->due_ms) return FALSE;
+
+  if (announcer->burst_left) {
+    announcer->burst_left--;
+  }
+  if (announcer->burst_left == 0) {
+    /* backing off, doubling up to the steady interval */
+    announcer->interval_ms = MIN(announcer->interval_ms * 2, announcer->steady_interval_ms);
+  }
+  /*
+   * scheduled from now rather than from due_ms, so that a stalled loop
+   * does not produce a catch-up burst
+   */
+  announcer->due_ms = now_ms + announcer->interval_ms;
+  announcer->stats.alive_sent++;
+  return TRUE;
+}
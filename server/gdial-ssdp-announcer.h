@@ -0,0 +1,71 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GDIAL_SSDP_ANNOUNCER_H_
+#define GDIAL_SSDP_ANNOUNCER_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * NOTIFY schedule: a burst of ssdp:alive right after activation (or after the
+ * description changed), then exponential backoff up to a steady interval.
+ * The announcer owns no timers and reads no clock; the caller passes the
+ * current time in ms and arms its own timer for the returned due time, so
+ * the schedule can be driven by a virtual clock.
+ */
+typedef struct {
+  guint64 alive_sent;
+  guint64 byebye_sent;
+  guint64 bursts;
+} GDialSsdpAnnouncerStats;
+
+typedef struct {
+  /*< private >*/
+  guint burst_count;
+  guint burst_interval_ms;
+  guint steady_interval_ms;
+  gboolean active;
+  guint burst_left;
+  guint interval_ms;
+  gint64 due_ms;
+  GDialSsdpAnnouncerStats stats;
+} GDialSsdpAnnouncer;
+
+void gdial_ssdp_announcer_init(GDialSsdpAnnouncer *announcer, guint burst_count, guint burst_interval_ms, guint steady_interval_ms);
+/*
+ * Start (or restart) the activation burst, the first alive is due at @now_ms.
+ */
+void gdial_ssdp_announcer_activate(GDialSsdpAnnouncer *announcer, gint64 now_ms);
+/*
+ * Returns TRUE if a byebye must be sent, i.e. the announcer was active.
+ */
+gboolean gdial_ssdp_announcer_deactivate(GDialSsdpAnnouncer *announcer);
+/*
+ * Returns TRUE if an alive is due at @now_ms and advances the schedule.
+ */
+gboolean gdial_ssdp_announcer_poll(GDialSsdpAnnouncer *announcer, gint64 now_ms);
+/*
+ * next due time in ms, or -1 when inactive
+ */
+#define gdial_ssdp_announcer_due_ms(announcer) ((announcer)->active ? (announcer)->due_ms : -1)
+
+G_END_DECLS
+#endif
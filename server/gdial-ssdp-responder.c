@@ -0,0 +1,666 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/filter.h>
+#include <glib.h>
+#include <glib-unix.h>
+#include <gio/gio.h>
+
+#include "gdial-config.h"
+#include "gdial-ratelimit.h"
+#include "gdial-ssdp-announcer.h"
+#include "gdial-ssdp-responder.h"
+
+#define DIAL_SSDP_ST "urn:dial-multiscreen-org:service:dial:1"
+#define SSDP_ROOTDEVICE_ST "upnp:rootdevice"
+#define SSDP_ALL_ST "ssdp:all"
+#define SSDP_MSEARCH_REQUEST_LINE "M-SEARCH * HTTP/1.1\r\n"
+
+typedef enum {
+  SSDP_DATAGRAM_REPLY_ROOTDEVICE,
+  SSDP_DATAGRAM_REPLY_DIAL,
+  SSDP_DATAGRAM_ALIVE_ROOTDEVICE,
+  SSDP_DATAGRAM_ALIVE_DIAL,
+  SSDP_DATAGRAM_BYEBYE_ROOTDEVICE,
+  SSDP_DATAGRAM_BYEBYE_DIAL,
+  SSDP_DATAGRAM_N
+} GDialSsdpDatagram;
+
+typedef struct {
+  GList link;
+  gint64 due_us;
+  struct sockaddr_in to;
+  GBytes *datagram;
+} GDialSsdpPendingReply;
+
+struct _GDialSsdpResponder {
+  /* bound to the interface address: unicast searches in, everything out */
+  int fd;
+  /* bound to the SSDP group, hears it on this interface only */
+  int multicast_fd;
+  gchar *iface_name;
+  /* datagrams that came in through another interface are dropped */
+  guint ifindex;
+  /* the M-SEARCH socket filter goes on every socket made for the responder */
+  gboolean kernel_filter;
+  struct sockaddr_in multicast_addr;
+  GMainContext *context;
+  GSource *recv_source;
+  GSource *multicast_recv_source;
+  GSource *send_source;
+  /* only while the socket buffer is full, the send queue waits for it */
+  GSource *writable_source;
+  GSource *announce_source;
+  GDialSsdpAnnouncer announcer;
+  GDialRateLimiter *rate_limiter;
+  /* sorted by due_us, the head decides when send_source wakes up */
+  GQueue pending;
+  GBytes *datagrams[SSDP_DATAGRAM_N];
+  gboolean available;
+  GDialSsdpResponderStats stats;
+};
+
+static gboolean ssdp_header_value_equal(const gchar *value, gsize value_len, const gchar *expected) {
+  return value_len == strlen(expected) && memcmp(value, expected, value_len) == 0;
+}
+
+GDIAL_STATIC gboolean gdial_ssdp_responder_parse_search(const gchar *data, gsize length, GDialSsdpSearch *search) {
+  static const gsize request_line_len = sizeof(SSDP_MSEARCH_REQUEST_LINE) - 1;
+  if (length < request_line_len || memcmp(data, SSDP_MSEARCH_REQUEST_LINE, request_line_len) != 0) {
+    return FALSE;
+  }
+
+  gboolean discover = FALSE;
+  search->targets = GDIAL_SSDP_TARGET_NONE;
+  search->mx = 0;
+
+  const gchar *line = data + request_line_len;
+  const gchar *end = data + length;
+  while (line < end) {
+    const gchar *eol = memchr(line, '\n', end - line);
+    if (eol == NULL) eol = end;
+    const gchar *line_end = (eol > line && eol[-1] == '\r') ? eol - 1 : eol;
+    if (line_end == line) break;
+
+    const gchar *colon = memchr(line, ':', line_end - line);
+    if (colon) {
+      const gchar *value = colon + 1;
+      const gchar *value_end = line_end;
+      while (value < value_end && (*value == ' ' || *value == '\t')) value++;
+      while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) value_end--;
+      const gsize name_len = colon - line;
+      const gsize value_len = value_end - value;
+
+      if (name_len == 2 && g_ascii_strncasecmp(line, "ST", 2) == 0) {
+        if (ssdp_header_value_equal(value, value_len, DIAL_SSDP_ST)) {
+          search->targets = GDIAL_SSDP_TARGET_DIAL;
+        }
+        else if (ssdp_header_value_equal(value, value_len, SSDP_ROOTDEVICE_ST)) {
+          search->targets = GDIAL_SSDP_TARGET_ROOTDEVICE;
+        }
+        else if (ssdp_header_value_equal(value, value_len, SSDP_ALL_ST)) {
+          search->targets = GDIAL_SSDP_TARGET_ALL;
+        }
+      }
+      else if (name_len == 3 && g_ascii_strncasecmp(line, "MAN", 3) == 0) {
+        discover = ssdp_header_value_equal(value, value_len, "\"ssdp:discover\"");
+      }
+      else if (name_len == 2 && g_ascii_strncasecmp(line, "MX", 2) == 0) {
+        guint mx = 0;
+        for (const gchar *c = value; c < value_end && g_ascii_isdigit(*c) && mx <= GDIAL_SSDP_MAX_MX; c++) {
+          mx = mx * 10 + (*c - '0');
+        }
+        search->mx = MIN(mx, GDIAL_SSDP_MAX_MX);
+      }
+    }
+    line = eol + 1;
+  }
+
+  return discover && search->targets != GDIAL_SSDP_TARGET_NONE;
+}
+
+static void ssdp_responder_send(GDialSsdpResponder *responder, GBytes *datagram, const struct sockaddr_in *to) {
+  gsize length = 0;
+  gconstpointer data = g_bytes_get_data(datagram, &length);
+  responder->stats.send_calls++;
+  if (sendto(responder->fd, data, length, 0, (const struct sockaddr *)to, sizeof(*to)) < 0) {
+    responder->stats.send_errors++;
+  }
+  else {
+    responder->stats.datagrams_sent++;
+  }
+}
+
+/*
+ * Returns how many of @msgs are done with, sent or failed. Fewer than
+ * @count means the socket buffer is full and the rest must wait.
+ */
+static guint ssdp_responder_send_batch(GDialSsdpResponder *responder, struct mmsghdr *msgs, guint count) {
+  guint sent = 0;
+  while (sent < count) {
+    int n = sendmmsg(responder->fd, msgs + sent, count - sent, 0);
+    responder->stats.send_calls++;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    if (n <= 0) {
+      /* skip the datagram that failed, the rest may still go out */
+      responder->stats.send_errors++;
+      sent++;
+    }
+    else {
+      responder->stats.datagrams_sent += n;
+      sent += n;
+    }
+  }
+  return sent;
+}
+
+static void ssdp_responder_schedule_send(GDialSsdpResponder *responder) {
+  GList *head = g_queue_peek_head_link(&responder->pending);
+  /* while blocked, the writable source restarts the queue */
+  if (responder->writable_source == NULL) {
+    g_source_set_ready_time(responder->send_source, head ? ((GDialSsdpPendingReply *)head->data)->due_us : -1);
+  }
+}
+
+static gboolean ssdp_responder_writable_cb(gint fd, GIOCondition condition, gpointer user_data) {
+  GDialSsdpResponder *responder = (GDialSsdpResponder *)user_data;
+  g_source_unref(responder->writable_source);
+  responder->writable_source = NULL;
+  ssdp_responder_schedule_send(responder);
+  return G_SOURCE_REMOVE;
+}
+
+static void ssdp_responder_wait_writable(GDialSsdpResponder *responder) {
+  responder->stats.send_blocked++;
+  g_source_set_ready_time(responder->send_source, -1);
+  responder->writable_source = g_unix_fd_source_new(responder->fd, G_IO_OUT);
+  g_source_set_callback(responder->writable_source, (GSourceFunc)ssdp_responder_writable_cb, responder, NULL);
+  g_source_attach(responder->writable_source, responder->context);
+}
+
+static void ssdp_responder_cancel_writable(GDialSsdpResponder *responder) {
+  if (responder->writable_source == NULL) return;
+  g_source_destroy(responder->writable_source);
+  g_source_unref(responder->writable_source);
+  responder->writable_source = NULL;
+}
+
+static gboolean ssdp_responder_send_cb(gpointer user_data) {
+  GDialSsdpResponder *responder = (GDialSsdpResponder *)user_data;
+  /*
+   * everything that is due leaves in as few sendmmsg() calls as possible,
+   * the datagram payloads are shared between entries. Due times sit on the
+   * send quantum grid, so replies to different searches fall due together.
+   */
+  const gint64 due_us = g_get_monotonic_time();
+  GDialSsdpPendingReply *batch[GDIAL_SSDP_RESPONDER_SEND_BATCH];
+  struct mmsghdr msgs[GDIAL_SSDP_RESPONDER_SEND_BATCH];
+  struct iovec iovs[GDIAL_SSDP_RESPONDER_SEND_BATCH];
+  GList *link = g_queue_peek_head_link(&responder->pending);
+
+  while (link && ((GDialSsdpPendingReply *)link->data)->due_us <= due_us) {
+    guint count = 0;
+    while (link && count < GDIAL_SSDP_RESPONDER_SEND_BATCH && ((GDialSsdpPendingReply *)link->data)->due_us <= due_us) {
+      GDialSsdpPendingReply *reply = (GDialSsdpPendingReply *)link->data;
+      gsize length = 0;
+      iovs[count].iov_base = (gpointer)g_bytes_get_data(reply->datagram, &length);
+      iovs[count].iov_len = length;
+      memset(&msgs[count], 0, sizeof(msgs[count]));
+      msgs[count].msg_hdr.msg_name = &reply->to;
+      msgs[count].msg_hdr.msg_namelen = sizeof(reply->to);
+      msgs[count].msg_hdr.msg_iov = &iovs[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+      batch[count++] = reply;
+      link = link->next;
+    }
+    const guint done = ssdp_responder_send_batch(responder, msgs, count);
+    for (guint i = 0; i < done; i++) {
+      g_queue_unlink(&responder->pending, &batch[i]->link);
+      g_bytes_unref(batch[i]->datagram);
+      g_slice_free(GDialSsdpPendingReply, batch[i]);
+    }
+    if (done < count) {
+      /* the unsent replies stay at the head of the queue */
+      ssdp_responder_wait_writable(responder);
+      return G_SOURCE_CONTINUE;
+    }
+  }
+  ssdp_responder_schedule_send(responder);
+  return G_SOURCE_CONTINUE;
+}
+
+static void ssdp_responder_queue_reply(GDialSsdpResponder *responder, GBytes *datagram, const struct sockaddr_in *to, gint64 due_us) {
+  GDialSsdpPendingReply *reply = g_slice_new(GDialSsdpPendingReply);
+  reply->link.data = reply;
+  reply->link.next = reply->link.prev = NULL;
+  reply->due_us = due_us;
+  reply->to = *to;
+  reply->datagram = g_bytes_ref(datagram);
+
+  /* random delays land near the tail more often than not */
+  GList *after = g_queue_peek_tail_link(&responder->pending);
+  while (after && ((GDialSsdpPendingReply *)after->data)->due_us > due_us) {
+    after = after->prev;
+  }
+  if (after) {
+    g_queue_insert_after_link(&responder->pending, after, &reply->link);
+  }
+  else {
+    g_queue_push_head_link(&responder->pending, &reply->link);
+    ssdp_responder_schedule_send(responder);
+  }
+}
+
+static void ssdp_responder_handle_datagram(GDialSsdpResponder *responder, const gchar *data, gsize length, const struct sockaddr_in *from) {
+  GDialSsdpSearch search;
+  responder->stats.received++;
+  if (!gdial_ssdp_responder_parse_search(data, length, &search)) {
+    responder->stats.ignored++;
+    return;
+  }
+
+  const gint64 now_us = g_get_monotonic_time();
+  const guint replies = (search.targets == GDIAL_SSDP_TARGET_ALL) ? 2 : 1;
+  if (!responder->available || responder->datagrams[SSDP_DATAGRAM_REPLY_DIAL] == NULL
+      || responder->pending.length + replies > GDIAL_SSDP_RESPONDER_MAX_PENDING
+      || gdial_rate_limiter_acquire(responder->rate_limiter, from->sin_addr.s_addr, now_us, 0) != 0) {
+    responder->stats.suppressed++;
+    return;
+  }
+  responder->stats.answered++;
+
+  /*
+   * one random point in the MX window per search, rounded up onto the send
+   * quantum grid so that replies share sendmmsg() calls without any of them
+   * leaving before its time or after the window
+   */
+  gint64 due_us = now_us;
+  if (search.mx) {
+    const gint64 quantum_us = GDIAL_SSDP_RESPONDER_SEND_QUANTUM_MS * G_GINT64_CONSTANT(1000);
+    due_us += g_random_int_range(0, search.mx * 1000 - GDIAL_SSDP_RESPONDER_SEND_QUANTUM_MS) * G_GINT64_CONSTANT(1000);
+    due_us = (due_us + quantum_us - 1) / quantum_us * quantum_us;
+  }
+  if (search.targets & GDIAL_SSDP_TARGET_ROOTDEVICE) {
+    ssdp_responder_queue_reply(responder, responder->datagrams[SSDP_DATAGRAM_REPLY_ROOTDEVICE], from, due_us);
+  }
+  if (search.targets & GDIAL_SSDP_TARGET_DIAL) {
+    ssdp_responder_queue_reply(responder, responder->datagrams[SSDP_DATAGRAM_REPLY_DIAL], from, due_us);
+  }
+}
+
+static gboolean ssdp_responder_recv_cb(gint fd, GIOCondition condition, gpointer user_data) {
+  GDialSsdpResponder *responder = (GDialSsdpResponder *)user_data;
+  gchar buffer[GDIAL_SSDP_MAX_DATAGRAM_SIZE];
+  union {
+    struct cmsghdr align;
+    gchar buffer[CMSG_SPACE(sizeof(struct in_pktinfo))];
+  } control;
+  /* bounded so that a flood cannot starve the rest of the context */
+  for (int i = 0; i < GDIAL_SSDP_RESPONDER_MAX_RECV_BATCH; i++) {
+    struct sockaddr_in from;
+    struct iovec iov = { buffer, sizeof(buffer) };
+    struct msghdr msg = {0};
+    msg.msg_name = &from;
+    msg.msg_namelen = sizeof(from);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    ssize_t length = recvmsg(fd, &msg, 0);
+    if (length < 0) break;
+    if (from.sin_family != AF_INET) continue;
+    gboolean other_iface = FALSE;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+        struct in_pktinfo pktinfo;
+        memcpy(&pktinfo, CMSG_DATA(cmsg), sizeof(pktinfo));
+        other_iface = responder->ifindex != 0 && (guint)pktinfo.ipi_ifindex != responder->ifindex;
+      }
+    }
+    if (other_iface) {
+      /* the responder of that interface answers it, with its own LOCATION */
+      responder->stats.received++;
+      responder->stats.ignored++;
+      continue;
+    }
+    ssdp_responder_handle_datagram(responder, buffer, length, &from);
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean ssdp_responder_ready_time_dispatch(GSource *source, GSourceFunc callback, gpointer user_data) {
+  return callback(user_data);
+}
+
+static GSourceFuncs ssdp_responder_ready_time_funcs = {
+  NULL, NULL, ssdp_responder_ready_time_dispatch, NULL
+};
+
+static void ssdp_responder_announce(GDialSsdpResponder *responder, GDialSsdpDatagram rootdevice, GDialSsdpDatagram dial) {
+  if (responder->datagrams[rootdevice] == NULL) return;
+  ssdp_responder_send(responder, responder->datagrams[rootdevice], &responder->multicast_addr);
+  ssdp_responder_send(responder, responder->datagrams[dial], &responder->multicast_addr);
+}
+
+static void ssdp_responder_schedule_announce(GDialSsdpResponder *responder) {
+  const gint64 due_ms = gdial_ssdp_announcer_due_ms(&responder->announcer);
+  g_source_set_ready_time(responder->announce_source, due_ms < 0 ? -1 : due_ms * 1000);
+}
+
+static gboolean ssdp_responder_announce_cb(gpointer user_data) {
+  GDialSsdpResponder *responder = (GDialSsdpResponder *)user_data;
+  if (gdial_ssdp_announcer_poll(&responder->announcer, g_get_monotonic_time() / 1000)) {
+    ssdp_responder_announce(responder, SSDP_DATAGRAM_ALIVE_ROOTDEVICE, SSDP_DATAGRAM_ALIVE_DIAL);
+  }
+  ssdp_responder_schedule_announce(responder);
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean ssdp_responder_socket_error(GError **error, const gchar *what) {
+  int saved_errno = errno;
+  g_set_error(error, G_IO_ERROR, g_io_error_from_errno(saved_errno), "ssdp responder %s: %s", what, g_strerror(saved_errno));
+  return FALSE;
+}
+
+/*
+ * Classic BPF program run by the kernel before a datagram is queued on the
+ * socket. On a UDP socket the program sees the UDP header at offset 0, so the
+ * payload starts at 8. Everything that is not "M-SEARCH * H..." (NOTIFYs and
+ * search replies from other devices, which are most of the multicast traffic)
+ * is dropped without waking us up. The ST needs a header scan that cBPF cannot
+ * express without loops, so that check stays in gdial_ssdp_responder_parse_search().
+ */
+static gboolean ssdp_responder_attach_filter(int fd) {
+  static struct sock_filter msearch_filter[] = {
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 8),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x4d2d5345 /* "M-SE" */, 0, 5),
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 12),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x41524348 /* "ARCH" */, 0, 3),
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 16),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x202a2048 /* " * H" */, 0, 1),
+    BPF_STMT(BPF_RET | BPF_K, 0xffff),
+    BPF_STMT(BPF_RET | BPF_K, 0),
+  };
+  struct sock_fprog program = {
+    .len = G_N_ELEMENTS(msearch_filter),
+    .filter = msearch_filter,
+  };
+  return setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) == 0;
+}
+
+/*
+ * @multicast: the socket joins the SSDP group on the interface and is bound
+ * to the group address, so it shares port 1900 with other stacks (and our
+ * other interfaces) without being handed their unicast datagrams. Otherwise
+ * it is bound to the interface address and used for sending.
+ */
+static int ssdp_responder_socket_new(const gchar *ipv4_address, gboolean multicast, gboolean kernel_filter, GError **error) {
+  struct in_addr iface_addr;
+  if (inet_pton(AF_INET, ipv4_address, &iface_addr) != 1) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "ssdp responder: invalid address %s", ipv4_address);
+    return -1;
+  }
+
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    ssdp_responder_socket_error(error, "socket");
+    return -1;
+  }
+
+  int on = 1;
+  int off = 0;
+  unsigned char ttl = GDIAL_SSDP_MULTICAST_TTL;
+  struct ip_mreq mreq = {0};
+  inet_pton(AF_INET, GDIAL_SSDP_MULTICAST_ADDR, &mreq.imr_multiaddr);
+  mreq.imr_interface = iface_addr;
+  struct sockaddr_in bind_addr = {0};
+  bind_addr.sin_family = AF_INET;
+  bind_addr.sin_port = htons(GDIAL_SSDP_PORT);
+  bind_addr.sin_addr = multicast ? mreq.imr_multiaddr : iface_addr;
+
+  /*
+   * other SSDP stacks on the box share port 1900
+   */
+  gboolean ok = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == 0 || ssdp_responder_socket_error(error, "SO_REUSEADDR");
+#ifdef SO_REUSEPORT
+  ok = ok && (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == 0 || ssdp_responder_socket_error(error, "SO_REUSEPORT"));
+#endif
+  ok = ok && (setsockopt(fd, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on)) == 0 || ssdp_responder_socket_error(error, "IP_PKTINFO"));
+  ok = ok && (bind(fd, (struct sockaddr *)&bind_addr, sizeof(bind_addr)) == 0 || ssdp_responder_socket_error(error, "bind"));
+  if (multicast) {
+    ok = ok && (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == 0 || ssdp_responder_socket_error(error, "IP_ADD_MEMBERSHIP"));
+#ifdef IP_MULTICAST_ALL
+    /* otherwise the socket also hears the group joined on other interfaces */
+    ok = ok && (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_ALL, &off, sizeof(off)) == 0 || ssdp_responder_socket_error(error, "IP_MULTICAST_ALL"));
+#endif
+  }
+  else {
+    ok = ok && (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &iface_addr, sizeof(iface_addr)) == 0 || ssdp_responder_socket_error(error, "IP_MULTICAST_IF"));
+    ok = ok && (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) == 0 || ssdp_responder_socket_error(error, "IP_MULTICAST_TTL"));
+  }
+  if (!ok) {
+    close(fd);
+    return -1;
+  }
+  if (kernel_filter && !ssdp_responder_attach_filter(fd)) {
+    /* not fatal, user space still filters everything */
+    g_printerr("ssdp responder: SO_ATTACH_FILTER: %s\r\n", g_strerror(errno));
+  }
+  return fd;
+}
+
+static gboolean ssdp_responder_sockets_new(const gchar *ipv4_address, gboolean kernel_filter, int *fd, int *multicast_fd, GError **error) {
+  *fd = ssdp_responder_socket_new(ipv4_address, FALSE, kernel_filter, error);
+  if (*fd < 0) return FALSE;
+  *multicast_fd = ssdp_responder_socket_new(ipv4_address, TRUE, kernel_filter, error);
+  if (*multicast_fd < 0) {
+    close(*fd);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static void ssdp_responder_attach_sockets(GDialSsdpResponder *responder, int fd, int multicast_fd) {
+  responder->fd = fd;
+  responder->recv_source = g_unix_fd_source_new(fd, G_IO_IN);
+  g_source_set_callback(responder->recv_source, (GSourceFunc)ssdp_responder_recv_cb, responder, NULL);
+  g_source_attach(responder->recv_source, responder->context);
+  responder->multicast_fd = multicast_fd;
+  responder->multicast_recv_source = g_unix_fd_source_new(multicast_fd, G_IO_IN);
+  g_source_set_callback(responder->multicast_recv_source, (GSourceFunc)ssdp_responder_recv_cb, responder, NULL);
+  g_source_attach(responder->multicast_recv_source, responder->context);
+}
+
+static void ssdp_responder_detach_sockets(GDialSsdpResponder *responder) {
+  ssdp_responder_cancel_writable(responder);
+  g_source_destroy(responder->recv_source);
+  g_source_unref(responder->recv_source);
+  g_source_destroy(responder->multicast_recv_source);
+  g_source_unref(responder->multicast_recv_source);
+  close(responder->fd);
+  close(responder->multicast_fd);
+}
+
+GDialSsdpResponder *gdial_ssdp_responder_new(GMainContext *context, const gchar *iface_name, const gchar *ipv4_address, guint notify_interval_s, gboolean kernel_filter, GError **error) {
+  g_return_val_if_fail(iface_name != NULL && ipv4_address != NULL, NULL);
+
+  int fd, multicast_fd;
+  if (!ssdp_responder_sockets_new(ipv4_address, kernel_filter, &fd, &multicast_fd, error)) {
+    return NULL;
+  }
+
+  GDialSsdpResponder *responder = g_new0(GDialSsdpResponder, 1);
+  responder->iface_name = g_strdup(iface_name);
+  responder->ifindex = if_nametoindex(iface_name);
+  responder->kernel_filter = kernel_filter;
+  responder->multicast_addr.sin_family = AF_INET;
+  responder->multicast_addr.sin_port = htons(GDIAL_SSDP_PORT);
+  inet_pton(AF_INET, GDIAL_SSDP_MULTICAST_ADDR, &responder->multicast_addr.sin_addr);
+  responder->context = context ? g_main_context_ref(context) : NULL;
+  responder->rate_limiter = gdial_rate_limiter_new(GDIAL_SSDP_RESPONDER_RATE, GDIAL_SSDP_RESPONDER_BURST, GDIAL_SSDP_RESPONDER_MAX_CLIENTS);
+  g_queue_init(&responder->pending);
+  ssdp_responder_attach_sockets(responder, fd, multicast_fd);
+
+  responder->send_source = g_source_new(&ssdp_responder_ready_time_funcs, sizeof(GSource));
+  g_source_set_callback(responder->send_source, ssdp_responder_send_cb, responder, NULL);
+  g_source_set_ready_time(responder->send_source, -1);
+  g_source_attach(responder->send_source, context);
+
+  /* alive has to be repeated well within max-age */
+  notify_interval_s = CLAMP(notify_interval_s, 1, GDIAL_SSDP_MAX_AGE / 2);
+  gdial_ssdp_announcer_init(&responder->announcer, GDIAL_SSDP_NOTIFY_BURST_COUNT, GDIAL_SSDP_NOTIFY_BURST_INTERVAL_MS, notify_interval_s * 1000);
+  responder->announce_source = g_source_new(&ssdp_responder_ready_time_funcs, sizeof(GSource));
+  g_source_set_callback(responder->announce_source, ssdp_responder_announce_cb, responder, NULL);
+  g_source_set_ready_time(responder->announce_source, -1);
+  g_source_attach(responder->announce_source, context);
+
+  return responder;
+}
+
+gboolean gdial_ssdp_responder_rebind(GDialSsdpResponder *responder, const gchar *ipv4_address, GError **error) {
+  g_return_val_if_fail(responder != NULL && ipv4_address != NULL, FALSE);
+
+  /*
+   * queued replies, counters and the announcement schedule stay, only
+   * the socket moves to the new address
+   */
+  int fd, multicast_fd;
+  if (!ssdp_responder_sockets_new(ipv4_address, responder->kernel_filter, &fd, &multicast_fd, error)) {
+    return FALSE;
+  }
+  ssdp_responder_detach_sockets(responder);
+  /* the interface may have been recreated along with its address */
+  responder->ifindex = if_nametoindex(responder->iface_name);
+  ssdp_responder_attach_sockets(responder, fd, multicast_fd);
+  /* a queue that was waiting for the old socket goes out on the new one */
+  ssdp_responder_schedule_send(responder);
+  return TRUE;
+}
+
+static GBytes *ssdp_responder_datagram_new(const gchar *start_line, const gchar *st_header, const gchar *st, const gchar *usn, const gchar *nts,
+                                           const gchar *location, const gchar *server, guint config_id) {
+  GString *datagram = g_string_sized_new(GDIAL_SSDP_MAX_DATAGRAM_SIZE / 4);
+  g_string_append(datagram, start_line);
+  if (nts) {
+    g_string_append(datagram, "HOST: " GDIAL_SSDP_MULTICAST_ADDR ":" G_STRINGIFY(GDIAL_SSDP_PORT) "\r\n");
+  }
+  if (nts == NULL || strcmp(nts, "ssdp:alive") == 0) {
+    g_string_append(datagram, "CACHE-CONTROL: max-age=" G_STRINGIFY(GDIAL_SSDP_MAX_AGE) "\r\n");
+    if (nts == NULL) g_string_append(datagram, "EXT:\r\n");
+    g_string_append_printf(datagram, "LOCATION: %s\r\nSERVER: %s\r\n", location, server);
+  }
+  g_string_append_printf(datagram, "%s: %s\r\n", st_header, st);
+  if (nts) g_string_append_printf(datagram, "NTS: %s\r\n", nts);
+  g_string_append_printf(datagram, "USN: %s\r\nBOOTID.UPNP.ORG: 1\r\nCONFIGID.UPNP.ORG: %u\r\n\r\n", usn, config_id);
+  gsize length = datagram->len;
+  return g_bytes_new_take(g_string_free(datagram, FALSE), length);
+}
+
+void gdial_ssdp_responder_set_description(GDialSsdpResponder *responder, const gchar *uuid, const gchar *location, guint config_id) {
+  g_return_if_fail(responder != NULL && uuid != NULL && location != NULL);
+
+  struct utsname os;
+  gchar *server = uname(&os) == 0 ? g_strdup_printf("%s/%s UPnP/1.1 gdial/1.0", os.sysname, os.release) : g_strdup("Linux UPnP/1.1 gdial/1.0");
+  gchar *rootdevice_usn = g_strdup_printf("uuid:%s::" SSDP_ROOTDEVICE_ST, uuid);
+  gchar *dial_usn = g_strdup_printf("uuid:%s::" DIAL_SSDP_ST, uuid);
+  static const gchar *reply_line = "HTTP/1.1 200 OK\r\n";
+  static const gchar *notify_line = "NOTIFY * HTTP/1.1\r\n";
+
+  GBytes *datagrams[SSDP_DATAGRAM_N] = {
+    [SSDP_DATAGRAM_REPLY_ROOTDEVICE] = ssdp_responder_datagram_new(reply_line, "ST", SSDP_ROOTDEVICE_ST, rootdevice_usn, NULL, location, server, config_id),
+    [SSDP_DATAGRAM_REPLY_DIAL] = ssdp_responder_datagram_new(reply_line, "ST", DIAL_SSDP_ST, dial_usn, NULL, location, server, config_id),
+    [SSDP_DATAGRAM_ALIVE_ROOTDEVICE] = ssdp_responder_datagram_new(notify_line, "NT", SSDP_ROOTDEVICE_ST, rootdevice_usn, "ssdp:alive", location, server, config_id),
+    [SSDP_DATAGRAM_ALIVE_DIAL] = ssdp_responder_datagram_new(notify_line, "NT", DIAL_SSDP_ST, dial_usn, "ssdp:alive", location, server, config_id),
+    [SSDP_DATAGRAM_BYEBYE_ROOTDEVICE] = ssdp_responder_datagram_new(notify_line, "NT", SSDP_ROOTDEVICE_ST, rootdevice_usn, "ssdp:byebye", location, server, config_id),
+    [SSDP_DATAGRAM_BYEBYE_DIAL] = ssdp_responder_datagram_new(notify_line, "NT", DIAL_SSDP_ST, dial_usn, "ssdp:byebye", location, server, config_id),
+  };
+  g_free(server);
+  g_free(rootdevice_usn);
+  g_free(dial_usn);
+
+  /* replies already queued keep a reference to the old datagrams */
+  for (int i = 0; i < SSDP_DATAGRAM_N; i++) {
+    if (responder->datagrams[i]) g_bytes_unref(responder->datagrams[i]);
+    responder->datagrams[i] = datagrams[i];
+  }
+
+  /* a new description (name or address change) is announced with a fresh burst */
+  if (responder->available) {
+    gdial_ssdp_announcer_activate(&responder->announcer, g_get_monotonic_time() / 1000);
+    ssdp_responder_schedule_announce(responder);
+  }
+}
+
+void gdial_ssdp_responder_set_available(GDialSsdpResponder *responder, gboolean available) {
+  g_return_if_fail(responder != NULL);
+  if (responder->available == available) return;
+  responder->available = available;
+
+  if (available) {
+    gdial_ssdp_announcer_activate(&responder->announcer, g_get_monotonic_time() / 1000);
+  }
+  else if (gdial_ssdp_announcer_deactivate(&responder->announcer)) {
+    ssdp_responder_announce(responder, SSDP_DATAGRAM_BYEBYE_ROOTDEVICE, SSDP_DATAGRAM_BYEBYE_DIAL);
+  }
+  ssdp_responder_schedule_announce(responder);
+}
+
+void gdial_ssdp_responder_get_stats(GDialSsdpResponder *responder, GDialSsdpResponderStats *stats) {
+  g_return_if_fail(responder != NULL && stats != NULL);
+  *stats = responder->stats;
+  stats->pending = responder->pending.length;
+  stats->alive_sent = responder->announcer.stats.alive_sent;
+  stats->byebye_sent = responder->announcer.stats.byebye_sent;
+  stats->bursts = responder->announcer.stats.bursts;
+}
+
+void gdial_ssdp_responder_free(GDialSsdpResponder *responder) {
+  if (responder == NULL) return;
+  gdial_ssdp_responder_set_available(responder, FALSE);
+
+  GList *link;
+  while ((link = g_queue_pop_head_link(&responder->pending)) != NULL) {
+    GDialSsdpPendingReply *reply = (GDialSsdpPendingReply *)link->data;
+    g_bytes_unref(reply->datagram);
+    g_slice_free(GDialSsdpPendingReply, reply);
+  }
+  ssdp_responder_detach_sockets(responder);
+  g_source_destroy(responder->send_source);
+  g_source_unref(responder->send_source);
+  g_source_destroy(responder->announce_source);
+  g_source_unref(responder->announce_source);
+  for (int i = 0; i < SSDP_DATAGRAM_N; i++) {
+    if (responder->datagrams[i]) g_bytes_unref(responder->datagrams[i]);
+  }
+  gdial_rate_limiter_free(responder->rate_limiter);
+  if (responder->context) g_main_context_unref(responder->context);
+  g_free(responder->iface_name);
+  g_free(responder);
+}
@@ -0,0 +1,91 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GDIAL_SSDP_RESPONDER_H_
+#define GDIAL_SSDP_RESPONDER_H_
+
+#include <glib.h>
+#include "gdial-config.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Built-in SSDP responder, used instead of a GSSDPResourceGroup when the
+ * server runs with --native-ssdp. Replies are pre-built datagrams, every
+ * source address is rate limited and replies are spread over the MX window
+ * of the search through one send queue.
+ */
+typedef struct _GDialSsdpResponder GDialSsdpResponder;
+
+typedef struct {
+  guint64 received;
+  guint64 answered;
+  guint64 suppressed;
+  guint64 ignored;
+  guint64 datagrams_sent;
+  guint64 send_calls;
+  guint64 send_errors;
+  /* times the send queue waited for a full socket buffer */
+  guint64 send_blocked;
+  guint pending;
+  /* announcements */
+  guint64 alive_sent;
+  guint64 byebye_sent;
+  guint64 bursts;
+} GDialSsdpResponderStats;
+
+typedef enum {
+  GDIAL_SSDP_TARGET_NONE = 0,
+  GDIAL_SSDP_TARGET_ROOTDEVICE = 1 << 0,
+  GDIAL_SSDP_TARGET_DIAL = 1 << 1,
+  GDIAL_SSDP_TARGET_ALL = GDIAL_SSDP_TARGET_ROOTDEVICE | GDIAL_SSDP_TARGET_DIAL,
+} GDialSsdpTarget;
+
+typedef struct {
+  GDialSsdpTarget targets;
+  guint mx;
+} GDialSsdpSearch;
+
+/*
+ * @context: where the socket and send queue are dispatched, NULL for the default context
+ * @iface_name: only searches that arrive through this interface are answered
+ * @notify_interval_s: steady-state ssdp:alive interval once the activation burst has backed off
+ * @kernel_filter: drop everything but M-SEARCH before it wakes us up, only off for comparison runs
+ */
+GDialSsdpResponder *gdial_ssdp_responder_new(GMainContext *context, const gchar *iface_name, const gchar *ipv4_address, guint notify_interval_s, gboolean kernel_filter, GError **error);
+void gdial_ssdp_responder_free(GDialSsdpResponder *responder);
+/*
+ * Move to a new interface address; follow with set_description() to
+ * announce the new LOCATION.
+ */
+gboolean gdial_ssdp_responder_rebind(GDialSsdpResponder *responder, const gchar *ipv4_address, GError **error);
+/*
+ * (Re)build the reply and announcement datagrams.
+ */
+void gdial_ssdp_responder_set_description(GDialSsdpResponder *responder, const gchar *uuid, const gchar *location, guint config_id);
+void gdial_ssdp_responder_set_available(GDialSsdpResponder *responder, gboolean available);
+void gdial_ssdp_responder_get_stats(GDialSsdpResponder *responder, GDialSsdpResponderStats *stats);
+
+/*
+ * Returns TRUE if @data is an M-SEARCH for one of our targets, filling @search.
+ */
+GDIAL_STATIC gboolean gdial_ssdp_responder_parse_search(const gchar *data, gsize length, GDialSsdpSearch *search);
+
+G_END_DECLS
+#endif
@@ -20,6 +20,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
 #include <glib.h>
 #include <libsoup/soup.h>
 #include <libgssdp/gssdp.h>
@@ -27,16 +31,28 @@
 #include "gdial-config.h"
 #include "gdial-plat-util.h"
 #include "gdial-plat-dev.h"
+#include "gdial-identity.h"
+#include "gdial-shield.h"
 #include "gdial-ssdp.h"
+#include "gdial-ssdp-responder.h"
+#include "gdial-xml.h"
 
 
 static SoupServer *ssdp_http_server_ = NULL;
 static GDialOptions *gdial_options_ = NULL;
-static gboolean *friendlyname_changed_ = NULL;
-static GMutex *friendlyname_mutex_ = NULL;
-static GSSDPClient *ssdp_client_ = NULL;
-static GSSDPResourceGroup *ssdp_resource_group_ = NULL;
-static int ssdp_resource_id_ = 0;
+static gboolean ssdp_available_ = FALSE;
+
+/*
+ * SSDP and /dd.xml run on their own thread and main context so that slow
+ * REST or platform work on the default context never delays discovery.
+ * Everything below is owned by that thread; the public functions hand
+ * their work over with g_main_context_invoke(). The only state shared
+ * with the rest of the server is the immutable device identity snapshot.
+ */
+static GMainContext *ssdp_context_ = NULL;
+static GMainLoop *ssdp_loop_ = NULL;
+static GThread *ssdp_thread_ = NULL;
+static GDialShield *ssdp_shield_ = NULL;
 /*
  * ssdp settings
  */
@@ -44,34 +60,166 @@ static const char *dial_ssdp_ST_target = "urn:dial-multiscreen-org:service:dial:
 #define DIAL_SSDP_USN_FMT "uuid:%s::urn:dial-multiscreen-org:service:dial:1"
 #define DIAL_SSDP_LOCATION_FMT "http://%s:%d/dd.xml"
 
+/*
+ * Every advertised interface has its own SSDP client (or native responder)
+ * and its own Application-URL/LOCATION; the dd.xml body is shared.
+ */
+typedef struct {
+  gchar *iface_name;
+  gchar *ipv4_address;
+  GInetAddress *inet_address;
+  GSSDPClient *client;
+  GSSDPResourceGroup *resource_group;
+  guint resource_id;
+  GDialSsdpResponder *responder;
+  gchar *application_url;
+  gchar *etag;
+  guint config_id;
+  /* the dd.xml config_id was taken for */
+  GBytes *dd_xml;
+  /* reports how long controllers took to find us again after an address change */
+  gint64 address_changed_us;
+} GDialSsdpInterface;
+
+static GPtrArray *ssdp_interfaces_ = NULL;
 
 /*
- * server cmdline options
+ * Device description, same content as the Netflix DIAL reference dd.xml
+ * (Copyright (c) 2014 Netflix, Inc. Licensed under the BSD-2 license)
+ * with the device strings escaped.
  */
-#define GDIAL_SSDP_DEVICE_UUID_DEFAULT "12345678-abcd-abcd-1234-123456789abc"
-#define GDIAL_SSDP_FRIENDLY_DEFAULT  "FriendXi6"
-#define GDIAL_SSDP_MANUFACTURER_DEFAULT "OEM"
-#define GDIAL_SSDP_MODELNAME_DEFAULT "Xi6"
+static gchar *ssdp_device_xml_new(const gchar *friendly_name, const gchar *manufacturer, const gchar *model, const gchar *uuid, gsize *length) {
+  gchar *udn = g_strconcat("uuid:", uuid, NULL);
+  GDialXmlWriter writer;
+  gdial_xml_writer_init(&writer, GDIAL_SSDP_DEVICE_XML_SIZE_HINT);
+  gdial_xml_writer_start_element(&writer, "root");
+  gdial_xml_writer_attribute(&writer, "xmlns", "urn:schemas-upnp-org:device-1-0");
+  gdial_xml_writer_attribute(&writer, "xmlns:r", "urn:restful-tv-org:schemas:upnp-dd");
+  gdial_xml_writer_start_element(&writer, "specVersion");
+  gdial_xml_writer_element(&writer, "major", "1");
+  gdial_xml_writer_element(&writer, "minor", "0");
+  gdial_xml_writer_end_element(&writer);
+  gdial_xml_writer_start_element(&writer, "device");
+  gdial_xml_writer_element(&writer, "deviceType", "urn:schemas-upnp-org:device:tvdevice:1");
+  gdial_xml_writer_element(&writer, "friendlyName", friendly_name);
+  gdial_xml_writer_element(&writer, "manufacturer", manufacturer);
+  gdial_xml_writer_element(&writer, "modelName", model);
+  gdial_xml_writer_element(&writer, "UDN", udn);
+  g_free(udn);
+  return gdial_xml_writer_finish(&writer, length);
+}
 
-static const char *iface_ipv4_address = NULL;
 /*
- * Copyright (c) 2014 Netflix, Inc.
- * Licensed under the BSD-2 license
+ * The complete /dd.xml response is rendered up front and only rebuilt when
+ * the device identity or an address changes; requests just share the
+ * immutable bytes.
  */
-static const char ssdp_device_xml_template[] = ""
-  "<?xml version=\"1.0\"?>"
-  "<root xmlns=\"urn:schemas-upnp-org:device-1-0\" xmlns:r=\"urn:restful-tv-org:schemas:upnp-dd\">"
-  "  <specVersion> <major>1</major> <minor>0</minor> </specVersion>"
-  "    <device>"
-  "      <deviceType>urn:schemas-upnp-org:device:tvdevice:1</deviceType>"
-  "      <friendlyName>%s</friendlyName>"
-  "      <manufacturer>%s</manufacturer>"
-  "      <modelName>%s</modelName>"
-  "      <UDN>uuid:%s</UDN>"
-  "     </device>"
-  "</root>";
-
-static gchar *dd_xml_response_str_ = NULL;
+static GBytes *dd_xml_response_ = NULL;
+
+/*
+ * CONFIGID.UPNP.ORG must change whenever the description does and is
+ * limited to 0..16777215. One counter serves all interfaces, an interface
+ * takes the next value when its dd.xml bytes or Application-URL change, so
+ * a value never stands for two descriptions. It starts from the wall clock
+ * so that a restart does not hand out recent values again.
+ */
+static guint ssdp_config_id_ = 0;
+
+static void ssdp_interface_render(GDialSsdpInterface *iface, GDialDeviceIdentity *identity) {
+  gchar *application_url = g_strdup_printf("http://%s:%d%s/", iface->ipv4_address, GDIAL_REST_HTTP_PORT, GDIAL_REST_HTTP_APPS_URI);
+  const gboolean changed = iface->dd_xml == NULL || !g_bytes_equal(iface->dd_xml, dd_xml_response_) ||
+    g_strcmp0(iface->application_url, application_url) != 0;
+  g_free(iface->application_url);
+  iface->application_url = application_url;
+
+  if (changed) {
+    if (iface->dd_xml) g_bytes_unref(iface->dd_xml);
+    iface->dd_xml = g_bytes_ref(dd_xml_response_);
+    ssdp_config_id_ = (ssdp_config_id_ + 1) & 0xFFFFFF;
+    iface->config_id = ssdp_config_id_;
+    /* the ETag carries the same value */
+    g_free(iface->etag);
+    iface->etag = g_strdup_printf("\"%u\"", iface->config_id);
+  }
+
+  if (iface->client) {
+    gchar *config_id_str = g_strdup_printf("%u", iface->config_id);
+    gssdp_client_remove_header(iface->client, "CONFIGID.UPNP.ORG");
+    gssdp_client_append_header(iface->client, "CONFIGID.UPNP.ORG", config_id_str);
+    g_free(config_id_str);
+  }
+  if (iface->responder) {
+    gchar *dial_ssdp_LOCATION = g_strdup_printf(DIAL_SSDP_LOCATION_FMT, iface->ipv4_address, GDIAL_SSDP_HTTP_PORT);
+    gdial_ssdp_responder_set_description(iface->responder, identity->uuid, dial_ssdp_LOCATION, iface->config_id);
+    g_free(dial_ssdp_LOCATION);
+  }
+}
+
+static void ssdp_device_description_render() {
+  GDialDeviceIdentity *identity = gdial_device_identity_get();
+  const gchar *manufacturer= gdial_plat_dev_get_manufacturer();
+  const gchar *model = gdial_plat_dev_get_model();
+
+  if (manufacturer == NULL) {manufacturer = identity->manufacturer;}
+  if (model == NULL) {model = identity->model_name;}
+  gsize dd_xml_len = 0;
+  gchar *dd_xml = ssdp_device_xml_new(identity->friendly_name ? identity->friendly_name : "",
+    manufacturer ? manufacturer : "", model ? model : "", identity->uuid, &dd_xml_len);
+  g_print("Response with name:%s \r\n", identity->friendly_name);
+
+  if (dd_xml_response_) g_bytes_unref(dd_xml_response_);
+  dd_xml_response_ = g_bytes_new_take(dd_xml, dd_xml_len);
+
+  for (guint i = 0; i < ssdp_interfaces_->len; i++) {
+    ssdp_interface_render(g_ptr_array_index(ssdp_interfaces_, i), identity);
+  }
+  gdial_device_identity_unref(identity);
+}
+
+static gboolean ssdp_device_description_render_cb(gpointer user_data) {
+  /* a change before gdial_ssdp_init() is picked up by the initial render */
+  if (dd_xml_response_) ssdp_device_description_render();
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean ssdp_http_etag_matches(const char *if_none_match, const gchar *etag) {
+  /*
+   * walk the list in place rather than through soup_header_parse_list(),
+   * a dd.xml fetch should not allocate; commas only split outside quotes
+   */
+  gsize etag_len = strlen(etag);
+  const char *p = if_none_match;
+  while (*p) {
+    while (*p == ',' || g_ascii_isspace(*p)) p++;
+    const char *start = p;
+    gboolean quoted = FALSE;
+    for (; *p && (quoted || *p != ','); p++) {
+      if (*p == '"') quoted = !quoted;
+    }
+    const char *end = p;
+    while (end > start && g_ascii_isspace(end[-1])) end--;
+    if (end - start >= 2 && start[0] == 'W' && start[1] == '/') start += 2;
+    gsize len = end - start;
+    if ((len == 1 && *start == '*') || (len == etag_len && memcmp(start, etag, len) == 0)) return TRUE;
+  }
+  return FALSE;
+}
+
+static GDialSsdpInterface *ssdp_interface_for_client(SoupClientContext *client) {
+  /*
+   * the interface the request came in on decides the Application-URL
+   */
+  GSocketAddress *local_address = client ? soup_client_context_get_local_address(client) : NULL;
+  if (local_address && G_IS_INET_SOCKET_ADDRESS(local_address)) {
+    GInetAddress *inet_address = g_inet_socket_address_get_address(G_INET_SOCKET_ADDRESS(local_address));
+    for (guint i = 0; i < ssdp_interfaces_->len; i++) {
+      GDialSsdpInterface *iface = g_ptr_array_index(ssdp_interfaces_, i);
+      if (iface->inet_address && g_inet_address_equal(iface->inet_address, inet_address)) return iface;
+    }
+  }
+  return ssdp_interfaces_->len ? g_ptr_array_index(ssdp_interfaces_, 0) : NULL;
+}
+
 static void ssdp_http_server_callback(SoupServer *server, SoupMessage *msg, const char *path, GHashTable *query, SoupClientContext  *client, gpointer user_data) {
   /*
    * /dd.xml only supports GET
@@ -83,68 +231,129 @@ static void ssdp_http_server_callback(SoupServer *server, SoupMessage *msg, cons
     return;
   }
 
-  /*
-   * there is no variant here, so we can cache the response.
-   */
-  static size_t dd_xml_response_str_len = 0;
-
-  g_mutex_lock(friendlyname_mutex_);
-
-  if (!dd_xml_response_str_ || *friendlyname_changed_ == TRUE) {
-    *friendlyname_changed_ = FALSE;
-    const gchar *manufacturer= gdial_plat_dev_get_manufacturer();
-    const gchar *model = gdial_plat_dev_get_model();
-
-    if (manufacturer == NULL) {manufacturer = gdial_options_->manufacturer;}
-    if (model == NULL) {model = gdial_options_->model_name;}
-    dd_xml_response_str_ = g_strdup_printf(ssdp_device_xml_template, gdial_options_->friendly_name, manufacturer, model, gdial_options_->uuid);
-    g_print("Response with name:%s \r\n", gdial_options_->friendly_name);
-    dd_xml_response_str_len = strlen(dd_xml_response_str_);
+  GDialSsdpInterface *iface = ssdp_interface_for_client(client);
+  if (iface == NULL) {
+    soup_message_set_status(msg, SOUP_STATUS_SERVICE_UNAVAILABLE);
+    return;
+  }
+  if (iface->address_changed_us) {
+    g_print("dd.xml fetched on %s %" G_GINT64_FORMAT "ms after address change\r\n", iface->iface_name, (g_get_monotonic_time() - iface->address_changed_us) / 1000);
+    iface->address_changed_us = 0;
   }
+  soup_message_headers_replace(msg->response_headers, "Application-URL", iface->application_url);
+  soup_message_headers_replace(msg->response_headers, "ETag", iface->etag);
+  GDIAL_CHECK("Application-URL: exist");
 
-  g_mutex_unlock (friendlyname_mutex_);
+  const char *if_none_match = soup_message_headers_get_list(msg->request_headers, "If-None-Match");
+  if (if_none_match && ssdp_http_etag_matches(if_none_match, iface->etag)) {
+    soup_message_set_status(msg, SOUP_STATUS_NOT_MODIFIED);
+    return;
+  }
 
-  gchar *application_url_str = g_strdup_printf("http://%s:%d%s/", iface_ipv4_address, GDIAL_REST_HTTP_PORT, GDIAL_REST_HTTP_APPS_URI);
-  soup_message_headers_replace (msg->response_headers, "Application-URL", application_url_str);
-  g_free(application_url_str);
-  soup_message_set_response(msg, "text/xml; charset=utf-8", SOUP_MEMORY_STATIC, dd_xml_response_str_, dd_xml_response_str_len);
+  gsize response_len = 0;
+  gconstpointer response_data = g_bytes_get_data(dd_xml_response_, &response_len);
+  SoupBuffer *response_buffer = soup_buffer_new_with_owner(response_data, response_len, g_bytes_ref(dd_xml_response_), (GDestroyNotify)g_bytes_unref);
+  soup_message_headers_replace(msg->response_headers, "Content-Type", "text/xml; charset=utf-8");
+  soup_message_body_truncate(msg->response_body);
+  soup_message_body_append_buffer(msg->response_body, response_buffer);
+  soup_buffer_free(response_buffer);
   soup_message_set_status(msg, SOUP_STATUS_OK);
   GDIAL_CHECK("Content-Type:text/xml");
-  GDIAL_CHECK("Application-URL: exist");
 }
 
-int gdial_ssdp_init(SoupServer *ssdp_http_server, GMutex *friendlyname_mutex, GDialOptions *options, gboolean *friendlyname_changed) {
+void gdial_ssdp_device_changed() {
+  /*
+   * may be called from any thread, render on the discovery thread
+   */
+  if (ssdp_context_ == NULL) return;
+  g_main_context_invoke(ssdp_context_, ssdp_device_description_render_cb, NULL);
+}
 
-  g_return_val_if_fail(ssdp_http_server != NULL, -1);
-  g_return_val_if_fail(options != NULL, -1);
-  g_return_val_if_fail(options->iface_name != NULL, -1);
+typedef struct {
+  GSourceFunc func;
+  gpointer data;
+  GMutex lock;
+  GCond cond;
+  gboolean done;
+} GDialSsdpCall;
+
+static gboolean ssdp_call_dispatch(gpointer user_data) {
+  GDialSsdpCall *call = (GDialSsdpCall *)user_data;
+  call->func(call->data);
+  g_mutex_lock(&call->lock);
+  call->done = TRUE;
+  g_cond_signal(&call->cond);
+  g_mutex_unlock(&call->lock);
+  return G_SOURCE_REMOVE;
+}
 
-  friendlyname_changed_ = friendlyname_changed;
-  friendlyname_mutex_ = friendlyname_mutex;
-  gdial_options_ = options;
-  if (gdial_options_->friendly_name == NULL) gdial_options_->friendly_name = g_strdup(GDIAL_SSDP_FRIENDLY_DEFAULT);
-  if (gdial_options_->manufacturer== NULL) gdial_options_->manufacturer = g_strdup(GDIAL_SSDP_MANUFACTURER_DEFAULT);
-  if (gdial_options_->model_name== NULL) gdial_options_->model_name = g_strdup(GDIAL_SSDP_MODELNAME_DEFAULT);
-  if (gdial_options_->uuid == NULL) gdial_options_->uuid = g_strdup(GDIAL_SSDP_DEVICE_UUID_DEFAULT);
-  if (gdial_options_->iface_name == NULL) gdial_options_->iface_name = g_strdup(GDIAL_IFACE_NAME_DEFAULT);
+/*
+ * Run @func on the discovery thread and wait for it to finish. Runs
+ * @func directly when called from the discovery thread itself.
+ */
+static void ssdp_context_invoke_sync(GSourceFunc func, gpointer data) {
+  GDialSsdpCall call = {func, data};
+  g_mutex_init(&call.lock);
+  g_cond_init(&call.cond);
+  g_main_context_invoke(ssdp_context_, ssdp_call_dispatch, &call);
+  g_mutex_lock(&call.lock);
+  while (!call.done) {
+    g_cond_wait(&call.cond, &call.lock);
+  }
+  g_mutex_unlock(&call.lock);
+  g_mutex_clear(&call.lock);
+  g_cond_clear(&call.cond);
+}
 
-  GError *error = NULL;
+static gpointer ssdp_thread_func(gpointer user_data) {
+  g_main_context_push_thread_default(ssdp_context_);
+  if (gdial_options_->discovery_priority != 0) {
+    /* per-thread on Linux, lowering the value needs CAP_SYS_NICE */
+    if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), gdial_options_->discovery_priority) != 0) {
+      g_printerr("gdial ssdp: cannot set discovery thread priority %d: %s\r\n", gdial_options_->discovery_priority, g_strerror(errno));
+    }
+  }
+  g_main_loop_run(ssdp_loop_);
+  g_main_context_pop_thread_default(ssdp_context_);
+  return NULL;
+}
 
-  iface_ipv4_address = gdial_plat_util_get_iface_ipv4_addr(gdial_options_->iface_name);
-  if (!iface_ipv4_address) {
-    return EXIT_FAILURE;
+static gboolean ssdp_http_server_listen_all() {
+  /*
+   * a SoupServer can't drop a single listener, so all of them are rebound;
+   * listeners attach to the thread-default context, i.e. the discovery thread
+   */
+  gboolean success = TRUE;
+  soup_server_disconnect(ssdp_http_server_);
+  for (guint i = 0; i < ssdp_interfaces_->len; i++) {
+    GDialSsdpInterface *iface = g_ptr_array_index(ssdp_interfaces_, i);
+    GError *error = NULL;
+    GSocketAddress *listen_address = g_inet_socket_address_new(iface->inet_address, GDIAL_SSDP_HTTP_PORT);
+    if (!soup_server_listen(ssdp_http_server_, listen_address, 0, &error)) {
+      g_printerr("%s\r\n", error->message);
+      g_error_free(error);
+      success = FALSE;
+    }
+    else {
+      g_print("Listening on http://%s:%d/\r\n", iface->ipv4_address, GDIAL_SSDP_HTTP_PORT);
+    }
+    g_object_unref(listen_address);
   }
+  return success;
+}
 
+static gboolean ssdp_gssdp_start(GDialSsdpInterface *iface, GDialDeviceIdentity *identity) {
+  GError *error = NULL;
   GSSDPClient *ssdp_client = gssdp_client_new(
 #ifndef HAVE_GSSDP_VERSION_1_2_OR_NEWER
     NULL,
 #endif
-    gdial_options_->iface_name, &error);
+    iface->iface_name, &error);
 
   if (!ssdp_client || error) {
       g_printerr("%s\r\n", error->message);
       g_error_free(error);
-      return EXIT_FAILURE;
+      return FALSE;
   }
 
   /*
@@ -159,48 +368,236 @@ int gdial_ssdp_init(SoupServer *ssdp_http_server, GMutex *friendlyname_mutex, GD
   GDIAL_CHECK("BOOTID.UPNP.ORG");
 
   GSSDPResourceGroup *ssdp_resource_group = gssdp_resource_group_new(ssdp_client);
-  gchar *dial_ssdp_USN = g_strdup_printf(DIAL_SSDP_USN_FMT, gdial_options_->uuid);
-  gchar *dial_ssdp_LOCATION = g_strdup_printf(DIAL_SSDP_LOCATION_FMT, iface_ipv4_address, GDIAL_SSDP_HTTP_PORT);
-  ssdp_resource_id_ =
+  gchar *dial_ssdp_USN = g_strdup_printf(DIAL_SSDP_USN_FMT, identity->uuid);
+  gchar *dial_ssdp_LOCATION = g_strdup_printf(DIAL_SSDP_LOCATION_FMT, iface->ipv4_address, GDIAL_SSDP_HTTP_PORT);
+  iface->resource_id =
     gssdp_resource_group_add_resource_simple (ssdp_resource_group, dial_ssdp_ST_target, dial_ssdp_USN, dial_ssdp_LOCATION);
   gssdp_resource_group_set_available (ssdp_resource_group, FALSE);
   g_free(dial_ssdp_USN);
   g_free(dial_ssdp_LOCATION);
 
-  ssdp_resource_group_ = ssdp_resource_group;
+  iface->resource_group = ssdp_resource_group;
+  iface->client = ssdp_client;
+  return TRUE;
+}
+
+static void ssdp_gssdp_stop(GDialSsdpInterface *iface) {
+  if (iface->client == NULL) return;
+  gssdp_resource_group_remove_resource(iface->resource_group, iface->resource_id);
+  gssdp_client_clear_headers(iface->client);
+  g_object_unref(iface->resource_group);
+  g_object_unref(iface->client);
+  iface->resource_group = NULL;
+  iface->client = NULL;
+}
+
+static void ssdp_interface_set_available(GDialSsdpInterface *iface, gboolean available) {
+  if (iface->responder) {
+    gdial_ssdp_responder_set_available(iface->responder, available);
+  }
+  else if (iface->resource_group) {
+    gssdp_resource_group_set_available (iface->resource_group, available);
+  }
+}
+
+static void ssdp_interface_free(gpointer data) {
+  GDialSsdpInterface *iface = (GDialSsdpInterface *)data;
+  if (iface->responder) {
+    gdial_ssdp_responder_free(iface->responder);
+  }
+  ssdp_gssdp_stop(iface);
+  if (iface->inet_address) g_object_unref(iface->inet_address);
+  if (iface->dd_xml) g_bytes_unref(iface->dd_xml);
+  g_free(iface->iface_name);
+  g_free(iface->ipv4_address);
+  g_free(iface->application_url);
+  g_free(iface->etag);
+  g_free(iface);
+}
+
+static gboolean ssdp_start_cb(gpointer user_data) {
+  ssdp_interfaces_ = g_ptr_array_new_with_free_func(ssdp_interface_free);
+  ssdp_config_id_ = (guint)(g_get_real_time() / G_USEC_PER_SEC) & 0xFFFFFF;
+  ssdp_shield_ = gdial_shield_new("dd.xml");
+  gdial_shield_set_throttle(ssdp_shield_, MAX(gdial_options_->throttle_rate, 0), MAX(gdial_options_->throttle_burst, 0), MAX(gdial_options_->throttle_max_delay, 0));
+  gdial_shield_server(ssdp_shield_, ssdp_http_server_);
+
+  ssdp_device_description_render();
+  soup_server_add_handler(ssdp_http_server_, "/dd.xml", ssdp_http_server_callback, NULL, NULL);
+  return G_SOURCE_REMOVE;
+}
+
+int gdial_ssdp_init(SoupServer *ssdp_http_server, GDialOptions *options) {
+
+  g_return_val_if_fail(ssdp_http_server != NULL, -1);
+  g_return_val_if_fail(options != NULL, -1);
+
+  gdial_options_ = options;
 
   g_object_ref(ssdp_http_server);
   ssdp_http_server_ = ssdp_http_server;
 
-  soup_server_add_handler(ssdp_http_server_, "/dd.xml", ssdp_http_server_callback, NULL, NULL);
-  ssdp_client_ = ssdp_client;
+  ssdp_context_ = g_main_context_new();
+  ssdp_loop_ = g_main_loop_new(ssdp_context_, FALSE);
+  ssdp_thread_ = g_thread_new("gdial-ssdp", ssdp_thread_func, NULL);
+  ssdp_context_invoke_sync(ssdp_start_cb, NULL);
 
   return 0;
 }
 
-int gdial_ssdp_term() {
-  soup_server_remove_handler(ssdp_http_server_, "/dd.xml");
-  gssdp_resource_group_remove_resource(ssdp_resource_group_, ssdp_resource_id_);
+typedef struct {
+  const gchar *iface_name;
+  const gchar *ipv4_address;
+  int result;
+} GDialSsdpInterfaceCall;
+
+static gboolean ssdp_set_interface_cb(gpointer user_data) {
+  GDialSsdpInterfaceCall *call = (GDialSsdpInterfaceCall *)user_data;
+  const gchar *iface_name = call->iface_name;
+  const gchar *ipv4_address = call->ipv4_address;
+
+  GDialSsdpInterface *iface = NULL;
+  for (guint i = 0; i < ssdp_interfaces_->len && iface == NULL; i++) {
+    GDialSsdpInterface *candidate = g_ptr_array_index(ssdp_interfaces_, i);
+    if (g_strcmp0(candidate->iface_name, iface_name) == 0) iface = candidate;
+  }
+  if (iface && g_strcmp0(iface->ipv4_address, ipv4_address) == 0) {
+    call->result = 0;
+    return G_SOURCE_REMOVE;
+  }
+  g_print("gdial_ssdp_set_interface: %s %s\r\n", iface_name, ipv4_address);
+
+  gboolean added = (iface == NULL);
+  if (added) {
+    iface = g_new0(GDialSsdpInterface, 1);
+    iface->iface_name = g_strdup(iface_name);
+  }
+  else {
+    iface->address_changed_us = g_get_monotonic_time();
+  }
+  g_free(iface->ipv4_address);
+  iface->ipv4_address = g_strdup(ipv4_address);
+  if (iface->inet_address) g_object_unref(iface->inet_address);
+  iface->inet_address = g_inet_address_new_from_string(ipv4_address);
+
+  GDialDeviceIdentity *identity = gdial_device_identity_get();
+  GError *error = NULL;
+  gboolean ok = TRUE;
+  if (gdial_options_->native_ssdp) {
+    if (iface->responder) {
+      ok = gdial_ssdp_responder_rebind(iface->responder, ipv4_address, &error);
+    }
+    else {
+      iface->responder = gdial_ssdp_responder_new(ssdp_context_, iface->iface_name, ipv4_address, gdial_options_->ssdp_notify_interval, !gdial_options_->no_ssdp_filter, &error);
+      ok = (iface->responder != NULL);
+    }
+    if (!ok) {
+      g_printerr("%s\r\n", error->message);
+      g_error_free(error);
+    }
+  }
+  else {
+    /* gssdp binds to the address the interface had when the client was created */
+    ssdp_gssdp_stop(iface);
+    ok = ssdp_gssdp_start(iface, identity);
+  }
+
+  /* new Application-URL, LOCATION and CONFIGID, then (re-)announce */
+  ssdp_interface_render(iface, identity);
+  gdial_device_identity_unref(identity);
+  if (added) g_ptr_array_add(ssdp_interfaces_, iface);
+  ok = ssdp_http_server_listen_all() && ok;
+  if (ssdp_available_) {
+    ssdp_interface_set_available(iface, TRUE);
+  }
+  call->result = ok ? 0 : EXIT_FAILURE;
+  return G_SOURCE_REMOVE;
+}
+
+int gdial_ssdp_set_interface(const gchar *iface_name, const gchar *ipv4_address) {
+  g_return_val_if_fail(ssdp_context_ != NULL && iface_name != NULL && ipv4_address != NULL, -1);
+  GDialSsdpInterfaceCall call = {iface_name, ipv4_address, 0};
+  ssdp_context_invoke_sync(ssdp_set_interface_cb, &call);
+  return call.result;
+}
+
+static void ssdp_dump_stats() {
+  gdial_shield_dump_stats(ssdp_shield_);
+  for (guint i = 0; i < ssdp_interfaces_->len; i++) {
+    GDialSsdpInterface *iface = g_ptr_array_index(ssdp_interfaces_, i);
+    if (iface->responder == NULL) continue;
+    GDialSsdpResponderStats stats;
+    gdial_ssdp_responder_get_stats(iface->responder, &stats);
+    g_print("ssdp[%s]: received=%" G_GUINT64_FORMAT " answered=%" G_GUINT64_FORMAT " suppressed=%" G_GUINT64_FORMAT " ignored=%" G_GUINT64_FORMAT " pending=%u\r\n",
+      iface->iface_name, stats.received, stats.answered, stats.suppressed, stats.ignored, stats.pending);
+    g_print("ssdp[%s]: datagrams sent=%" G_GUINT64_FORMAT " send_calls=%" G_GUINT64_FORMAT " send_errors=%" G_GUINT64_FORMAT " send_blocked=%" G_GUINT64_FORMAT "\r\n",
+      iface->iface_name, stats.datagrams_sent, stats.send_calls, stats.send_errors, stats.send_blocked);
+    g_print("ssdp[%s]: notify alive=%" G_GUINT64_FORMAT " byebye=%" G_GUINT64_FORMAT " bursts=%" G_GUINT64_FORMAT "\r\n",
+      iface->iface_name, stats.alive_sent, stats.byebye_sent, stats.bursts);
+  }
+}
 
-  if (dd_xml_response_str_) {
-    g_free(dd_xml_response_str_);
+static gboolean ssdp_stop_cb(gpointer user_data) {
+  soup_server_remove_handler(ssdp_http_server_, "/dd.xml");
+  soup_server_disconnect(ssdp_http_server_);
+  ssdp_dump_stats();
+  g_ptr_array_free(ssdp_interfaces_, TRUE);
+  ssdp_interfaces_ = NULL;
+  gdial_shield_free(ssdp_shield_);
+  ssdp_shield_ = NULL;
+
+  if (dd_xml_response_) {
+    g_bytes_unref(dd_xml_response_);
+    dd_xml_response_ = NULL;
   }
+  g_main_loop_quit(ssdp_loop_);
+  return G_SOURCE_REMOVE;
+}
+
+int gdial_ssdp_term() {
+  ssdp_context_invoke_sync(ssdp_stop_cb, NULL);
+  g_thread_join(ssdp_thread_);
+  ssdp_thread_ = NULL;
+  g_main_loop_unref(ssdp_loop_);
+  ssdp_loop_ = NULL;
+  g_main_context_unref(ssdp_context_);
+  ssdp_context_ = NULL;
+
   if (gdial_options_->friendly_name != NULL) g_free(gdial_options_->friendly_name);
   if (gdial_options_->uuid != NULL) g_free(gdial_options_->uuid);
   if (gdial_options_->iface_name != NULL) g_free(gdial_options_->iface_name);
 
-  gssdp_client_clear_headers(ssdp_client_);
-
   g_object_unref(ssdp_http_server_);
-  g_object_unref(ssdp_resource_group_);
-  g_object_unref(ssdp_client_);
 
   return 0;
 }
 
+static gboolean ssdp_set_available_cb(gpointer user_data) {
+  ssdp_available_ = GPOINTER_TO_INT(user_data);
+  for (guint i = 0; i < ssdp_interfaces_->len; i++) {
+    ssdp_interface_set_available(g_ptr_array_index(ssdp_interfaces_, i), ssdp_available_);
+  }
+  return G_SOURCE_REMOVE;
+}
+
 int gdial_ssdp_set_available(gboolean activation_status)
 {
   g_print("gdial_ssdp_set_available activation_status :%d \n ",activation_status);
-  gssdp_resource_group_set_available (ssdp_resource_group_, activation_status);
+  if (ssdp_context_ == NULL) {
+    /* picked up by the discovery thread once it starts */
+    ssdp_available_ = activation_status;
+    return 0;
+  }
+  g_main_context_invoke(ssdp_context_, ssdp_set_available_cb, GINT_TO_POINTER(activation_status ? TRUE : FALSE));
   return 0;
 }
+
+static gboolean ssdp_dump_stats_cb(gpointer user_data) {
+  ssdp_dump_stats();
+  return G_SOURCE_REMOVE;
+}
+
+void gdial_ssdp_dump_stats() {
+  if (ssdp_context_ == NULL) return;
+  g_main_context_invoke(ssdp_context_, ssdp_dump_stats_cb, NULL);
+}
@@ -25,9 +25,16 @@
 
 G_BEGIN_DECLS
 
-int gdial_ssdp_init(SoupServer *server, GMutex *friendlyname_mutex, GDialOptions *options, gboolean *friendlyname_changed);
+int gdial_ssdp_init(SoupServer *server, GDialOptions *options);
 int gdial_ssdp_term();
 int gdial_ssdp_set_available(gboolean activationStatus);
+void gdial_ssdp_device_changed();
+/*
+ * Advertise on @iface_name at @ipv4_address, or move it there if the
+ * interface is already advertised.
+ */
+int gdial_ssdp_set_interface(const gchar *iface_name, const gchar *ipv4_address);
+void gdial_ssdp_dump_stats();
 G_END_DECLS
 
 #endif
@@ -0,0 +1,166 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glib.h>
+#include "gdial-timer.h"
+
+struct _GDialTimerWheel {
+  gint64 tick_us;
+  guint mask;
+  guint64 tick;
+  guint size;
+  GMainContext *context;
+  GSource *source;
+  GDialTimer *slots;
+};
+
+static guint64 gdial_timer_wheel_now(GDialTimerWheel *wheel) {
+  return (guint64)(g_get_monotonic_time() / wheel->tick_us);
+}
+
+static inline void gdial_timer_list_init(GDialTimer *head) {
+  head->next = head->prev = head;
+}
+
+static inline void gdial_timer_list_append(GDialTimer *head, GDialTimer *timer) {
+  timer->prev = head->prev;
+  timer->next = head;
+  head->prev->next = timer;
+  head->prev = timer;
+}
+
+static inline void gdial_timer_list_unlink(GDialTimer *timer) {
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->next = timer->prev = NULL;
+}
+
+static void gdial_timer_wheel_expire_slot(GDialTimerWheel *wheel, GDialTimer *slot, guint64 now) {
+  /*
+   * move the slot aside first, a callback may cancel or re-arm any timer,
+   * including the ones still waiting on this slot for a later round.
+   */
+  GDialTimer pending;
+  if (slot->next == slot) return;
+  pending.next = slot->next;
+  pending.prev = slot->prev;
+  pending.next->prev = &pending;
+  pending.prev->next = &pending;
+  gdial_timer_list_init(slot);
+
+  while (pending.next != &pending) {
+    GDialTimer *timer = pending.next;
+    gdial_timer_list_unlink(timer);
+    if (timer->expires > now) {
+      gdial_timer_list_append(slot, timer);
+      continue;
+    }
+    wheel->size--;
+    timer->func(timer, timer->user_data);
+  }
+}
+
+static gboolean gdial_timer_wheel_tick_callback(gpointer user_data) {
+  GDialTimerWheel *wheel = (GDialTimerWheel *)user_data;
+  const guint64 now = gdial_timer_wheel_now(wheel);
+  if (now - wheel->tick > wheel->mask) {
+    /* fell behind a full revolution, every slot needs a look */
+    guint i;
+    for (i = 0; i <= wheel->mask; i++) {
+      gdial_timer_wheel_expire_slot(wheel, &wheel->slots[i], now);
+    }
+  }
+  else {
+    while (wheel->tick < now) {
+      wheel->tick++;
+      gdial_timer_wheel_expire_slot(wheel, &wheel->slots[wheel->tick & wheel->mask], now);
+    }
+  }
+  wheel->tick = now;
+  if (wheel->size == 0) {
+    g_source_unref(wheel->source);
+    wheel->source = NULL;
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+GDialTimerWheel *gdial_timer_wheel_new(guint tick_ms, guint slots) {
+  GDialTimerWheel *wheel = g_new0(GDialTimerWheel, 1);
+  guint i, n = 1;
+  while (n < slots) n <<= 1;
+  wheel->tick_us = MAX(tick_ms, 1) * G_GINT64_CONSTANT(1000);
+  wheel->mask = n - 1;
+  wheel->slots = g_new(GDialTimer, n);
+  for (i = 0; i < n; i++) {
+    gdial_timer_list_init(&wheel->slots[i]);
+  }
+  wheel->tick = gdial_timer_wheel_now(wheel);
+  wheel->context = g_main_context_ref_thread_default();
+  return wheel;
+}
+
+void gdial_timer_wheel_free(GDialTimerWheel *wheel) {
+  guint i;
+  if (wheel == NULL) return;
+  for (i = 0; i <= wheel->mask; i++) {
+    while (wheel->slots[i].next != &wheel->slots[i]) {
+      gdial_timer_list_unlink(wheel->slots[i].next);
+    }
+  }
+  if (wheel->source) {
+    g_source_destroy(wheel->source);
+    g_source_unref(wheel->source);
+  }
+  g_main_context_unref(wheel->context);
+  g_free(wheel->slots);
+  g_free(wheel);
+}
+
+guint gdial_timer_wheel_size(GDialTimerWheel *wheel) {
+  g_return_val_if_fail(wheel != NULL, 0);
+  return wheel->size;
+}
+
+void gdial_timer_schedule(GDialTimerWheel *wheel, GDialTimer *timer, guint timeout_ms, GDialTimerFunc func, gpointer user_data) {
+  g_return_if_fail(wheel != NULL && timer != NULL && func != NULL);
+  gdial_timer_cancel(wheel, timer);
+
+  const guint64 now = gdial_timer_wheel_now(wheel);
+  if (wheel->source == NULL) {
+    /* the wheel was idle, nothing is left behind in the skipped slots */
+    wheel->tick = now;
+    wheel->source = g_timeout_source_new((guint)(wheel->tick_us / 1000));
+    g_source_set_callback(wheel->source, gdial_timer_wheel_tick_callback, wheel, NULL);
+    g_source_attach(wheel->source, wheel->context);
+  }
+  const guint64 ticks = (timeout_ms * G_GINT64_CONSTANT(1000) + wheel->tick_us - 1) / wheel->tick_us;
+  timer->expires = MAX(now, wheel->tick) + MAX(ticks, 1);
+  timer->func = func;
+  timer->user_data = user_data;
+  gdial_timer_list_append(&wheel->slots[timer->expires & wheel->mask], timer);
+  wheel->size++;
+}
+
+void gdial_timer_cancel(GDialTimerWheel *wheel, GDialTimer *timer) {
+  g_return_if_fail(wheel != NULL && timer != NULL);
+  if (!gdial_timer_is_pending(timer)) return;
+  gdial_timer_list_unlink(timer);
+  wheel->size--;
+}
@@ -0,0 +1,59 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GDIAL_TIMER_H_
+#define GDIAL_TIMER_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Hashed timing wheel. All timers of a wheel are driven by one periodic
+ * main-loop source that only exists while at least one timer is pending.
+ * The source runs on the thread-default main context of the creating thread.
+ * Timers are intrusive: the owner embeds a GDialTimer in its own struct, so
+ * scheduling and cancelling never allocate.
+ */
+typedef struct _GDialTimerWheel GDialTimerWheel;
+typedef struct _GDialTimer GDialTimer;
+typedef void (*GDialTimerFunc)(GDialTimer *timer, gpointer user_data);
+
+struct _GDialTimer {
+  /*< private >*/
+  GDialTimer *next;
+  GDialTimer *prev;
+  guint64 expires;
+  GDialTimerFunc func;
+  gpointer user_data;
+};
+
+GDialTimerWheel *gdial_timer_wheel_new(guint tick_ms, guint slots);
+void gdial_timer_wheel_free(GDialTimerWheel *wheel);
+guint gdial_timer_wheel_size(GDialTimerWheel *wheel);
+
+/*
+ * (Re)arm @timer to fire once after @timeout_ms, rounded up to the wheel tick.
+ */
+void gdial_timer_schedule(GDialTimerWheel *wheel, GDialTimer *timer, guint timeout_ms, GDialTimerFunc func, gpointer user_data);
+void gdial_timer_cancel(GDialTimerWheel *wheel, GDialTimer *timer);
+#define gdial_timer_is_pending(timer) ((timer)->next != NULL)
+
+G_END_DECLS
+#endif
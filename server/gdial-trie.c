@@ -0,0 +1,127 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "gdial-trie.h"
+
+typedef struct _GDialTrieNode {
+  struct _GDialTrieNode *child;
+  struct _GDialTrieNode *sibling;
+  gpointer value;
+  guchar c;
+} GDialTrieNode;
+
+struct _GDialTrie {
+  GDialTrieNode root;
+};
+
+/*
+ * siblings are kept sorted so that a miss stops early
+ */
+static GDialTrieNode *gdial_trie_node_find_child(GDialTrieNode *node, guchar c) {
+  GDialTrieNode *child = node->child;
+  while (child && child->c < c) child = child->sibling;
+  return (child && child->c == c) ? child : NULL;
+}
+
+static GDialTrieNode *gdial_trie_node_add_child(GDialTrieNode *node, guchar c) {
+  GDialTrieNode **link = &node->child;
+  while (*link && (*link)->c < c) link = &(*link)->sibling;
+  if (*link && (*link)->c == c) return *link;
+  GDialTrieNode *child = g_new0(GDialTrieNode, 1);
+  child->c = c;
+  child->sibling = *link;
+  *link = child;
+  return child;
+}
+
+static void gdial_trie_node_free_children(GDialTrieNode *node) {
+  GDialTrieNode *child = node->child;
+  while (child) {
+    GDialTrieNode *sibling = child->sibling;
+    gdial_trie_node_free_children(child);
+    g_free(child);
+    child = sibling;
+  }
+  node->child = NULL;
+}
+
+GDialTrie *gdial_trie_new(void) {
+  return g_new0(GDialTrie, 1);
+}
+
+void gdial_trie_insert(GDialTrie *trie, const gchar *key, gpointer value) {
+  g_return_if_fail(trie != NULL && key != NULL);
+  if (*key == '\0') return;
+  GDialTrieNode *node = &trie->root;
+  const guchar *p;
+  for (p = (const guchar *)key; *p; p++) {
+    node = gdial_trie_node_add_child(node, *p);
+  }
+  node->value = value;
+}
+
+gpointer gdial_trie_lookup_prefix(GDialTrie *trie, const gchar *str) {
+  g_return_val_if_fail(trie != NULL && str != NULL, NULL);
+  GDialTrieNode *node = &trie->root;
+  gpointer value = NULL;
+  const guchar *p;
+  for (p = (const guchar *)str; *p; p++) {
+    node = gdial_trie_node_find_child(node, *p);
+    if (node == NULL) break;
+    if (node->value) value = node->value;
+  }
+  return value;
+}
+
+void gdial_trie_insert_reversed(GDialTrie *trie, const gchar *key, gpointer value) {
+  g_return_if_fail(trie != NULL && key != NULL);
+  if (*key == '\0') return;
+  GDialTrieNode *node = &trie->root;
+  const guchar *p = (const guchar *)key + strlen(key);
+  while (p-- > (const guchar *)key) {
+    node = gdial_trie_node_add_child(node, *p);
+  }
+  node->value = value;
+}
+
+gpointer gdial_trie_lookup_suffix(GDialTrie *trie, const gchar *str) {
+  g_return_val_if_fail(trie != NULL && str != NULL, NULL);
+  GDialTrieNode *node = &trie->root;
+  gpointer value = NULL;
+  const guchar *p = (const guchar *)str + strlen(str);
+  while (p-- > (const guchar *)str) {
+    node = gdial_trie_node_find_child(node, *p);
+    if (node == NULL) break;
+    if (node->value) value = node->value;
+  }
+  return value;
+}
+
+void gdial_trie_remove_all(GDialTrie *trie) {
+  g_return_if_fail(trie != NULL);
+  gdial_trie_node_free_children(&trie->root);
+}
+
+void gdial_trie_free(GDialTrie *trie) {
+  if (trie == NULL) return;
+  gdial_trie_remove_all(trie);
+  g_free(trie);
+}
@@ -0,0 +1,47 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GDIAL_TRIE_H_
+#define GDIAL_TRIE_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Byte-wise trie mapping string keys to values, used to resolve the longest
+ * registered key that is a prefix of a given string in O(strlen) time,
+ * independent of the number of keys. Keys added with gdial_trie_insert_reversed()
+ * are stored back to front and are matched as suffixes instead.
+ */
+typedef struct _GDialTrie GDialTrie;
+
+GDialTrie *gdial_trie_new(void);
+/*
+ * Insert @key, replacing the value of an identical key. Empty keys are ignored.
+ */
+void gdial_trie_insert(GDialTrie *trie, const gchar *key, gpointer value);
+gpointer gdial_trie_lookup_prefix(GDialTrie *trie, const gchar *str);
+void gdial_trie_insert_reversed(GDialTrie *trie, const gchar *key, gpointer value);
+gpointer gdial_trie_lookup_suffix(GDialTrie *trie, const gchar *str);
+void gdial_trie_remove_all(GDialTrie *trie);
+void gdial_trie_free(GDialTrie *trie);
+
+G_END_DECLS
+#endif
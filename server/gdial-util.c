@@ -22,6 +22,7 @@
 #include <libsoup/soup.h>
 #include "gdial-config.h"
 #include "gdial-util.h"
+#include "gdial-uri.h"
 
 gchar *gdial_util_str_str_hashtable_to_string(const GHashTable *ht, const gchar *delimiter, gboolean newline, gsize *length) {
 
@@ -83,14 +84,7 @@ GHashTable * gdial_util_str_str_hashtable_merge(GHashTable *dst, const GHashTabl
 gboolean gdial_util_is_ascii_printable(const gchar *data, gsize length) {
   g_return_val_if_fail(data != NULL && length, FALSE);
 
-  while (length--) {
-    if (g_ascii_isgraph(data[length]) || g_ascii_isspace(data[length])) {
-    }
-    else {
-      return FALSE;
-    }
-  }
-  return TRUE;
+  return gdial_uri_scan(data, length, GDIAL_URI_ENCODE_DEFAULT, NULL);
 }
 
 /*
@@ -0,0 +1,153 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "gdial-xml.h"
+
+#define GDIAL_XML_DECLARATION "<?xml version=\"1.0\"?>\n"
+
+static void gdial_xml_writer_reserve(GDialXmlWriter *writer, gsize extra) {
+  if (G_LIKELY(writer->len + extra < writer->alloc)) return;
+  while (writer->len + extra >= writer->alloc) writer->alloc *= 2;
+  writer->buf = g_realloc(writer->buf, writer->alloc);
+}
+
+static void gdial_xml_writer_append(GDialXmlWriter *writer, const gchar *str, gsize len) {
+  gdial_xml_writer_reserve(writer, len);
+  memcpy(writer->buf + writer->len, str, len);
+  writer->len += len;
+}
+
+#define gdial_xml_writer_append_literal(writer, str) gdial_xml_writer_append(writer, str, sizeof(str) - 1)
+
+static void gdial_xml_writer_append_escaped(GDialXmlWriter *writer, const gchar *str, gboolean is_attribute) {
+  /*
+   * worst case every byte becomes a 6 byte entity; reserve for the common
+   * case and re-reserve only when an entity is actually written.
+   */
+  const gchar *p = str;
+  const gchar *run = str;
+  gdial_xml_writer_reserve(writer, strlen(str));
+  for (; *p; p++) {
+    const gchar *entity = NULL;
+    switch (*p) {
+      case '&': entity = "&amp;"; break;
+      case '<': entity = "&lt;"; break;
+      case '>': entity = "&gt;"; break;
+      case '"': entity = is_attribute ? "&quot;" : NULL; break;
+      case '\n': entity = is_attribute ? "&#10;" : NULL; break;
+      case '\r': entity = "&#13;"; break;
+      case '\t': entity = is_attribute ? "&#9;" : NULL; break;
+      default: break;
+    }
+    if (entity) {
+      gdial_xml_writer_append(writer, run, p - run);
+      gdial_xml_writer_append(writer, entity, strlen(entity));
+      run = p + 1;
+    }
+  }
+  gdial_xml_writer_append(writer, run, p - run);
+}
+
+static void gdial_xml_writer_close_tag(GDialXmlWriter *writer) {
+  if (writer->tag_open) {
+    gdial_xml_writer_append_literal(writer, ">");
+    writer->tag_open = FALSE;
+  }
+}
+
+void gdial_xml_writer_init(GDialXmlWriter *writer, gsize size_hint) {
+  g_return_if_fail(writer != NULL);
+  memset(writer, 0, sizeof(*writer));
+  writer->alloc = MAX(size_hint, 64);
+  writer->buf = g_malloc(writer->alloc);
+  gdial_xml_writer_append_literal(writer, GDIAL_XML_DECLARATION);
+}
+
+void gdial_xml_writer_start_element(GDialXmlWriter *writer, const gchar *name) {
+  g_return_if_fail(writer != NULL && name != NULL);
+  g_return_if_fail(writer->depth < GDIAL_XML_WRITER_MAX_DEPTH);
+  gdial_xml_writer_close_tag(writer);
+  gdial_xml_writer_append_literal(writer, "<");
+  gdial_xml_writer_append(writer, name, strlen(name));
+  writer->elements[writer->depth++] = name;
+  writer->tag_open = TRUE;
+}
+
+void gdial_xml_writer_attribute(GDialXmlWriter *writer, const gchar *name, const gchar *value) {
+  g_return_if_fail(writer != NULL && name != NULL && value != NULL);
+  g_return_if_fail(writer->tag_open);
+  gdial_xml_writer_append_literal(writer, " ");
+  gdial_xml_writer_append(writer, name, strlen(name));
+  gdial_xml_writer_append_literal(writer, "=\"");
+  gdial_xml_writer_append_escaped(writer, value, TRUE);
+  gdial_xml_writer_append_literal(writer, "\"");
+}
+
+void gdial_xml_writer_text(GDialXmlWriter *writer, const gchar *text) {
+  g_return_if_fail(writer != NULL && writer->depth > 0);
+  if (text == NULL || *text == '\0') return;
+  gdial_xml_writer_close_tag(writer);
+  gdial_xml_writer_append_escaped(writer, text, FALSE);
+}
+
+void gdial_xml_writer_end_element(GDialXmlWriter *writer) {
+  g_return_if_fail(writer != NULL && writer->depth > 0);
+  const gchar *name = writer->elements[--writer->depth];
+  if (writer->tag_open) {
+    gdial_xml_writer_append_literal(writer, "/>");
+    writer->tag_open = FALSE;
+    return;
+  }
+  gdial_xml_writer_append_literal(writer, "</");
+  gdial_xml_writer_append(writer, name, strlen(name));
+  gdial_xml_writer_append_literal(writer, ">");
+}
+
+void gdial_xml_writer_element(GDialXmlWriter *writer, const gchar *name, const gchar *text) {
+  gdial_xml_writer_start_element(writer, name);
+  gdial_xml_writer_text(writer, text);
+  gdial_xml_writer_end_element(writer);
+}
+
+gchar *gdial_xml_writer_finish(GDialXmlWriter *writer, gsize *length) {
+  g_return_val_if_fail(writer != NULL, NULL);
+  while (writer->depth > 0) {
+    gdial_xml_writer_end_element(writer);
+  }
+  gdial_xml_writer_append(writer, "\n", 2);
+  writer->len--;
+  if (length) *length = writer->len;
+  gchar *buf = writer->buf;
+  writer->buf = NULL;
+  writer->len = writer->alloc = 0;
+  return buf;
+}
+
+gboolean gdial_xml_is_valid_name(const gchar *name) {
+  /* ASCII subset of the XML Name production, other UTF-8 bytes are let through */
+  const guchar *p = (const guchar *)name;
+  if (p == NULL || *p == '\0') return FALSE;
+  if (!(g_ascii_isalpha(*p) || *p == '_' || *p == ':' || *p >= 0x80)) return FALSE;
+  for (p++; *p; p++) {
+    if (!(g_ascii_isalnum(*p) || *p == '_' || *p == ':' || *p == '-' || *p == '.' || *p >= 0x80)) return FALSE;
+  }
+  return TRUE;
+}
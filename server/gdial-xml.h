@@ -0,0 +1,62 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GDIAL_XML_H_
+#define GDIAL_XML_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define GDIAL_XML_WRITER_MAX_DEPTH 8
+
+/*
+ * Streaming XML writer. Output goes straight into one buffer sized from the
+ * caller's hint (grown only if the hint was short), text and attribute values
+ * are escaped on the way in. The layout matches xmlDocDumpMemory() without
+ * formatting: declaration, newline, compact document, newline.
+ */
+typedef struct {
+  gchar *buf;
+  gsize len;
+  gsize alloc;
+  gint depth;
+  gboolean tag_open;
+  const gchar *elements[GDIAL_XML_WRITER_MAX_DEPTH];
+} GDialXmlWriter;
+
+void gdial_xml_writer_init(GDialXmlWriter *writer, gsize size_hint);
+void gdial_xml_writer_start_element(GDialXmlWriter *writer, const gchar *name);
+void gdial_xml_writer_attribute(GDialXmlWriter *writer, const gchar *name, const gchar *value);
+void gdial_xml_writer_text(GDialXmlWriter *writer, const gchar *text);
+void gdial_xml_writer_end_element(GDialXmlWriter *writer);
+/*
+ * <name>text</name>, or <name/> when @text is NULL or empty
+ */
+void gdial_xml_writer_element(GDialXmlWriter *writer, const gchar *name, const gchar *text);
+/*
+ * Close any open elements and hand the NUL terminated document over to the
+ * caller (free with g_free).
+ */
+gchar *gdial_xml_writer_finish(GDialXmlWriter *writer, gsize *length);
+
+gboolean gdial_xml_is_valid_name(const gchar *name);
+
+G_END_DECLS
+#endif
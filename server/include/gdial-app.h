@@ -22,6 +22,7 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include "gdial-launch.h"
 
 G_BEGIN_DECLS
 
@@ -72,12 +73,17 @@ GType gdial_app_get_type (void);
 
 GDialApp* gdial_app_new(const char *app_name);
 
-GDialAppError gdial_app_start(GDialApp *app, const gchar *payload, const gchar *query, const gchar *additional_data_url, gpointer state_cb_data);
+GDialAppError gdial_app_start(GDialApp *app, GDialLaunchRequest *launch_request, gpointer state_cb_data);
 GDialAppError gdial_app_hide(GDialApp *app);
 GDialAppError gdial_app_resume(GDialApp *app);
 GDialAppError gdial_app_stop(GDialApp *app);
 GDialAppError gdial_app_state(GDialApp *app);
 const gchar *gdial_app_state_to_string(GDialAppState state);
+/*
+ * Error the platform reported with the last state it pushed for @app,
+ * GDIAL_APP_ERROR_NONE if it did not report one.
+ */
+GDialAppError gdial_app_get_state_error(GDialApp *app);
 
 gint gdial_app_get_instance_id(GDialApp *app);
 
@@ -89,6 +95,13 @@ GHashTable *gdial_app_get_additional_dial_data(GDialApp *app);
 void gdial_app_refresh_additional_dial_data(GDialApp *app);
 void gdial_app_clear_additional_dial_data(GDialApp *app);
 gchar * gdial_app_state_response_new(GDialApp *app, const gchar *dial_ver, const gchar *xmlns, int *len);
+/*
+ * Cached form of gdial_app_state_response_new(), rebuilt only after the app's
+ * state or additional dial_data changed. @dial_ver and @xmlns are expected to
+ * be constants. Release with g_bytes_unref().
+ */
+GBytes *gdial_app_state_response_ref(GDialApp *app, const gchar *dial_ver, const gchar *xmlns);
+void gdial_app_dump_stats(void);
 
 GDIAL_STATIC gboolean gdial_app_write_additional_dial_data(const gchar *app_name, const gchar *data, size_t length);
 GDIAL_STATIC gboolean gdial_app_read_additional_dial_data(const gchar *app_name, gchar **data, size_t *length);
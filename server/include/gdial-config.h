@@ -61,6 +61,10 @@ extern "C" {
  * server cmdline options
  */
 #define GDIAL_IFACE_NAME_DEFAULT "lo"
+#define GDIAL_SSDP_DEVICE_UUID_DEFAULT "12345678-abcd-abcd-1234-123456789abc"
+#define GDIAL_SSDP_FRIENDLY_DEFAULT  "FriendXi6"
+#define GDIAL_SSDP_MANUFACTURER_DEFAULT "OEM"
+#define GDIAL_SSDP_MODELNAME_DEFAULT "Xi6"
 #define GDIAL_REST_HTTP_PORT 56889
 #define GDIAL_SSDP_HTTP_PORT 56890
 
@@ -69,6 +73,9 @@ extern "C" {
 #define GDIAL_REST_HTTP_RUN_URI "/run"
 #define GDIAL_REST_HTTP_HIDE_URI "/hide"
 #define GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN (32)
+#define GDIAL_REST_ROUTE_MAX_ELEMENTS (4)
+#define GDIAL_REST_ORIGIN_CACHE_SIZE (16)
+#define GDIAL_REST_ARENA_SIZE (1024)
 #define GDIAL_REST_HTTP_DIAL_DATA_URI "/dial_data"
 
 #define GDIAL_REST_HTTP_MAX_PAYLOAD (4096)
@@ -79,10 +86,46 @@ extern "C" {
 #define GDIAL_APP_DIAL_DATA_MAX_LEN (8*1024)
 #define GDIAL_APP_DIAL_DATA_MAX_KV_LEN (255)
 #define GDIAL_APP_DIAL_DATA_MAX_KV_LEN_STR "255"
-#define GDIAL_THROTTLE_DELAY_US  100000
+#define GDIAL_APP_STATE_RESPONSE_SIZE_HINT (512)
+#define GDIAL_APP_STATE_STALENESS_MS_DEFAULT 2000
+#define GDIAL_APP_STATE_REFRESH_TIMEOUT_MS 3000
+#define GDIAL_APP_STATE_WAIT_MS_DEFAULT 0
+#define GDIAL_REST_STATE_WAIT_TICK_MS 50
+#define GDIAL_REST_STATE_WAIT_SLOTS 64
+#define GDIAL_APP_STATUS_CACHE_SLOTS 32
+#define GDIAL_SSDP_DEVICE_XML_SIZE_HINT (512)
+#define GDIAL_THROTTLE_RATE_DEFAULT 10
+#define GDIAL_THROTTLE_BURST_DEFAULT 20
+#define GDIAL_THROTTLE_MAX_DELAY_MS_DEFAULT 500
+#define GDIAL_THROTTLE_MAX_CLIENTS 64
+#define GDIAL_SHIELD_READ_TIMEOUT_MS 2000
+#define GDIAL_SHIELD_TIMER_TICK_MS 10
+#define GDIAL_SHIELD_TIMER_SLOTS 256
+#define GDIAL_SHIELD_CONN_SLAB_SIZE 32
+#define GDIAL_SHIELD_MAX_HALF_READ_CONNS 16
+#define GDIAL_SHIELD_MAX_HEADER_BYTES 8192
+#define GDIAL_SHIELD_MIN_BYTE_RATE 256
+#define GDIAL_SHIELD_BYTE_RATE_GRACE_MS 500
+#define GDIAL_SHIELD_BUDGET_CHECK_MS 250
+#define GDIAL_SSDP_PORT 1900
+#define GDIAL_SSDP_MULTICAST_ADDR "239.255.255.250"
+#define GDIAL_SSDP_MULTICAST_TTL 2
+#define GDIAL_SSDP_MAX_AGE 1800
+#define GDIAL_SSDP_MAX_MX 5
+#define GDIAL_SSDP_MAX_DATAGRAM_SIZE 1500
+#define GDIAL_SSDP_RESPONDER_RATE 2
+#define GDIAL_SSDP_RESPONDER_BURST 4
+#define GDIAL_SSDP_RESPONDER_MAX_CLIENTS 64
+#define GDIAL_SSDP_RESPONDER_MAX_PENDING 256
+#define GDIAL_SSDP_RESPONDER_MAX_RECV_BATCH 32
+#define GDIAL_SSDP_RESPONDER_SEND_BATCH 32
+#define GDIAL_SSDP_RESPONDER_SEND_QUANTUM_MS 10
+#define GDIAL_SSDP_NOTIFY_BURST_COUNT 3
+#define GDIAL_SSDP_NOTIFY_BURST_INTERVAL_MS 200
+#define GDIAL_SSDP_NOTIFY_INTERVAL_DEFAULT 600
 #define GDIAL_DEBUG g_print
 
-enum {
+typedef enum {
  GDIAL_ERROR_NONE = 0,
  GDIAL_ERROR_NOT_REGISTERED,
  GDIAL_ERROR_FAIL_TO_START,
@@ -0,0 +1,112 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GDIAL_LAUNCH_H_
+#define GDIAL_LAUNCH_H_
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Where the additionalDataUrl goes in the launch string
+ */
+typedef enum {
+  GDIAL_LAUNCH_ADDITIONAL_DATA_URL_APPEND = 0,
+  GDIAL_LAUNCH_ADDITIONAL_DATA_URL_WITH_PAYLOAD,  /* only when there is a payload */
+  GDIAL_LAUNCH_ADDITIONAL_DATA_URL_NONE,
+} GDialLaunchAdditionalDataUrl;
+
+/*
+ * Declarative description of how an app's launch string is made:
+ *
+ *   <url_prefix>[<separator>]<param>[&<param>...]
+ *
+ * where the params, in order and only when present, are the POST query
+ * string (if use_query), <payload_key><payload> and
+ * additionalDataUrl=<url>. The separator is only emitted when the prefix
+ * is not empty. NULL strings are treated as empty.
+ */
+typedef struct {
+  const gchar *url_prefix;
+  const gchar *separator;
+  gboolean use_query;
+  const gchar *payload_key;
+  gboolean encode_payload;
+  GDialLaunchAdditionalDataUrl additional_data_url;
+} GDialLaunchTemplateSpec;
+
+/*
+ * A spec compiled into a segment list
+ */
+typedef struct _GDialLaunchTemplate GDialLaunchTemplate;
+
+GDialLaunchTemplate *gdial_launch_template_compile(const GDialLaunchTemplateSpec *spec);
+void gdial_launch_template_free(GDialLaunchTemplate *launch_template);
+
+/*
+ * A POST body, validated and measured in a single scan
+ */
+typedef struct {
+  const gchar *data;
+  gsize length;
+  /* length once URI-encoded as a query value */
+  gsize encoded_length;
+} GDialLaunchPayload;
+
+/*
+ * Returns FALSE if @data is not printable ASCII. @data need not be NUL
+ * terminated and must outlive @payload.
+ */
+gboolean gdial_launch_payload_init(GDialLaunchPayload *payload, const gchar *data, gsize length);
+
+/*
+ * The launch string of one POST, rendered from a template into a single
+ * refcounted allocation that is sized exactly. The payload is URI-encoded
+ * straight into place when the template asks for it, and
+ * additionalDataUrl always is. @payload may be NULL.
+ *
+ * The request is handed down to the platform as is, and whoever sends it
+ * drops its reference once the IPC call returns.
+ */
+typedef struct _GDialLaunchRequest GDialLaunchRequest;
+
+GDialLaunchRequest *gdial_launch_request_new(const GDialLaunchTemplate *launch_template, const GDialLaunchPayload *payload, const gchar *query, const gchar *additional_data_url);
+GDialLaunchRequest *gdial_launch_request_ref(GDialLaunchRequest *launch_request);
+void gdial_launch_request_unref(GDialLaunchRequest *launch_request);
+const gchar *gdial_launch_request_get_string(const GDialLaunchRequest *launch_request);
+gsize gdial_launch_request_get_length(const GDialLaunchRequest *launch_request);
+
+/*
+ * Per-app registry, filled at startup before any launch and read-only
+ * afterwards. Registering takes ownership of @launch_template and
+ * replaces the built-in template of the same app. Lookup never fails:
+ * apps without a template get the generic one.
+ */
+void gdial_launch_template_register(const gchar *app_name, GDialLaunchTemplate *launch_template);
+const GDialLaunchTemplate *gdial_launch_template_lookup(const gchar *app_name);
+void gdial_launch_template_registry_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
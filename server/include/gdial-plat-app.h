@@ -22,6 +22,7 @@
 
 #include <glib.h>
 #include "gdial-app.h"
+#include "gdial-launch.h"
 
 G_BEGIN_DECLS
 
@@ -34,13 +35,13 @@ typedef void (*gdial_plat_friendlyname_cb)(const char*);
 void gdial_plat_register_activation_cb(gdial_plat_activation_cb cb);
 void gdial_plat_register_friendlyname_cb(gdial_plat_friendlyname_cb cb);
 
-GDialAppError gdial_plat_application_start(const gchar *app_name, const gchar *payload, const gchar *query, const gchar *additional_data_url, gint *instance_id);
+GDialAppError gdial_plat_application_start(const gchar *app_name, GDialLaunchRequest *launch_request, gint *instance_id);
 GDialAppError gdial_plat_application_hide(const gchar *app_name, gint instance_id);
 GDialAppError gdial_plat_application_resume(const gchar *app_name, gint instance_id);
 GDialAppError gdial_plat_application_stop(const gchar *app_name, gint instance_id);
 GDialAppError gdial_plat_application_state(const gchar *app_name, gint instance_id, GDialAppState *state);
 
-void * gdial_plat_application_start_async(const gchar *app_name, const gchar *payload, const gchar *query, const gchar *additional_data_url, void *user_data);
+void * gdial_plat_application_start_async(const gchar *app_name, GDialLaunchRequest *launch_request, void *user_data);
 void * gdial_plat_application_state_async(const gchar *app_name, gint instance_id, void *user_data);
 void * gdial_plat_application_hide_async(const gchar *app_name, gint instance_id, void *user_data);
 void * gdial_plat_application_resume_async(const gchar *app_name, gint instance_id, void *user_data);
@@ -51,8 +52,32 @@ void gdial_plat_application_remove_async_source(void *async_source);
 typedef void (*gdial_plat_application_state_cb)(gint instance_id, GDialAppState state, gpointer user_data);
 void gdial_plat_application_set_state_cb(gdial_plat_application_state_cb cb, gpointer user_data);
 
+/*
+ * Called on the main context for every state the platform pushes for
+ * @app_name, with the error it reported along with it.
+ */
+typedef void (*gdial_plat_application_state_changed_cb)(const gchar *app_name, GDialAppState state, GDialAppError error, gpointer user_data);
+void gdial_plat_register_state_changed_cb(gdial_plat_application_state_changed_cb cb, gpointer user_data);
+
 GDialAppError gdial_plat_system_app(GHashTable *query);
 
+/*
+ * App state is pushed by the platform; a lookup only triggers a refresh
+ * request once the cached state is older than @staleness_ms.
+ */
+void gdial_plat_application_set_state_staleness(guint staleness_ms);
+
+typedef struct {
+  /* messages sent to the platform, of any kind */
+  guint64 notifies;
+  guint64 state_queries;
+  /* state queries that sent a refresh request */
+  guint64 state_refreshes;
+  /* state changes pushed by the platform */
+  guint64 state_updates;
+} GDialPlatIpcStats;
+void gdial_plat_get_ipc_stats(GDialPlatIpcStats *stats);
+
 G_END_DECLS
 
 #endif
@@ -0,0 +1,57 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GDIAL_URI_H_
+#define GDIAL_URI_H_
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Characters escaped as %XX: the ones never allowed in a URI and the
+ * gen-delims, as soup_uri_encode(data, NULL) does. QUERY_VALUE also
+ * escapes '=' and '&', as soup_uri_encode(data, "=&") does.
+ */
+typedef enum {
+  GDIAL_URI_ENCODE_DEFAULT = 0,
+  GDIAL_URI_ENCODE_QUERY_VALUE,
+} GDialUriEncodeMode;
+
+/*
+ * One pass over @data, 8 bytes at a time: returns whether it is all
+ * printable ASCII or whitespace and, if @encoded_length is not NULL,
+ * the length of its encoding in @mode.
+ */
+gboolean gdial_uri_scan(const gchar *data, gsize length, GDialUriEncodeMode mode, gsize *encoded_length);
+
+/*
+ * Encodes @length bytes of @data to @dest, which must have room for the
+ * length gdial_uri_scan() reports. Returns the end of the output, not
+ * NUL terminated.
+ */
+gchar *gdial_uri_encode_to(gchar *dest, const gchar *data, gsize length, GDialUriEncodeMode mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
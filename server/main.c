@@ -20,7 +20,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <signal.h>
 #include <glib.h>
+#include <glib-unix.h>
 #include <libsoup/soup.h>
 #include <json-c/json.h>
 #include <json-c/json_object.h>
@@ -29,12 +31,15 @@
 #include "gdial-config.h"
 #include "gdial-debug.h"
 #include "gdial-options.h"
+#include "gdial-identity.h"
+#include "gdial-netlink.h"
 #include "gdial-shield.h"
 #include "gdial-ssdp.h"
 #include "gdial-rest.h"
 #include "gdial-plat-util.h"
 #include "gdial-plat-dev.h"
 #include "gdial-plat-app.h"
+#include "gdial-launch.h"
 
 static const char *dial_specification_copyright = "Copyright (c) 2017 Netflix, Inc. All rights reserved.";
 
@@ -77,12 +82,68 @@ static GOptionEntry option_entries_[] = {
         0, G_OPTION_ARG_STRING, &options_.app_list,
         APP_LIST_DESCRIPTION, NULL
     },
+    {
+        THROTTLE_RATE_OPTION_LONG,
+        THROTTLE_RATE_OPTION,
+        0, G_OPTION_ARG_INT, &options_.throttle_rate,
+        THROTTLE_RATE_DESCRIPTION, NULL
+    },
+    {
+        THROTTLE_BURST_OPTION_LONG,
+        THROTTLE_BURST_OPTION,
+        0, G_OPTION_ARG_INT, &options_.throttle_burst,
+        THROTTLE_BURST_DESCRIPTION, NULL
+    },
+    {
+        THROTTLE_MAX_DELAY_OPTION_LONG,
+        THROTTLE_MAX_DELAY_OPTION,
+        0, G_OPTION_ARG_INT, &options_.throttle_max_delay,
+        THROTTLE_MAX_DELAY_DESCRIPTION, NULL
+    },
+    {
+        NATIVE_SSDP_OPTION_LONG,
+        NATIVE_SSDP_OPTION,
+        0, G_OPTION_ARG_NONE, &options_.native_ssdp,
+        NATIVE_SSDP_DESCRIPTION, NULL
+    },
+    {
+        NO_SSDP_FILTER_OPTION_LONG,
+        NO_SSDP_FILTER_OPTION,
+        0, G_OPTION_ARG_NONE, &options_.no_ssdp_filter,
+        NO_SSDP_FILTER_DESCRIPTION, NULL
+    },
+    {
+        SSDP_NOTIFY_INTERVAL_OPTION_LONG,
+        SSDP_NOTIFY_INTERVAL_OPTION,
+        0, G_OPTION_ARG_INT, &options_.ssdp_notify_interval,
+        SSDP_NOTIFY_INTERVAL_DESCRIPTION, NULL
+    },
+    {
+        DISCOVERY_PRIORITY_OPTION_LONG,
+        DISCOVERY_PRIORITY_OPTION,
+        0, G_OPTION_ARG_INT, &options_.discovery_priority,
+        DISCOVERY_PRIORITY_DESCRIPTION, NULL
+    },
+    {
+        APP_STATE_STALENESS_OPTION_LONG,
+        APP_STATE_STALENESS_OPTION,
+        0, G_OPTION_ARG_INT, &options_.app_state_staleness,
+        APP_STATE_STALENESS_DESCRIPTION, NULL
+    },
+    {
+        APP_STATE_WAIT_OPTION_LONG,
+        APP_STATE_WAIT_OPTION,
+        0, G_OPTION_ARG_INT, &options_.app_state_wait,
+        APP_STATE_WAIT_DESCRIPTION, NULL
+    },
     { NULL }
 };
 static GMainLoop *loop_ = NULL;
-static const gchar *iface_ipv4_address_ = NULL;
-static gboolean friendlyname_changed;
-static GMutex friendlyname_mutex;
+/*
+ * interfaces from -I in order, and the IPv4 address each one currently has
+ */
+static gchar **iface_names_ = NULL;
+static GHashTable *iface_ipv4_addresses_ = NULL;
 
 static void signal_handler_rest_server_invalid_uri(GDialRestServer *dial_rest_server, const gchar *signal_message, gpointer user_data) {
   g_return_if_fail(dial_rest_server && signal_message);
@@ -96,6 +157,9 @@ static void signal_handler_rest_server_gmainloop_quit(GDialRestServer *dial_rest
   g_main_loop_quit(loop_);
 }
 static GDialRestServer *dial_rest_server = NULL;
+/* interface name -> the REST server listening on its address */
+static GHashTable *iface_rest_servers_ = NULL;
+static GDialShield *rest_shield_ = NULL;
 
 static void server_activation_handler(gboolean status)
 {
@@ -109,24 +173,91 @@ static void server_activation_handler(gboolean status)
 
 static void server_friendlyname_handler(const char *name)
 {
-    g_mutex_lock(&friendlyname_mutex);
+    GDialDeviceIdentity *identity = gdial_device_identity_get();
 
-    g_print("%s new name: %s, old name: %s \r\n ", __PRETTY_FUNCTION__, name, options_.friendly_name);
-    if(g_strcmp0(options_.friendly_name, name) == 0)
+    g_print("%s new name: %s, old name: %s \r\n ", __PRETTY_FUNCTION__, name, identity->friendly_name);
+    if(g_strcmp0(identity->friendly_name, name) == 0)
     {
-        g_print("THE SAME %s: %s == %s \r\n ", __PRETTY_FUNCTION__, options_.friendly_name, name );
-        g_mutex_unlock(&friendlyname_mutex);
+        g_print("THE SAME %s: %s == %s \r\n ", __PRETTY_FUNCTION__, identity->friendly_name, name );
+        gdial_device_identity_unref(identity);
         return;
     }
 
-    if(options_.friendly_name != NULL)
+    gdial_device_identity_publish(gdial_device_identity_new(name, identity->manufacturer,
+        identity->model_name, identity->uuid));
+    gdial_device_identity_unref(identity);
+    gdial_ssdp_device_changed();
+}
+
+static gboolean server_listen(SoupServer *server, const gchar *ipv4_address, guint port) {
+  GError *error = NULL;
+  GSocketAddress *listen_address = g_inet_socket_address_new_from_string(ipv4_address, port);
+  gboolean success = soup_server_listen(server, listen_address, 0, &error);
+  g_object_unref (listen_address);
+  if (!success) {
+    g_printerr("%s\r\n", error->message);
+    g_error_free(error);
+  }
+  return success;
+}
+
+static void gdial_http_server_throttle_callback(SoupServer *server,
+            SoupMessage *msg, const gchar *path, GHashTable *query,
+            SoupClientContext  *client, gpointer user_data)
+{
+  g_print("gdial_http_server_throttle_callback \r\n");
+  soup_message_headers_replace(msg->response_headers, "Connection", "close");
+  soup_message_set_status(msg, SOUP_STATUS_NOT_FOUND);
+}
+
+/*
+ * one REST server per interface, since a SoupServer can't drop a single
+ * listener: an address change rebinds that interface's server only. All of
+ * them serve the same apps and state; the dd.xml server is listened on by
+ * the discovery thread
+ */
+static SoupServer *server_iface_rest_http_server(const gchar *iface_name) {
+  SoupServer *server = g_hash_table_lookup(iface_rest_servers_, iface_name);
+  if (server == NULL) {
+    server = soup_server_new(NULL, NULL);
+    soup_server_add_handler(server, "/", gdial_http_server_throttle_callback, NULL, NULL);
+    gdial_shield_server(rest_shield_, server);
+    if (dial_rest_server) gdial_rest_server_add_soup_instance(dial_rest_server, server);
+    g_hash_table_insert(iface_rest_servers_, g_strdup(iface_name), server);
+  }
+  return server;
+}
+
+static void server_print_uris(SoupServer *server) {
+  GSList *uris = soup_server_get_uris(server);
+  for (GSList *uri =  uris; uri != NULL; uri = uri->next) {
+    char *uri_string = soup_uri_to_string(uri->data, FALSE);
+    g_print("Listening on %s\n", uri_string);
+    g_free(uri_string);
+    soup_uri_free(uri->data);
+  }
+  g_slist_free(uris);
+}
+
+static void server_address_handler(gboolean added, const gchar *iface_name, const gchar *ipv4_address, gpointer user_data)
+{
+    const gchar *current = g_hash_table_lookup(iface_ipv4_addresses_, iface_name);
+    g_print("%s %s %s %s, current %s \r\n", __PRETTY_FUNCTION__, iface_name, added ? "add" : "remove", ipv4_address, current);
+    /*
+     * the monitor only reports a new pick, keep serving on an address that
+     * went away until its replacement shows up
+     */
+    if (!added || g_strcmp0(current, ipv4_address) == 0)
     {
-        g_free(options_.friendly_name);
+        return;
     }
-    options_.friendly_name = g_strdup(name);
-    friendlyname_changed = TRUE;
+    g_hash_table_insert(iface_ipv4_addresses_, g_strdup(iface_name), g_strdup(ipv4_address));
 
-    g_mutex_unlock(&friendlyname_mutex);
+    /* connections on the other interfaces and on loopback are left alone */
+    SoupServer *rest_http_server = server_iface_rest_http_server(iface_name);
+    soup_server_disconnect(rest_http_server);
+    if (server_listen(rest_http_server, ipv4_address, GDIAL_REST_HTTP_PORT)) server_print_uris(rest_http_server);
+    gdial_ssdp_set_interface(iface_name, ipv4_address);
 }
 
 static void signal_handler_rest_server_rest_enable(GDialRestServer *dial_rest_server, const gchar *signal_message, gpointer user_data) {
@@ -141,13 +272,12 @@ static void signal_handler_rest_server_rest_enable(GDialRestServer *dial_rest_se
   }
 }
 
-static void gdial_http_server_throttle_callback(SoupServer *server,
-            SoupMessage *msg, const gchar *path, GHashTable *query,
-            SoupClientContext  *client, gpointer user_data)
-{
-  g_print("gdial_http_server_throttle_callback \r\n");
-  soup_message_headers_replace(msg->response_headers, "Connection", "close");
-  soup_message_set_status(msg, SOUP_STATUS_NOT_FOUND);
+static gboolean signal_handler_dump_stats(gpointer user_data) {
+  gdial_shield_dump_stats(rest_shield_);
+  gdial_app_dump_stats();
+  gdial_rest_server_dump_stats();
+  gdial_ssdp_dump_stats();
+  return G_SOURCE_CONTINUE;
 }
 
 static char* get_app_name(const char *config_name)
@@ -164,9 +294,55 @@ static char* get_app_name(const char *config_name)
     return app_name;
 }
 
+static const gchar *app_launch_json_string(struct json_object *launch, const gchar *key, const gchar *default_value) {
+    struct json_object *value = NULL;
+    if (!json_object_object_get_ex(launch, key, &value) || !json_object_is_type(value, json_type_string)) return default_value;
+    return json_object_get_string(value);
+}
+
+static gboolean app_launch_json_boolean(struct json_object *launch, const gchar *key, gboolean default_value) {
+    struct json_object *value = NULL;
+    if (!json_object_object_get_ex(launch, key, &value) || !json_object_is_type(value, json_type_boolean)) return default_value;
+    return json_object_get_boolean(value);
+}
+
+/*
+ * "launch": {
+ *   "urlPrefix": "source_type=12", "separator": "&", "useQuery": false,
+ *   "payloadKey": "dial=", "encodePayload": true,
+ *   "additionalDataUrl": "append" | "with-payload" | "none"
+ * }
+ * missing keys take the generic app's behaviour
+ */
+static GDialLaunchTemplate *app_launch_template_from_json(struct json_object *launch) {
+    GDialLaunchTemplateSpec spec;
+    spec.url_prefix = app_launch_json_string(launch, "urlPrefix", "");
+    spec.separator = app_launch_json_string(launch, "separator", "&");
+    spec.use_query = app_launch_json_boolean(launch, "useQuery", TRUE);
+    spec.payload_key = app_launch_json_string(launch, "payloadKey", "dialpayload=");
+    spec.encode_payload = app_launch_json_boolean(launch, "encodePayload", TRUE);
+    const gchar *additional_data_url = app_launch_json_string(launch, "additionalDataUrl", "append");
+    if (g_strcmp0(additional_data_url, "with-payload") == 0) {
+        spec.additional_data_url = GDIAL_LAUNCH_ADDITIONAL_DATA_URL_WITH_PAYLOAD;
+    }
+    else if (g_strcmp0(additional_data_url, "none") == 0) {
+        spec.additional_data_url = GDIAL_LAUNCH_ADDITIONAL_DATA_URL_NONE;
+    }
+    else {
+        spec.additional_data_url = GDIAL_LAUNCH_ADDITIONAL_DATA_URL_APPEND;
+    }
+    return gdial_launch_template_compile(&spec);
+}
+
 int main(int argc, char *argv[]) {
 
   GError *error = NULL;
+  options_.throttle_rate = GDIAL_THROTTLE_RATE_DEFAULT;
+  options_.throttle_burst = GDIAL_THROTTLE_BURST_DEFAULT;
+  options_.throttle_max_delay = GDIAL_THROTTLE_MAX_DELAY_MS_DEFAULT;
+  options_.ssdp_notify_interval = GDIAL_SSDP_NOTIFY_INTERVAL_DEFAULT;
+  options_.app_state_staleness = GDIAL_APP_STATE_STALENESS_MS_DEFAULT;
+  options_.app_state_wait = GDIAL_APP_STATE_WAIT_MS_DEFAULT;
   GOptionContext *option_context = g_option_context_new(NULL);
   g_option_context_add_main_entries(option_context, option_entries_, NULL);
 
@@ -178,11 +354,25 @@ int main(int argc, char *argv[]) {
 
   if (!options_.iface_name) options_.iface_name =  g_strdup(GDIAL_IFACE_NAME_DEFAULT);
 
+  iface_names_ = g_strsplit(options_.iface_name, ",", -1);
+  iface_ipv4_addresses_ = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+  /*
+   * start once any of the interfaces has an address, the others are
+   * picked up when their address shows up
+   */
   #define MAX_RETRY 3
   for(int i=1;i<=MAX_RETRY;i++) {
-     iface_ipv4_address_ = gdial_plat_util_get_iface_ipv4_addr(options_.iface_name);
-    if (!iface_ipv4_address_) {
-        g_warn_msg_if_fail(FALSE, "interface %s does not have IP\r\n", options_.iface_name);
+    for (gchar **iface_name = iface_names_; *iface_name; iface_name++) {
+      const gchar *ipv4_address = gdial_plat_util_get_iface_ipv4_addr(*iface_name);
+      if (!ipv4_address) {
+        g_warn_msg_if_fail(FALSE, "interface %s does not have IP\r\n", *iface_name);
+      }
+      else {
+        g_hash_table_insert(iface_ipv4_addresses_, g_strdup(*iface_name), g_strdup(ipv4_address));
+      }
+    }
+    if (g_hash_table_size(iface_ipv4_addresses_) == 0) {
         if(i >= MAX_RETRY )
             return EXIT_FAILURE;
         sleep(2);
@@ -191,45 +381,54 @@ int main(int argc, char *argv[]) {
          break;
      }
   }
+  if (!options_.friendly_name) options_.friendly_name = g_strdup(GDIAL_SSDP_FRIENDLY_DEFAULT);
+  if (!options_.manufacturer) options_.manufacturer = g_strdup(GDIAL_SSDP_MANUFACTURER_DEFAULT);
+  if (!options_.model_name) options_.model_name = g_strdup(GDIAL_SSDP_MODELNAME_DEFAULT);
+  if (!options_.uuid) options_.uuid = g_strdup(GDIAL_SSDP_DEVICE_UUID_DEFAULT);
+  gdial_device_identity_publish(gdial_device_identity_new(options_.friendly_name, options_.manufacturer,
+    options_.model_name, options_.uuid));
+
   gdial_plat_init(g_main_context_default());
+  gdial_plat_application_set_state_staleness(MAX(options_.app_state_staleness, 0));
 
   gdial_plat_register_activation_cb(server_activation_handler);
   gdial_plat_register_friendlyname_cb(server_friendlyname_handler);
 
-  SoupServer * rest_http_server = soup_server_new(NULL, NULL);
+  rest_shield_ = gdial_shield_new("rest");
+  gdial_shield_set_throttle(rest_shield_, MAX(options_.throttle_rate, 0), MAX(options_.throttle_burst, 0), MAX(options_.throttle_max_delay, 0));
+  iface_rest_servers_ = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
   SoupServer * ssdp_http_server = soup_server_new(NULL, NULL);
   SoupServer * local_rest_http_server = soup_server_new(NULL, NULL);
-  soup_server_add_handler(rest_http_server, "/", gdial_http_server_throttle_callback, NULL, NULL);
   soup_server_add_handler(ssdp_http_server, "/", gdial_http_server_throttle_callback, NULL, NULL);
 
-  GSocketAddress *listen_address = g_inet_socket_address_new_from_string(iface_ipv4_address_, GDIAL_REST_HTTP_PORT);
-  gboolean success = soup_server_listen(rest_http_server, listen_address, 0, &error);
-  g_object_unref (listen_address);
-  if (!success) {
-    g_printerr("%s\r\n", error->message);
-    g_error_free(error);
+  SoupServer * rest_http_server = NULL;
+  gboolean listening = TRUE;
+  for (gchar **iface_name = iface_names_; *iface_name; iface_name++) {
+    const gchar *ipv4_address = g_hash_table_lookup(iface_ipv4_addresses_, *iface_name);
+    if (ipv4_address == NULL) continue;
+    SoupServer *server = server_iface_rest_http_server(*iface_name);
+    listening = server_listen(server, ipv4_address, GDIAL_REST_HTTP_PORT) && listening;
+    if (rest_http_server == NULL) rest_http_server = server;
+  }
+  if (!listening) {
     return EXIT_FAILURE;
   }
   else {
-    listen_address = g_inet_socket_address_new_from_string(iface_ipv4_address_, GDIAL_SSDP_HTTP_PORT);
-    success = soup_server_listen(ssdp_http_server, listen_address, 0, &error);
-    g_object_unref (listen_address);
+    gboolean success = soup_server_listen_local(local_rest_http_server, GDIAL_REST_HTTP_PORT, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
     if (!success) {
       g_printerr("%s\r\n", error->message);
       g_error_free(error);
       return EXIT_FAILURE;
     }
-    else {
-      success = soup_server_listen_local(local_rest_http_server, GDIAL_REST_HTTP_PORT, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
-      if (!success) {
-        g_printerr("%s\r\n", error->message);
-        g_error_free(error);
-        return EXIT_FAILURE;
-      }
-    }
   }
 
   dial_rest_server = gdial_rest_server_new(rest_http_server,local_rest_http_server);
+  GHashTableIter iter;
+  gpointer server;
+  g_hash_table_iter_init(&iter, iface_rest_servers_);
+  while (g_hash_table_iter_next(&iter, NULL, &server)) {
+    gdial_rest_server_add_soup_instance(dial_rest_server, server);
+  }
   if (!options_.app_list) {
     g_print("no application is enabled from cmdline \r\n");
   }
@@ -245,8 +444,26 @@ int main(int argc, char *argv[]) {
         char *app_name = get_app_name(config_name);
         g_print("%s is enabled from cmdline\r\n", app_name);
 
+        /*
+         * the value is either the allowed origins array, or an object
+         * with "origins", an optional "launch" template and an optional
+         * "stateWaitMs" overriding --app-state-wait
+         */
         struct json_object *origins = json_object_iter_peek_value(&it);
-        int arraylen = json_object_array_length(origins);
+        gint state_wait_ms = options_.app_state_wait;
+        if (json_object_is_type(origins, json_type_object)) {
+          struct json_object *launch = NULL;
+          if (json_object_object_get_ex(origins, "launch", &launch) && json_object_is_type(launch, json_type_object)) {
+            g_print("\t launch template from cmdline\r\n");
+            gdial_launch_template_register(app_name, app_launch_template_from_json(launch));
+          }
+          struct json_object *state_wait = NULL;
+          if (json_object_object_get_ex(origins, "stateWaitMs", &state_wait) && json_object_is_type(state_wait, json_type_int)) {
+            state_wait_ms = json_object_get_int(state_wait);
+          }
+          if (!json_object_object_get_ex(origins, "origins", &origins)) origins = NULL;
+        }
+        int arraylen = origins ? json_object_array_length(origins) : 0;
 
         GList *allowed_origins = NULL;
         for (int i = 0; i < arraylen; i++) {
@@ -258,6 +475,7 @@ int main(int argc, char *argv[]) {
        }
 
        gdial_rest_server_register_app(dial_rest_server, app_name, NULL, TRUE, TRUE, allowed_origins);
+       gdial_rest_server_set_app_state_wait(dial_rest_server, app_name, MAX(state_wait_ms, 0));
        g_list_free_full(allowed_origins, g_free);
        free(app_name);
 
@@ -271,37 +489,47 @@ int main(int argc, char *argv[]) {
   g_signal_connect(dial_rest_server, "gmainloop-quit", G_CALLBACK(signal_handler_rest_server_gmainloop_quit), NULL);
   g_signal_connect(dial_rest_server, "rest-enable", G_CALLBACK(signal_handler_rest_server_rest_enable), NULL);
 
-  gdial_ssdp_init(ssdp_http_server, &friendlyname_mutex, &options_, &friendlyname_changed);
-  gdial_shield_init();
-  gdial_shield_server(rest_http_server);
-  gdial_shield_server(ssdp_http_server);
-
-  SoupServer * servers[] = {local_rest_http_server,rest_http_server, ssdp_http_server};
-  for (int i = 0; i < sizeof(servers)/sizeof(servers[0]); i++) {
-    GSList *uris = soup_server_get_uris(servers[i]);
-    for (GSList *uri =  uris; uri != NULL; uri = uri->next) {
-      char *uri_string = soup_uri_to_string(uri->data, FALSE);
-      g_print("Listening on %s\n", uri_string);
-      g_free(uri_string);
-      soup_uri_free(uri->data);
-    }
-    g_slist_free(uris);
+  gdial_ssdp_init(ssdp_http_server, &options_);
+  for (gchar **iface_name = iface_names_; *iface_name; iface_name++) {
+    const gchar *ipv4_address = g_hash_table_lookup(iface_ipv4_addresses_, *iface_name);
+    if (ipv4_address) gdial_ssdp_set_interface(*iface_name, ipv4_address);
+  }
+  server_print_uris(local_rest_http_server);
+  g_hash_table_iter_init(&iter, iface_rest_servers_);
+  while (g_hash_table_iter_next(&iter, NULL, &server)) {
+    server_print_uris(server);
   }
 
   /*
    * Use global context
    */
   loop_ = g_main_loop_new (NULL, TRUE);
+  guint dump_stats_source = g_unix_signal_add(SIGUSR1, signal_handler_dump_stats, NULL);
+  GDialNetlinkMonitor *netlink_monitor = gdial_netlink_monitor_new(NULL, (const gchar * const *)iface_names_, server_address_handler, NULL, &error);
+  if (!netlink_monitor) {
+    g_printerr("%s, address changes need a restart\r\n", error->message);
+    g_clear_error(&error);
+  }
   g_main_loop_run (loop_);
-  for (int i = 0; i < sizeof(servers)/sizeof(servers[0]); i++) {
-    soup_server_disconnect(servers[i]);
-    g_object_unref(servers[i]);
+  gdial_netlink_monitor_free(netlink_monitor);
+  g_source_remove(dump_stats_source);
+  soup_server_disconnect(local_rest_http_server);
+  g_object_unref(local_rest_http_server);
+  g_hash_table_iter_init(&iter, iface_rest_servers_);
+  while (g_hash_table_iter_next(&iter, NULL, &server)) {
+    soup_server_disconnect(server);
   }
+  g_hash_table_destroy(iface_rest_servers_);
 
-  gdial_shield_term();
+  gdial_shield_free(rest_shield_);
   gdial_ssdp_term();
+  g_object_unref(ssdp_http_server);
   g_object_unref(dial_rest_server);
   gdial_plat_term();
+  gdial_launch_template_registry_clear();
+  gdial_device_identity_publish(NULL);
+  g_hash_table_destroy(iface_ipv4_addresses_);
+  g_strfreev(iface_names_);
 
   g_main_loop_unref(loop_);
   g_option_context_free(option_context);
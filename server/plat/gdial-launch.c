@@ -0,0 +1,254 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <glib.h>
+
+#include "gdial-launch.h"
+#include "gdial-uri.h"
+
+typedef enum {
+  GDIAL_LAUNCH_SEGMENT_QUERY,
+  GDIAL_LAUNCH_SEGMENT_PAYLOAD,
+  GDIAL_LAUNCH_SEGMENT_ADDITIONAL_DATA_URL,
+} GDialLaunchSegmentType;
+
+typedef struct {
+  GDialLaunchSegmentType type;
+  gchar *key;
+  gsize key_len;
+  gboolean encode;
+  GDialUriEncodeMode encode_mode;
+} GDialLaunchSegment;
+
+struct _GDialLaunchTemplate {
+  gchar *prefix;
+  gsize prefix_len;
+  gchar *separator;
+  gsize separator_len;
+  gboolean additional_data_url_needs_payload;
+  guint n_segments;
+  GDialLaunchSegment segments[3];
+};
+
+struct _GDialLaunchRequest {
+  gint ref_count;
+  gsize length;
+  gchar launch_string[];
+};
+
+static const struct {
+  const gchar *app_name;
+  GDialLaunchTemplateSpec spec;
+} launch_templates_builtin_[] = {
+  /* payload is passed on as is till the cloud side handles encoding */
+  {"YouTube", {"https://www.youtube.com/tv", "?", FALSE, "", FALSE, GDIAL_LAUNCH_ADDITIONAL_DATA_URL_WITH_PAYLOAD}},
+  {"Netflix", {"source_type=12", "&", FALSE, "dial=", TRUE, GDIAL_LAUNCH_ADDITIONAL_DATA_URL_APPEND}},
+};
+
+static const GDialLaunchTemplateSpec launch_template_spec_default_ = {
+  "", "", TRUE, "dialpayload=", TRUE, GDIAL_LAUNCH_ADDITIONAL_DATA_URL_APPEND
+};
+
+static GHashTable *launch_templates_ = NULL;
+static GDialLaunchTemplate *launch_template_default_ = NULL;
+
+static void launch_template_add_segment(GDialLaunchTemplate *launch_template, GDialLaunchSegmentType type, const gchar *key, gboolean encode, GDialUriEncodeMode encode_mode) {
+  GDialLaunchSegment *segment = &launch_template->segments[launch_template->n_segments++];
+  segment->type = type;
+  segment->key = g_strdup(key ? key : "");
+  segment->key_len = strlen(segment->key);
+  segment->encode = encode;
+  segment->encode_mode = encode_mode;
+}
+
+GDialLaunchTemplate *gdial_launch_template_compile(const GDialLaunchTemplateSpec *spec) {
+  g_return_val_if_fail(spec != NULL, NULL);
+
+  GDialLaunchTemplate *launch_template = g_new0(GDialLaunchTemplate, 1);
+  launch_template->prefix = g_strdup(spec->url_prefix ? spec->url_prefix : "");
+  launch_template->prefix_len = strlen(launch_template->prefix);
+  launch_template->separator = g_strdup(spec->separator ? spec->separator : "");
+  launch_template->separator_len = strlen(launch_template->separator);
+  launch_template->additional_data_url_needs_payload =
+    spec->additional_data_url == GDIAL_LAUNCH_ADDITIONAL_DATA_URL_WITH_PAYLOAD;
+
+  if (spec->use_query) {
+    launch_template_add_segment(launch_template, GDIAL_LAUNCH_SEGMENT_QUERY, "", FALSE, GDIAL_URI_ENCODE_DEFAULT);
+  }
+  launch_template_add_segment(launch_template, GDIAL_LAUNCH_SEGMENT_PAYLOAD, spec->payload_key, spec->encode_payload, GDIAL_URI_ENCODE_QUERY_VALUE);
+  if (spec->additional_data_url != GDIAL_LAUNCH_ADDITIONAL_DATA_URL_NONE) {
+    launch_template_add_segment(launch_template, GDIAL_LAUNCH_SEGMENT_ADDITIONAL_DATA_URL, "additionalDataUrl=", TRUE, GDIAL_URI_ENCODE_DEFAULT);
+  }
+  return launch_template;
+}
+
+void gdial_launch_template_free(GDialLaunchTemplate *launch_template) {
+  if (launch_template == NULL) return;
+  for (guint i = 0; i < launch_template->n_segments; i++) {
+    g_free(launch_template->segments[i].key);
+  }
+  g_free(launch_template->prefix);
+  g_free(launch_template->separator);
+  g_free(launch_template);
+}
+
+gboolean gdial_launch_payload_init(GDialLaunchPayload *payload, const gchar *data, gsize length) {
+  g_return_val_if_fail(payload != NULL, FALSE);
+  payload->data = data;
+  payload->length = data ? length : 0;
+  return gdial_uri_scan(payload->data, payload->length, GDIAL_URI_ENCODE_QUERY_VALUE, &payload->encoded_length);
+}
+
+GDialLaunchRequest *gdial_launch_request_new(const GDialLaunchTemplate *launch_template, const GDialLaunchPayload *payload, const gchar *query, const gchar *additional_data_url) {
+  g_return_val_if_fail(launch_template != NULL, NULL);
+
+  const gchar *values[G_N_ELEMENTS(launch_template->segments)];
+  gsize value_lens[G_N_ELEMENTS(launch_template->segments)];
+  gsize len = launch_template->prefix_len;
+  gsize payload_len = payload ? payload->length : 0;
+  guint n_params = 0;
+
+  /*
+   * resolve which segments are present and size the result, so the
+   * request is allocated once and every segment is written in place
+   */
+  for (guint i = 0; i < launch_template->n_segments; i++) {
+    const GDialLaunchSegment *segment = &launch_template->segments[i];
+    const gchar *value = NULL;
+    switch (segment->type) {
+      case GDIAL_LAUNCH_SEGMENT_QUERY:
+        value = query;
+        break;
+      case GDIAL_LAUNCH_SEGMENT_PAYLOAD:
+        value = payload ? payload->data : NULL;
+        break;
+      case GDIAL_LAUNCH_SEGMENT_ADDITIONAL_DATA_URL:
+        if (!launch_template->additional_data_url_needs_payload || payload_len) {
+          value = additional_data_url;
+        }
+        break;
+    }
+    value_lens[i] = (segment->type == GDIAL_LAUNCH_SEGMENT_PAYLOAD) ? payload_len : (value ? strlen(value) : 0);
+    values[i] = value_lens[i] ? value : NULL;
+    if (values[i] == NULL) continue;
+
+    if (n_params > 0) len += 1;
+    else if (launch_template->prefix_len) len += launch_template->separator_len;
+    len += segment->key_len;
+    if (!segment->encode) {
+      len += value_lens[i];
+    }
+    else if (segment->type == GDIAL_LAUNCH_SEGMENT_PAYLOAD) {
+      len += payload->encoded_length;
+    }
+    else {
+      gsize encoded_len = 0;
+      gdial_uri_scan(value, value_lens[i], segment->encode_mode, &encoded_len);
+      len += encoded_len;
+    }
+    n_params++;
+  }
+
+  GDialLaunchRequest *launch_request = g_malloc(sizeof(GDialLaunchRequest) + len + 1);
+  launch_request->ref_count = 1;
+  launch_request->length = len;
+  gchar *p = launch_request->launch_string;
+  memcpy(p, launch_template->prefix, launch_template->prefix_len);
+  p += launch_template->prefix_len;
+  n_params = 0;
+  for (guint i = 0; i < launch_template->n_segments; i++) {
+    if (values[i] == NULL) continue;
+    const GDialLaunchSegment *segment = &launch_template->segments[i];
+    if (n_params > 0) {
+      *p++ = '&';
+    }
+    else if (launch_template->prefix_len) {
+      memcpy(p, launch_template->separator, launch_template->separator_len);
+      p += launch_template->separator_len;
+    }
+    memcpy(p, segment->key, segment->key_len);
+    p += segment->key_len;
+    if (segment->encode) {
+      p = gdial_uri_encode_to(p, values[i], value_lens[i], segment->encode_mode);
+    }
+    else {
+      memcpy(p, values[i], value_lens[i]);
+      p += value_lens[i];
+    }
+    n_params++;
+  }
+  *p = '\0';
+  g_warn_if_fail((gsize)(p - launch_request->launch_string) == len);
+  return launch_request;
+}
+
+GDialLaunchRequest *gdial_launch_request_ref(GDialLaunchRequest *launch_request) {
+  g_return_val_if_fail(launch_request != NULL, NULL);
+  g_atomic_int_inc(&launch_request->ref_count);
+  return launch_request;
+}
+
+void gdial_launch_request_unref(GDialLaunchRequest *launch_request) {
+  if (launch_request == NULL) return;
+  if (g_atomic_int_dec_and_test(&launch_request->ref_count)) {
+    g_free(launch_request);
+  }
+}
+
+const gchar *gdial_launch_request_get_string(const GDialLaunchRequest *launch_request) {
+  g_return_val_if_fail(launch_request != NULL, NULL);
+  return launch_request->launch_string;
+}
+
+gsize gdial_launch_request_get_length(const GDialLaunchRequest *launch_request) {
+  g_return_val_if_fail(launch_request != NULL, 0);
+  return launch_request->length;
+}
+
+static void gdial_launch_template_registry_ensure() {
+  if (launch_templates_) return;
+  launch_templates_ = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)gdial_launch_template_free);
+  for (gsize i = 0; i < G_N_ELEMENTS(launch_templates_builtin_); i++) {
+    g_hash_table_insert(launch_templates_, g_strdup(launch_templates_builtin_[i].app_name),
+      gdial_launch_template_compile(&launch_templates_builtin_[i].spec));
+  }
+  launch_template_default_ = gdial_launch_template_compile(&launch_template_spec_default_);
+}
+
+void gdial_launch_template_register(const gchar *app_name, GDialLaunchTemplate *launch_template) {
+  g_return_if_fail(app_name != NULL && launch_template != NULL);
+  gdial_launch_template_registry_ensure();
+  g_hash_table_replace(launch_templates_, g_strdup(app_name), launch_template);
+}
+
+const GDialLaunchTemplate *gdial_launch_template_lookup(const gchar *app_name) {
+  gdial_launch_template_registry_ensure();
+  const GDialLaunchTemplate *launch_template = app_name ? g_hash_table_lookup(launch_templates_, app_name) : NULL;
+  return launch_template ? launch_template : launch_template_default_;
+}
+
+void gdial_launch_template_registry_clear(void) {
+  if (launch_templates_) {
+    g_hash_table_destroy(launch_templates_);
+    launch_templates_ = NULL;
+  }
+  gdial_launch_template_free(launch_template_default_);
+  launch_template_default_ = NULL;
+}
@@ -22,17 +22,21 @@
 
 #include "gdial-config.h"
 #include "gdial-app.h"
+#include "gdial-plat-app.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-int gdial_os_application_start(const char *app_name, const char *payload, const char *query_string, const char *additional_data_url, int *instance_id);
+int gdial_os_application_start(const char *app_name, GDialLaunchRequest *launch_request, int *instance_id);
 int gdial_os_application_hide(const char *app_name, int instance_id);
 int gdial_os_application_resume(const char *app_name, int instance_id);
 int gdial_os_application_stop(const char *app_name, int instance_id);
 int gdial_os_application_state(const char *app_name, int instance_id, GDialAppState *state);
 int gdial_os_system_app(GHashTable *query);
+void gdial_os_application_set_state_staleness(unsigned int staleness_ms);
+void gdial_os_get_ipc_stats(GDialPlatIpcStats *stats);
+void gdial_os_application_set_state_changed_cb(gdial_plat_application_state_changed_cb cb, gpointer user_data);
 
 #ifdef __cplusplus
 }
@@ -46,9 +46,7 @@ typedef struct {
 
 typedef struct {
   GDialPlatAppAsyncContext common;
-  gchar *payload;
-  gchar *query;
-  gchar *additional_data_url;
+  GDialLaunchRequest *launch_request;
 } GDialPlatAppStartContext;
 
 
@@ -67,11 +65,11 @@ static gboolean GSourceFunc_application_start_async_cb(gpointer user_data) {
   instance_id_++;
 
   if (g_strcmp0(app_start_context->common.name, "Netflix") == 0) {
-    gdial_plat_application_start(app_start_context->common.name, app_start_context->payload, app_start_context->query, app_start_context->additional_data_url, &app_start_context->common.instance_id);
+    gdial_plat_application_start(app_start_context->common.name, app_start_context->launch_request, &app_start_context->common.instance_id);
     gdial_plat_application_state_async(app_async_context->name, app_async_context->instance_id, app_async_context->user_data);
   }
   else if (g_strcmp0(app_start_context->common.name, "Youtube") == 0) {
-    gdial_plat_application_start(app_start_context->common.name, app_start_context->payload, app_start_context->query, app_start_context->additional_data_url, &app_start_context->common.instance_id);
+    gdial_plat_application_start(app_start_context->common.name, app_start_context->launch_request, &app_start_context->common.instance_id);
     gdial_plat_application_state_async(app_async_context->name, app_async_context->instance_id, app_async_context->user_data);
   }
   else {
@@ -99,9 +97,7 @@ static void GDialPlatAppAsyncContext_destroy(gpointer data) {
   app_async_context->user_data = NULL;
   if (app_async_context->type == GDIAL_PLAT_APP_ASYNC_CONTEXT_TYPE_START) {
     GDialPlatAppStartContext *app_start_context = (GDialPlatAppStartContext *)app_async_context;
-    g_free(app_start_context->payload);
-    g_free(app_start_context->query);
-    g_free(app_start_context->additional_data_url);
+    gdial_launch_request_unref(app_start_context->launch_request);
   }
   g_free(app_async_context);
 }
@@ -138,6 +134,11 @@ void gdial_plat_register_friendlyname_cb(gdial_plat_friendlyname_cb cb)
   rtdial_register_friendly_name_cb((rtdial_friendlyname_cb)cb);
 }
 
+void gdial_plat_register_state_changed_cb(gdial_plat_application_state_changed_cb cb, gpointer user_data)
+{
+  gdial_os_application_set_state_changed_cb(cb, user_data);
+}
+
 gint gdial_plat_init(GMainContext *main_context) {
   g_return_val_if_fail(main_context != NULL, GDIAL_APP_ERROR_INTERNAL);
   g_return_val_if_fail((g_main_context_ == NULL || g_main_context_ == main_context), GDIAL_APP_ERROR_INTERNAL);
@@ -161,16 +162,16 @@ gint gdial_plat_init(GMainContext *main_context) {
  * upon return, the app must be in running state. An immediate 2nd invocation of this API
  * for singleton app should not cause a 2nd instance.
  */
-GDialAppError gdial_plat_application_start(const gchar *app_name, const gchar *payload, const gchar *query, const gchar *additional_data_url, gint *instance_id) {
+GDialAppError gdial_plat_application_start(const gchar *app_name, GDialLaunchRequest *launch_request, gint *instance_id) {
   g_return_val_if_fail(app_name != NULL, GDIAL_APP_ERROR_BAD_REQUEST);
   g_return_val_if_fail(instance_id != NULL, GDIAL_APP_ERROR_BAD_REQUEST);
   /*
    * Different app have different cmdline arguments and formats.
    */
-  return gdial_os_application_start(app_name, payload, query, additional_data_url, instance_id);
+  return gdial_os_application_start(app_name, launch_request, instance_id);
 }
 
-void * gdial_plat_application_start_async(const gchar *app_name, const gchar *payload, const gchar *query, const gchar *additional_data_url, void *user_data) {
+void * gdial_plat_application_start_async(const gchar *app_name, GDialLaunchRequest *launch_request, void *user_data) {
   g_return_val_if_fail(app_name != NULL && strlen(app_name), NULL);
   g_return_val_if_fail(gdial_plat_app_async_contexts != NULL, NULL);
 
@@ -180,9 +181,7 @@ void * gdial_plat_application_start_async(const gchar *app_name, const gchar *pa
   app_async_context->common.instance_id = GDIAL_APP_INSTANCE_NONE;
   app_async_context->common.user_data = user_data;
   app_async_context->common.type_str = g_strconcat(app_name, ":start_async", NULL);
-  app_async_context->payload = g_strdup(payload);
-  app_async_context->query = g_strdup(query);
-  app_async_context->additional_data_url = g_strdup(additional_data_url);
+  app_async_context->launch_request = launch_request ? gdial_launch_request_ref(launch_request) : NULL;
   g_hash_table_insert(gdial_plat_app_async_contexts, app_async_context, app_async_context);
   app_async_context->common.async_gsource = g_timeout_add_full(G_PRIORITY_DEFAULT, 1/*milli*/, GSourceFunc_application_start_async_cb, app_async_context, GDestroyNotify_async_source_destory);
   return app_async_context;
@@ -275,3 +274,12 @@ void gdial_plat_term() {
 GDialAppError gdial_plat_system_app(GHashTable *query) {
   return gdial_os_system_app(query);
 }
+
+void gdial_plat_application_set_state_staleness(guint staleness_ms) {
+  gdial_os_application_set_state_staleness(staleness_ms);
+}
+
+void gdial_plat_get_ipc_stats(GDialPlatIpcStats *stats) {
+  g_return_if_fail(stats != NULL);
+  gdial_os_get_ipc_stats(stats);
+}
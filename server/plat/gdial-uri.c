@@ -0,0 +1,132 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <glib.h>
+
+#include "gdial-uri.h"
+
+#define URI_ESCAPE       0x01
+#define URI_ESCAPE_QUERY 0x02 /* & and =, escaped in query values only */
+#define URI_UNPRINTABLE  0x04 /* neither g_ascii_isgraph() nor g_ascii_isspace() */
+
+/*
+ * Escaped: controls, space, " # % / : < > ? @ [ \ ] ^ ` { | } and
+ * everything from DEL up.
+ */
+static const guint8 uri_class_[256] = {
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 1, 1, 1, 1, 1, 5, 5,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  1, 0, 1, 1, 0, 1, 2, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 2, 1, 1,
+  1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0,
+  1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 0, 5,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+};
+
+/*
+ * Payloads are mostly letters and digits, so 8 bytes are first checked
+ * at once for being all alphanumeric, which needs neither escaping nor
+ * validation; other words go through the class table a byte at a time.
+ * The compares are exact per byte as long as no byte has its top bit set.
+ */
+#define URI_ONES  G_GUINT64_CONSTANT(0x0101010101010101)
+#define URI_HIGHS G_GUINT64_CONSTANT(0x8080808080808080)
+
+static inline guint64 uri_word_range(guint64 x, guint8 first, guint8 last) {
+  guint64 ge_first = (x | URI_HIGHS) - URI_ONES * first;
+  guint64 gt_last = (x | URI_HIGHS) - URI_ONES * (last + 1);
+  return ge_first & ~gt_last & URI_HIGHS;
+}
+
+static inline gboolean uri_word_is_alnum(const gchar *data) {
+  guint64 x;
+  memcpy(&x, data, sizeof(x));
+  if (x & URI_HIGHS) return FALSE;
+  /* setting 0x20 folds upper case onto lower case and nothing else onto a-z */
+  guint64 alnum = uri_word_range(x | (URI_ONES * 0x20), 'a', 'z') | uri_word_range(x, '0', '9');
+  return alnum == URI_HIGHS;
+}
+
+static inline guint8 uri_escape_mask(GDialUriEncodeMode mode) {
+  return mode == GDIAL_URI_ENCODE_QUERY_VALUE ? (URI_ESCAPE | URI_ESCAPE_QUERY) : URI_ESCAPE;
+}
+
+gboolean gdial_uri_scan(const gchar *data, gsize length, GDialUriEncodeMode mode, gsize *encoded_length) {
+  g_return_val_if_fail(data != NULL || length == 0, FALSE);
+
+  const guint8 escape_mask = uri_escape_mask(mode);
+  guint8 classes = 0;
+  gsize escapes = 0;
+  gsize i = 0;
+
+  while (i < length) {
+    if (i + sizeof(guint64) <= length && uri_word_is_alnum(data + i)) {
+      i += sizeof(guint64);
+      continue;
+    }
+    gsize end = MIN(i + sizeof(guint64), length);
+    for (; i < end; i++) {
+      guint8 class = uri_class_[(guchar)data[i]];
+      classes |= class;
+      escapes += (class & escape_mask) != 0;
+    }
+    if ((classes & URI_UNPRINTABLE) && encoded_length == NULL) return FALSE;
+  }
+
+  if (encoded_length) *encoded_length = length + 2 * escapes;
+  return !(classes & URI_UNPRINTABLE);
+}
+
+gchar *gdial_uri_encode_to(gchar *dest, const gchar *data, gsize length, GDialUriEncodeMode mode) {
+  static const gchar hex[] = "0123456789ABCDEF";
+  const guint8 escape_mask = uri_escape_mask(mode);
+  gsize i = 0;
+
+  while (i < length) {
+    if (i + sizeof(guint64) <= length && uri_word_is_alnum(data + i)) {
+      memcpy(dest, data + i, sizeof(guint64));
+      dest += sizeof(guint64);
+      i += sizeof(guint64);
+      continue;
+    }
+    gsize end = MIN(i + sizeof(guint64), length);
+    for (; i < end; i++) {
+      guchar c = (guchar)data[i];
+      if (uri_class_[c] & escape_mask) {
+        *dest++ = '%';
+        *dest++ = hex[c >> 4];
+        *dest++ = hex[c & 0xf];
+      }
+      else {
+        *dest++ = c;
+      }
+    }
+  }
+  return dest;
+}
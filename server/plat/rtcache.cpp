@@ -17,96 +17,154 @@
  * limitations under the License.
 */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "rtcache.hpp"
 
-std::string rtAppStatusCache::Netflix_AppCacheId = "DialNetflix";
-std::string rtAppStatusCache::Youtube_AppCacheId = "DialYoutube";
+/*
+ * status word: bits 0-7 state, 8-23 error, 24 reported, 32-63 instance id
+ */
+#define RTCACHE_STATUS_REPORTED (1ull << 24)
 
-std::string rtAppStatusCache :: getAppCacheId(const char *app_name)
+static inline uint64_t rtcache_status_pack(GDialAppState state, GDialAppError error, int instance_id)
 {
-     printf("RTCACHE : %s\n",__FUNCTION__);
-
-     if(!strcmp(app_name,"Netflix"))
-          return rtAppStatusCache::Netflix_AppCacheId;
-     else if(!strcmp(app_name,"YouTube"))
-          return rtAppStatusCache::Youtube_AppCacheId;
-     else
-     {
-          printf("Invalid App Name\n");
-          return "INVALID";
-     }
-
+    return (uint64_t)(state & 0xff) | ((uint64_t)(error & 0xffff) << 8) | RTCACHE_STATUS_REPORTED |
+           ((uint64_t)(uint32_t)instance_id << 32);
 }
 
-void rtAppStatusCache :: setAppCacheId(const char *app_name,std::string id)
+static inline int64_t rtcache_now()
 {
-     printf("RTCACHE : %s\n",__FUNCTION__);
-     if(!strcmp(app_name,"Netflix"))
-     {
-         rtAppStatusCache::Netflix_AppCacheId = id;
-         printf("App cache Id of Netflix updated to %s\n",rtAppStatusCache::Netflix_AppCacheId.c_str());
-     }
-     else if(!strcmp(app_name,"YouTube"))
-     {
-         rtAppStatusCache::Youtube_AppCacheId = id;
-         printf("App cache Id of Youtube updated to %s\n",rtAppStatusCache::Youtube_AppCacheId.c_str());
-     }
-     else
-     {
-         printf("Invalid App Name \n");
-     }
-
+    return std::chrono::steady_clock::now().time_since_epoch().count();
 }
 
-rtError rtAppStatusCache::UpdateAppStatusCache(rtValue app_status)
+static inline guint rtcache_hash(const char *app_name)
 {
-     printf("RTCACHE : %s\n",__FUNCTION__);
-
-      rtError err;
-      rtObjectRef temp = app_status.toObject();
-
-      std::string App_name {temp.get<rtString>("applicationName").cString()};
-      printf("App Name = %s\nApp ID = %s\nApp State = %s\nError = %s\n",App_name.c_str(),temp.get<rtString>("applicationId").cString(),temp.get<rtString>("state").cString(),temp.get<rtString>("error").cString());
+    /* the platform reports names with whatever case the app registered */
+    guint hash = 5381;
+    for (const char *c = app_name; *c; c++)
+        hash = hash * 33 + ((*c >= 'A' && *c <= 'Z') ? *c + ('a' - 'A') : *c);
+    return hash;
+}
 
-      std::string id = getAppCacheId(App_name.c_str());
+static GDialAppState rtcache_parse_state(const char *state)
+{
+    if (state == NULL) return GDIAL_APP_STATE_STOPPED;
+    if (!g_ascii_strcasecmp(state, "running")) return GDIAL_APP_STATE_RUNNING;
+    if (!g_ascii_strcasecmp(state, "suspended")) return GDIAL_APP_STATE_HIDE;
+    return GDIAL_APP_STATE_STOPPED;
+}
 
-      if(doIdExist(id)) {
-          printf("erasing old data\n");
-          err = ObjectCache->erase(id);
-      }
+static GDialAppError rtcache_parse_error(const char *error)
+{
+    if (error == NULL || *error == '\0' || !g_ascii_strcasecmp(error, "none")) return GDIAL_APP_ERROR_NONE;
+    if (!g_ascii_strcasecmp(error, "forbidden")) return GDIAL_APP_ERROR_FORBIDDEN;
+    if (!g_ascii_strcasecmp(error, "unavailable")) return GDIAL_APP_ERROR_UNAVAILABLE;
+    if (!g_ascii_strcasecmp(error, "invalid")) return GDIAL_APP_ERROR_INVALID;
+    return GDIAL_APP_ERROR_INTERNAL;
+}
 
-      err = ObjectCache->insert(id,temp);
-      return err;
+rtAppStatusCache::rtAppStatusCache() : overflow_logged(false), overflow_refresh_sent_at(0)
+{
+    for (Slot &slot : Slots) {
+        slot.name.store(NULL, std::memory_order_relaxed);
+        slot.hash.store(0, std::memory_order_relaxed);
+        slot.status.store(0, std::memory_order_relaxed);
+        slot.updated_at.store(0, std::memory_order_relaxed);
+        slot.refresh_in_flight = false;
+        slot.refresh_sent_at = 0;
+    }
 }
 
-std::string rtAppStatusCache::SearchAppStatusInCache(const char *app_name)
+rtAppStatusCache::~rtAppStatusCache()
 {
-     printf("RTCACHE : %s\n",__FUNCTION__);
+    for (Slot &slot : Slots)
+        g_free((gpointer)slot.name.load(std::memory_order_relaxed));
+}
 
-      std::string id = getAppCacheId(app_name);
-      if(doIdExist(id))
-      {
-         rtObjectRef state_param = ObjectCache->findObject(id);
+const rtAppStatusCache::Slot *rtAppStatusCache::FindSlot(const char *app_name, guint hash) const
+{
+    /* linear probing, slots are never released so a free one ends the chain */
+    const guint start = hash % GDIAL_APP_STATUS_CACHE_SLOTS;
+    for (guint i = 0; i < GDIAL_APP_STATUS_CACHE_SLOTS; i++) {
+        const Slot &slot = Slots[(start + i) % GDIAL_APP_STATUS_CACHE_SLOTS];
+        const char *name = slot.name.load(std::memory_order_acquire);
+        if (name == NULL) return NULL;
+        if (slot.hash.load(std::memory_order_relaxed) == hash && !g_ascii_strcasecmp(name, app_name)) return &slot;
+    }
+    return NULL;
+}
 
-         std::string state {state_param.get<rtString>("state").cString()};
-         printf("App Name = %s\nApp ID = %s\nError = %s\n",state_param.get<rtString>("applicationName").cString(),state_param.get<rtString>("applicationId").cString(),state_param.get<rtString>("error").cString());
-         printf("App State = %s\n",state.c_str());
-         return state;
-      }
+rtAppStatusCache::Slot *rtAppStatusCache::ClaimSlot(const char *app_name)
+{
+    const guint hash = rtcache_hash(app_name);
+    Slot *slot = const_cast<Slot *>(FindSlot(app_name, hash));
+    if (slot) return slot;
+
+    const guint start = hash % GDIAL_APP_STATUS_CACHE_SLOTS;
+    for (guint i = 0; i < GDIAL_APP_STATUS_CACHE_SLOTS; i++) {
+        slot = &Slots[(start + i) % GDIAL_APP_STATUS_CACHE_SLOTS];
+        if (slot->name.load(std::memory_order_relaxed) == NULL) {
+            slot->hash.store(hash, std::memory_order_relaxed);
+            slot->name.store(g_strdup(app_name), std::memory_order_release);
+            return slot;
+        }
+    }
+    if (!overflow_logged) {
+        printf("RTCACHE: all %d slots taken, %s and later apps are not cached\n", GDIAL_APP_STATUS_CACHE_SLOTS, app_name);
+        overflow_logged = true;
+    }
+    return NULL;
+}
 
-      return "NOT_FOUND";
+void rtAppStatusCache::Update(const char *app_name, const char *state, const char *app_id, const char *error)
+{
+    g_return_if_fail(app_name != NULL);
+    Slot *slot = ClaimSlot(app_name);
+    if (slot == NULL) return;
+
+    int instance_id = (app_id && *app_id) ? atoi(app_id) : GDIAL_APP_INSTANCE_NONE;
+    /* the time goes first, a reader that sees the new status never sees an older time */
+    slot->updated_at.store(rtcache_now(), std::memory_order_relaxed);
+    slot->status.store(rtcache_status_pack(rtcache_parse_state(state), rtcache_parse_error(error), instance_id), std::memory_order_release);
+    slot->refresh_in_flight = false;
 }
 
-bool rtAppStatusCache::doIdExist(std::string id)
+bool rtAppStatusCache::Lookup(const char *app_name, rtAppStatus *status) const
 {
-    printf("RTCACHE : %s : \n",__FUNCTION__);
-    auto now = std::chrono::steady_clock::now();
+    const Slot *slot = FindSlot(app_name, rtcache_hash(app_name));
+    if (slot == NULL) return false;
+    const uint64_t word = slot->status.load(std::memory_order_acquire);
+    if (!(word & RTCACHE_STATUS_REPORTED)) return false;
+
+    status->state = (GDialAppState)(word & 0xff);
+    status->error = (GDialAppError)((word >> 8) & 0xffff);
+    status->instance_id = (int)(uint32_t)(word >> 32);
+    status->updated_at = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(slot->updated_at.load(std::memory_order_relaxed)));
+    return true;
+}
 
-    if(ObjectCache->touch(id,now)!= RT_OK)
-    {
-       printf("False\n");
-       return false;
+bool rtAppStatusCache::RefreshNeeded(const char *app_name, std::chrono::milliseconds staleness)
+{
+    Slot *slot = ClaimSlot(app_name);
+    const int64_t now = rtcache_now();
+    const int64_t refresh_timeout = std::chrono::steady_clock::duration(std::chrono::milliseconds(GDIAL_APP_STATE_REFRESH_TIMEOUT_MS)).count();
+    if (slot == NULL) {
+        /* the reply can't be cached either, so keep these to one request per refresh timeout */
+        if (overflow_refresh_sent_at && now - overflow_refresh_sent_at < refresh_timeout)
+            return false;
+        overflow_refresh_sent_at = now;
+        return true;
     }
-    printf("True\n");
+
+    const bool reported = slot->status.load(std::memory_order_relaxed) & RTCACHE_STATUS_REPORTED;
+    if (reported && now - slot->updated_at.load(std::memory_order_relaxed) < std::chrono::steady_clock::duration(staleness).count())
+        return false;
+    /* an unanswered refresh is given up on after a while so a lost reply can't pin the entry */
+    if (slot->refresh_in_flight && now - slot->refresh_sent_at < refresh_timeout)
+        return false;
+
+    slot->refresh_in_flight = true;
+    slot->refresh_sent_at = now;
     return true;
 }
@@ -20,32 +20,62 @@
 #ifndef _RT_CACHE_H_
 #define _RT_CACHE_H_
 
-#include "rtRemoteObjectCache.hpp"
-#include "rtObject.h"
-#include "rtRemote.h"
-#include <sstream>
-#include <iostream>
+#include <atomic>
 #include <chrono>
-#include <stdbool.h>
-#include <string>
+#include <stdint.h>
+#include <glib.h>
+#include "gdial-config.h"
+#include "gdial-app.h"
 
-using namespace std;
+struct rtAppStatus
+{
+    GDialAppState state;
+    int instance_id;
+    GDialAppError error;
+    std::chrono::steady_clock::time_point updated_at;
+};
 
-class rtAppStatusCache : public rtObject
+/*
+ * Last reported status of every app, keyed by app name. Updates (from the
+ * applicationStateChanged events) and the refresh bookkeeping (from
+ * gdial_os_application_state() on the REST path) run on the main context
+ * only; Lookup() is wait-free and may be called from any thread.
+ */
+class rtAppStatusCache
 {
 public:
-    rtAppStatusCache(rtRemoteEnvironment* env) {ObjectCache = new rtRemoteObjectCache(env);};
-    ~rtAppStatusCache() {delete(ObjectCache); };
-    std::string getAppCacheId(const char *app_name);
-    void setAppCacheId(const char *app_name,std::string id);
-    rtError UpdateAppStatusCache(rtValue app_status);
-    std::string SearchAppStatusInCache(const char *app_name);
-    bool doIdExist(std::string id);
+    rtAppStatusCache();
+    ~rtAppStatusCache();
+    void Update(const char *app_name, const char *state, const char *app_id, const char *error);
+    /* false if app_name has never been reported */
+    bool Lookup(const char *app_name, rtAppStatus *status) const;
+    /*
+     * The cache is kept current by applicationStateChanged events. Returns true
+     * if the entry of app_name was last confirmed longer than staleness ago and
+     * no refresh is outstanding, and marks a refresh as outstanding. Apps that
+     * found no free slot share one outstanding refresh.
+     */
+    bool RefreshNeeded(const char *app_name, std::chrono::milliseconds staleness);
 
 private:
-    rtRemoteObjectCache* ObjectCache;
-    static std::string Netflix_AppCacheId;
-    static std::string Youtube_AppCacheId;
+    struct Slot {
+        /* set once when the slot is claimed, never changes afterwards */
+        std::atomic<const char *> name;
+        /* hash of name, stored before it; probes compare it first */
+        std::atomic<guint> hash;
+        /* state, error and instance id packed into one word, see rtcache.cpp */
+        std::atomic<uint64_t> status;
+        std::atomic<int64_t> updated_at;
+        /* writer only */
+        bool refresh_in_flight;
+        int64_t refresh_sent_at;
+    };
+    const Slot *FindSlot(const char *app_name, guint hash) const;
+    Slot *ClaimSlot(const char *app_name);
+    Slot Slots[GDIAL_APP_STATUS_CACHE_SLOTS];
+    /* main context only, for apps that found the table full */
+    bool overflow_logged;
+    int64_t overflow_refresh_sent_at;
 };
 
 #endif
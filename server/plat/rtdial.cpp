@@ -24,6 +24,7 @@
 #include <glib.h>
 #include "gdial-app.h"
 #include "gdial-os-app.h"
+#include "gdial-launch.h"
 #include "rtcast.hpp"
 #include "rtcache.hpp"
 #include "rtdial.hpp"
@@ -42,6 +43,10 @@ static rtdial_friendlyname_cb g_friendlyname_cb = NULL;
 #define RTDIAL_CONNECT_TO_XCAST_SYSTEM_PERIOD_MS 5000
 
 static bool connecting_to_xcast_system {false};
+static std::chrono::milliseconds app_state_staleness_ {GDIAL_APP_STATE_STALENESS_MS_DEFAULT};
+static GDialPlatIpcStats ipc_stats_ {};
+static gdial_plat_application_state_changed_cb state_changed_cb_ = nullptr;
+static gpointer state_changed_cb_user_data_ = nullptr;
 static rtObjectRef xcastSystemObj = nullptr;
 
 class rtDialCastRemoteObject : public rtCastRemoteObject
@@ -63,7 +68,13 @@ public:
         AppObj.get("state",state);
         AppObj.get("error",error);
         printf("AppName : %s\nAppID : %s\nState : %s\nError : %s\n",app.cString(),id.cString(),state.cString(),error.cString());
-        AppCache->UpdateAppStatusCache(rtValue(AppObj));
+        ipc_stats_.state_updates++;
+        AppCache->Update(app.cString(), state.cString(), id.cString(), error.cString());
+        /* events are dispatched on main_context_, so is the callback */
+        rtAppStatus status;
+        if (state_changed_cb_ && AppCache->Lookup(app.cString(), &status)) {
+            state_changed_cb_(app.cString(), status.state, status.error, state_changed_cb_user_data_);
+        }
         return RT_OK;
     }
 
@@ -106,6 +117,7 @@ public:
         AppObj.set("parameters",args);
 
         rtCastError error(RT_OK,CAST_ERROR_NONE);
+        ipc_stats_.notifies++;
         RTCAST_ERROR_RT(error) = notify("onApplicationLaunchRequest",AppObj);
         return error;
     }
@@ -118,6 +130,7 @@ public:
             AppObj.set("applicationId",appID);
 
         rtCastError error(RT_OK,CAST_ERROR_NONE);
+        ipc_stats_.notifies++;
         RTCAST_ERROR_RT(error) = notify("onApplicationHideRequest",AppObj);
         return error;
     }
@@ -130,6 +143,7 @@ public:
             AppObj.set("applicationId",appID);
 
         rtCastError error(RT_OK,CAST_ERROR_NONE);
+        ipc_stats_.notifies++;
         RTCAST_ERROR_RT(error) = notify("onApplicationResumeRequest",AppObj);
         return error;
     }
@@ -142,6 +156,7 @@ public:
             AppObj.set("applicationId",appID);
 
         rtCastError error(RT_OK,CAST_ERROR_NONE);
+        ipc_stats_.notifies++;
         RTCAST_ERROR_RT(error) = notify("onApplicationStopRequest",AppObj);
         return error;
     }
@@ -154,6 +169,7 @@ public:
             AppObj.set("applicationId",appID);
 
         rtCastError error(RT_OK,CAST_ERROR_NONE);
+        ipc_stats_.notifies++;
         RTCAST_ERROR_RT(error) = notify("onApplicationStateRequest",AppObj);
         return error;
     }
@@ -277,7 +293,7 @@ bool rtdial_init(GMainContext *context) {
     err = rtRemoteInit(env);
 
 //cache
-    AppCache = new rtAppStatusCache(env);
+    AppCache = new rtAppStatusCache();
 
     printf("RTDIAL: %s\n",__func__);
 
@@ -324,90 +340,15 @@ void rtdial_term() {
     //delete(DialObj);
 }
 
-/*
- * The maximum DIAL payload accepted per the DIAL 1.6.1 specification.
- */
-#define DIAL_MAX_PAYLOAD (4096)
-
-/*
- * The maximum additionalDataUrl length
- */
-
-#define DIAL_MAX_ADDITIONALURL (1024)
-
-
-int gdial_os_application_start(const char *app_name, const char *payload, const char *query_string, const char *additional_data_url, int *instance_id) {
-    printf("RTDIAL gdial_os_application_start : Application launch request: appName: %s  query: [%s], payload: [%s], additionalDataUrl [%s]\n",
-        app_name, query_string, payload, additional_data_url);
-
-    char url[DIAL_MAX_PAYLOAD+DIAL_MAX_ADDITIONALURL+100] = {0,};
-    if(strcmp(app_name,"YouTube") == 0) {
-        if ((payload != NULL) && (additional_data_url != NULL)){
-            sprintf( url, "https://www.youtube.com/tv?%s&additionalDataUrl=%s", payload, additional_data_url);
-        }else if (payload != NULL){
-            sprintf( url, "https://www.youtube.com/tv?%s", payload);
-        }else{
-            sprintf( url, "https://www.youtube.com/tv");
-        }
-    }
-
-    else if(strcmp(app_name,"Netflix") == 0) {
-        memset( url, 0, sizeof(url) );
-        strcat( url, "source_type=12" );
-        if(payload != NULL)
-        {
-            const char * pUrlEncodedParams;
-            pUrlEncodedParams = payload;
-            if( pUrlEncodedParams ){
-                strcat( url, "&dial=");
-                strcat( url, pUrlEncodedParams );
-            }
-        }
-
-        if(additional_data_url != NULL){
-            strcat(url, "&additionalDataUrl=");
-            strcat(url, additional_data_url);
-        }
-    }
-    else {
-        int url_len = sizeof(url);
-        {
-            memset( url, 0, url_len );
-            url_len -= DIAL_MAX_ADDITIONALURL+1; //save for &additionalDataUrl
-            url_len -= 1; //save for nul byte
-            printf("query_string=[%s]\r\n", query_string);
-            int has_query = query_string && strlen(query_string);
-            int has_payload = 0;
-            if (has_query) {
-                strcat(url, query_string);
-                url_len -= strlen(query_string);
-            }
-            if(payload && strlen(payload)) {
-                if (has_query) url_len -=1;  //for &
-                const char payload_key[] = "dialpayload=";
-                url_len -= sizeof(payload_key) - 1;
-                url_len -= strlen(payload);
-                if(url_len >= 0){
-                    if (has_query) strcat(url, "&");
-                    strcat(url, payload_key);
-                    strcat(url, payload);
-                    has_payload = 1;
-        }
-                else {
-                    printf("there is no enough room for payload\r\n");
-                }
-            }
-
-        if(additional_data_url != NULL){
-                if (has_query || has_payload) strcat(url, "&");
-                strcat(url, "additionalDataUrl=");
-            strcat(url, additional_data_url);
-            }
-            printf("url is [%s]\r\n", url);
-        }
-    }
+int gdial_os_application_start(const char *app_name, GDialLaunchRequest *launch_request, int *instance_id) {
+    /* a resume comes without a request, launch with the bare template */
+    if (launch_request) gdial_launch_request_ref(launch_request);
+    else launch_request = gdial_launch_request_new(gdial_launch_template_lookup(app_name), NULL, NULL, NULL);
+    printf("RTDIAL gdial_os_application_start : Application launch request: appName: %s  url: [%s]\n",
+        app_name, gdial_launch_request_get_string(launch_request));
 
-    rtCastError ret = DialObj->launchApplication(app_name,url);
+    rtCastError ret = DialObj->launchApplication(app_name,gdial_launch_request_get_string(launch_request));
+    gdial_launch_request_unref(launch_request);
     if (RTCAST_ERROR_RT(ret) != RT_OK) {
         printf("RTDIAL: DialObj.launchApplication failed!!! Error=%s\n",rtStrError(RTCAST_ERROR_RT(ret)));
         return GDIAL_APP_ERROR_INTERNAL;
@@ -417,10 +358,7 @@ int gdial_os_application_start(const char *app_name, const char *payload, const
 
 int gdial_os_application_stop(const char *app_name, int instance_id) {
     printf("RTDIAL gdial_os_application_stop: appName = %s appID = %s\n",app_name,std::to_string(instance_id).c_str());
-    std::string State = AppCache->SearchAppStatusInCache(app_name);
     /* always to issue stop request to have a failsafe strategy */
-    if (0 && State != "running")
-        return GDIAL_APP_ERROR_BAD_REQUEST;
     rtCastError ret = DialObj->stopApplication(app_name,std::to_string(instance_id).c_str());
 
     if (RTCAST_ERROR_RT(ret) != RT_OK) {
@@ -433,11 +371,7 @@ int gdial_os_application_stop(const char *app_name, int instance_id) {
 int gdial_os_application_hide(const char *app_name, int instance_id) {
     #if 0
     printf("RTDIAL gdial_os_application_hide-->stop: appName = %s appID = %s\n",app_name,std::to_string(instance_id).c_str());
-    std::string State = AppCache->SearchAppStatusInCache(app_name);
     /* always to issue hide request to have a failsafe strategy */
-    if (0 && State != "running") {
-        return GDIAL_APP_ERROR_BAD_REQUEST;
-    }
     rtCastError ret = DialObj->stopApplication(app_name,std::to_string(instance_id).c_str());
     if (RTCAST_ERROR_RT(ret) != RT_OK) {
         printf("RTDIAL: DialObj.stopApplication failed!!! Error=%s\n",rtStrError(RTCAST_ERROR_RT(ret)));
@@ -446,8 +380,8 @@ int gdial_os_application_hide(const char *app_name, int instance_id) {
     return GDIAL_APP_ERROR_NONE;
     #else
     printf("RTDIAL gdial_os_application_hide: appName = %s appID = %s\n",app_name,std::to_string(instance_id).c_str());
-    std::string State = AppCache->SearchAppStatusInCache(app_name);
-    if (State != "running")
+    rtAppStatus status;
+    if (!AppCache->Lookup(app_name, &status) || status.state != GDIAL_APP_STATE_RUNNING)
         return GDIAL_APP_ERROR_BAD_REQUEST;
     rtCastError ret = DialObj->hideApplication(app_name,std::to_string(instance_id).c_str());
     if (RTCAST_ERROR_RT(ret) != RT_OK) {
@@ -460,8 +394,8 @@ int gdial_os_application_hide(const char *app_name, int instance_id) {
 
 int gdial_os_application_resume(const char *app_name, int instance_id) {
     printf("RTDIAL gdial_os_application_resume: appName = %s appID = %s\n",app_name,std::to_string(instance_id).c_str());
-     std::string State = AppCache->SearchAppStatusInCache(app_name);
-    if (State == "running")
+    rtAppStatus status;
+    if (AppCache->Lookup(app_name, &status) && status.state == GDIAL_APP_STATE_RUNNING)
         return GDIAL_APP_ERROR_BAD_REQUEST;
     rtCastError ret = DialObj->resumeApplication(app_name,std::to_string(instance_id).c_str());
     if (RTCAST_ERROR_RT(ret) != RT_OK) {
@@ -473,12 +407,16 @@ int gdial_os_application_resume(const char *app_name, int instance_id) {
 
 int gdial_os_application_state(const char *app_name, int instance_id, GDialAppState *state) {
     printf("RTDIAL gdial_os_application_state: App = %s \n",app_name);
-    std::string State = AppCache->SearchAppStatusInCache(app_name);
-    printf("RTDIAL getApplicationState: AppState = %s \n",State.c_str());
+    rtAppStatus status;
+    bool found = AppCache->Lookup(app_name, &status);
     /*
-     *  return cache, but also trigger a refresh
+     *  return cache, the applicationStateChanged events keep it current; only
+     *  ask for a refresh once the entry is stale (or was evicted) and no
+     *  refresh is outstanding
      */
-    if(true || State == "NOT_FOUND") {
+    ipc_stats_.state_queries++;
+    if(AppCache->RefreshNeeded(app_name, found ? app_state_staleness_ : std::chrono::milliseconds(0))) {
+        ipc_stats_.state_refreshes++;
         rtCastError ret = DialObj->getApplicationState(app_name,NULL);
         if (RTCAST_ERROR_RT(ret) != RT_OK) {
             printf("RTDIAL: DialObj.getApplicationState failed!!! Error: %s\n",rtStrError(RTCAST_ERROR_RT(ret)));
@@ -486,19 +424,24 @@ int gdial_os_application_state(const char *app_name, int instance_id, GDialAppSt
         }
     }
 
-    if (State == "running") {
-        *state = GDIAL_APP_STATE_RUNNING;
-    }
-    else if (State == "suspended") {
-        *state = GDIAL_APP_STATE_HIDE;
-    }
-    else {
-        *state = GDIAL_APP_STATE_STOPPED;
-    }
+    *state = found ? status.state : GDIAL_APP_STATE_STOPPED;
 
     return GDIAL_APP_ERROR_NONE;
 }
 
+void gdial_os_application_set_state_staleness(unsigned int staleness_ms) {
+    app_state_staleness_ = std::chrono::milliseconds(staleness_ms);
+}
+
+void gdial_os_get_ipc_stats(GDialPlatIpcStats *stats) {
+    *stats = ipc_stats_;
+}
+
+void gdial_os_application_set_state_changed_cb(gdial_plat_application_state_changed_cb cb, gpointer user_data) {
+    state_changed_cb_ = cb;
+    state_changed_cb_user_data_ = user_data;
+}
+
 int gdial_os_system_app(GHashTable *query) {
     g_log(nullptr, G_LOG_LEVEL_INFO, "RTDIAL gdial_os_system_app\n");
     if (xcastSystemObj) {
@@ -509,6 +452,7 @@ int gdial_os_system_app(GHashTable *query) {
                 params_.set(static_cast<gchar*>(key),static_cast<gchar*>(value));
             }, &params);
         }
+        ipc_stats_.notifies++;
         rtError err = xcastSystemObj.send("systemRequest", params);
         return err == RT_OK ? GDIAL_APP_ERROR_NONE : GDIAL_APP_ERROR_INTERNAL;
     }
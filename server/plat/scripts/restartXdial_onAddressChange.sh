@@ -58,8 +58,7 @@ restartXdialService() {
     if [ "$IsXdialRunning" == "active" ];then
       printf "Interface $3 IP details obtained : \n $curr_ip_addr \n" >> $LOG_FILE
       printf "xdial service is running \n" >> $LOG_FILE
-      printf "Restarting xdial service to take new interface IP \n" >> $LOG_FILE
-      systemctl restart xdial
+      printf "xdial follows the new interface IP in process, no restart \n" >> $LOG_FILE
     else
       printf "Interface $3 IP details obtained : \n $curr_ip_addr \n" >> $LOG_FILE
       printf "xdial service is not  running \n" >> $LOG_FILE
@@ -0,0 +1,233 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * gdial-alloc-count: counts heap allocations on the request paths, by
+ * interposing malloc and friends in this executable. Counting is per
+ * thread and only inside the measured sections.
+ *
+ * The launch path, from the POST body to the IPC send of the fake platform
+ * (gdial-fake-os.c), must take a single allocation: the launch request.
+ *
+ * The REST requests are counted from the moment soup has read them until
+ * their handler returns, which takes in soup's own path and query parsing.
+ * Those counts depend on the soup version and are only reported; a plain
+ * GET must not create the message arena.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <glib.h>
+#include <libsoup/soup.h>
+
+#include "gdial-config.h"
+#include "gdial-app.h"
+#include "gdial-rest.h"
+#include "gdial-launch.h"
+#include "gdial-plat-app.h"
+
+#define ALLOC_COUNT_LAUNCH_ALLOCATIONS 1
+#define ALLOC_COUNT_APP_NAME "AllocCountApp"
+#define ALLOC_COUNT_ANSWER_TIMEOUT_MS 2000
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+static __thread gboolean counting_ = FALSE;
+static __thread guint64 allocations_ = 0;
+
+void *malloc(size_t size) {
+  if (counting_) allocations_++;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  if (counting_) allocations_++;
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  /* a resize is as much of a trip to the allocator as a new block */
+  if (counting_) allocations_++;
+  return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+  if (counting_) allocations_++;
+  return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+  *ptr = memalign(alignment, size);
+  return *ptr ? 0 : ENOMEM;
+}
+
+void free(void *ptr) {
+  __libc_free(ptr);
+}
+
+static void alloc_count_begin() {
+  allocations_ = 0;
+  counting_ = TRUE;
+}
+
+static guint64 alloc_count_end() {
+  counting_ = FALSE;
+  return allocations_;
+}
+
+static void alloc_count_launch_once(const gchar *app_name, const gchar *body, const gchar *query, const gchar *additional_data_url) {
+  GDialLaunchPayload payload;
+  gint instance_id = GDIAL_APP_INSTANCE_NONE;
+  gdial_launch_payload_init(&payload, body, strlen(body));
+  GDialLaunchRequest *launch_request = gdial_launch_request_new(gdial_launch_template_lookup(app_name), &payload, query, additional_data_url);
+  gdial_plat_application_start(app_name, launch_request, &instance_id);
+  gdial_launch_request_unref(launch_request);
+}
+
+static gboolean alloc_count_launch() {
+  /* the built-in templates and the generic one */
+  const gchar *app_names[] = {"YouTube", "Netflix", "AllocCountApp"};
+  const gchar *body = "v=dQw4w9WgXcQ&t=42&list=a b/c";
+  const gchar *query = "friendlyName=Living%20Room";
+  const gchar *additional_data_url = "http://127.0.0.1:56889/apps/AllocCountApp/dial_data";
+  gboolean ok = TRUE;
+  for (guint i = 0; i < G_N_ELEMENTS(app_names); i++) {
+    /* the first launch sets up the template registry */
+    alloc_count_launch_once(app_names[i], body, query, additional_data_url);
+    alloc_count_begin();
+    alloc_count_launch_once(app_names[i], body, query, additional_data_url);
+    const guint64 allocations = alloc_count_end();
+    g_print("launch %s: %" G_GUINT64_FORMAT " allocations\r\n", app_names[i], allocations);
+    ok = ok && allocations == ALLOC_COUNT_LAUNCH_ALLOCATIONS;
+  }
+  return ok;
+}
+
+typedef struct {
+  gboolean counted;
+  guint64 allocations;
+  gboolean arena;
+  gboolean answered;
+  guint status;
+} AllocCountRequest;
+
+static SoupSession *session_ = NULL;
+static guint port_ = 0;
+
+static void alloc_count_request_read_cb(SoupServer *server, SoupMessage *msg, SoupClientContext *client, gpointer user_data) {
+  alloc_count_begin();
+}
+
+static void alloc_count_got_body_cb(SoupMessage *msg, gpointer user_data) {
+  AllocCountRequest *request = (AllocCountRequest *)user_data;
+  request->allocations = alloc_count_end();
+  request->arena = g_object_get_qdata(G_OBJECT(msg), g_quark_try_string("gdial-arena")) != NULL;
+  request->counted = TRUE;
+}
+
+static void alloc_count_request_started_cb(SoupServer *server, SoupMessage *msg, SoupClientContext *client, gpointer user_data) {
+  /* connected after the server's own got-body handler, which runs the request handler */
+  g_signal_connect(msg, "got-body", G_CALLBACK(alloc_count_got_body_cb), user_data);
+}
+
+static void alloc_count_response_cb(SoupSession *session, SoupMessage *msg, gpointer user_data) {
+  AllocCountRequest *request = (AllocCountRequest *)user_data;
+  request->status = msg->status_code;
+  request->answered = TRUE;
+}
+
+static gboolean alloc_count_request(AllocCountRequest *request, const gchar *method) {
+  gchar *url = g_strdup_printf("http://127.0.0.1:%u%s/%s", port_, GDIAL_REST_HTTP_APPS_URI, ALLOC_COUNT_APP_NAME);
+  SoupMessage *msg = soup_message_new(method, url);
+  if (method == SOUP_METHOD_POST) {
+    soup_message_set_request(msg, "text/plain; charset=utf-8", SOUP_MEMORY_STATIC, "v=1&t=42", 8);
+  }
+  memset(request, 0, sizeof(*request));
+  soup_session_queue_message(session_, msg, alloc_count_response_cb, request);
+  g_free(url);
+  const gint64 deadline_us = g_get_monotonic_time() + ALLOC_COUNT_ANSWER_TIMEOUT_MS * 1000;
+  while (!request->answered && g_get_monotonic_time() < deadline_us) {
+    if (!g_main_context_iteration(NULL, FALSE)) g_usleep(1000);
+  }
+  return request->answered && request->counted;
+}
+
+static gboolean alloc_count_rest() {
+  GError *error = NULL;
+  SoupServer *rest_http_server = soup_server_new(NULL, NULL);
+  SoupServer *local_rest_http_server = soup_server_new(NULL, NULL);
+  GDialRestServer *rest_server = gdial_rest_server_new(rest_http_server, local_rest_http_server);
+  /* not a singleton, so that every POST launches, with an additionalDataUrl */
+  gdial_rest_server_register_app(rest_server, ALLOC_COUNT_APP_NAME, NULL, FALSE, TRUE, NULL);
+  if (!soup_server_listen_local(rest_http_server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error)) {
+    g_printerr("listen: %s\r\n", error->message);
+    g_error_free(error);
+    return FALSE;
+  }
+  GSList *uris = soup_server_get_uris(rest_http_server);
+  port_ = soup_uri_get_port((SoupURI *)uris->data);
+  g_slist_free_full(uris, (GDestroyNotify)soup_uri_free);
+  session_ = soup_session_new();
+
+  AllocCountRequest request;
+  g_signal_connect(rest_http_server, "request-started", G_CALLBACK(alloc_count_request_started_cb), &request);
+  g_signal_connect(rest_http_server, "request-read", G_CALLBACK(alloc_count_request_read_cb), NULL);
+
+  gboolean ok = TRUE;
+  const gchar *methods[] = {SOUP_METHOD_GET, SOUP_METHOD_POST};
+  for (guint i = 0; i < G_N_ELEMENTS(methods); i++) {
+    /* the first request of each kind fills the caches */
+    alloc_count_request(&request, methods[i]);
+    if (!alloc_count_request(&request, methods[i])) {
+      g_printerr("%s %s/%s not answered\r\n", methods[i], GDIAL_REST_HTTP_APPS_URI, ALLOC_COUNT_APP_NAME);
+      ok = FALSE;
+      continue;
+    }
+    g_print("%s %s/%s: %u, %" G_GUINT64_FORMAT " allocations%s\r\n", methods[i], GDIAL_REST_HTTP_APPS_URI, ALLOC_COUNT_APP_NAME,
+            request.status, request.allocations, request.arena ? " (arena)" : "");
+    if (methods[i] == SOUP_METHOD_GET && request.arena) {
+      g_printerr("GET created the message arena\r\n");
+      ok = FALSE;
+    }
+  }
+
+  soup_session_abort(session_);
+  g_object_unref(session_);
+  soup_server_disconnect(rest_http_server);
+  g_object_unref(rest_server);
+  g_object_unref(rest_http_server);
+  g_object_unref(local_rest_http_server);
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  gboolean ok = alloc_count_launch();
+  ok = alloc_count_rest() && ok;
+  g_print("%s\r\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
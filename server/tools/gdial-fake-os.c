@@ -0,0 +1,124 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glib.h>
+
+#include "gdial-config.h"
+#include "gdial-os-app.h"
+#include "rtdial.hpp"
+#include "gdial-fake-os.h"
+
+static GHashTable *app_states_ = NULL;
+static GDialAppError start_error_ = GDIAL_APP_ERROR_NONE;
+static guint start_count_ = 0;
+static gint next_instance_id_ = 0xFA000000;
+static GDialPlatIpcStats ipc_stats_ = {0};
+static gdial_plat_application_state_changed_cb state_changed_cb_ = NULL;
+static gpointer state_changed_cb_user_data_ = NULL;
+
+static GDialAppState fake_os_lookup_state(const gchar *app_name) {
+  gpointer state = NULL;
+  if (app_states_ && g_hash_table_lookup_extended(app_states_, app_name, NULL, &state)) {
+    return (GDialAppState)GPOINTER_TO_INT(state);
+  }
+  return GDIAL_APP_STATE_STOPPED;
+}
+
+void gdial_fake_os_set_start_error(GDialAppError error) {
+  start_error_ = error;
+}
+
+void gdial_fake_os_set_state(const gchar *app_name, GDialAppState state) {
+  g_return_if_fail(app_states_ != NULL);
+  g_hash_table_insert(app_states_, g_strdup(app_name), GINT_TO_POINTER(state));
+}
+
+void gdial_fake_os_push_state(const gchar *app_name, GDialAppState state, GDialAppError error) {
+  gdial_fake_os_set_state(app_name, state);
+  ipc_stats_.state_updates++;
+  if (state_changed_cb_) state_changed_cb_(app_name, state, error, state_changed_cb_user_data_);
+}
+
+guint gdial_fake_os_get_start_count(void) {
+  return start_count_;
+}
+
+bool rtdial_init(GMainContext *context) {
+  if (app_states_ == NULL) {
+    app_states_ = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  }
+  return true;
+}
+
+void rtdial_term() {
+  g_clear_pointer(&app_states_, g_hash_table_destroy);
+}
+
+void rtdial_register_activation_cb(rtdial_activation_cb cb) {
+}
+
+void rtdial_register_friendly_name_cb(rtdial_friendlyname_cb cb) {
+}
+
+int gdial_os_application_start(const char *app_name, GDialLaunchRequest *launch_request, int *instance_id) {
+  ipc_stats_.notifies++;
+  start_count_++;
+  if (start_error_ != GDIAL_APP_ERROR_NONE) return start_error_;
+  /* a resumed instance keeps its id */
+  if (*instance_id == GDIAL_APP_INSTANCE_NONE) *instance_id = next_instance_id_++;
+  return GDIAL_APP_ERROR_NONE;
+}
+
+int gdial_os_application_hide(const char *app_name, int instance_id) {
+  ipc_stats_.notifies++;
+  return GDIAL_APP_ERROR_NONE;
+}
+
+int gdial_os_application_resume(const char *app_name, int instance_id) {
+  ipc_stats_.notifies++;
+  return GDIAL_APP_ERROR_NONE;
+}
+
+int gdial_os_application_stop(const char *app_name, int instance_id) {
+  ipc_stats_.notifies++;
+  return GDIAL_APP_ERROR_NONE;
+}
+
+int gdial_os_application_state(const char *app_name, int instance_id, GDialAppState *state) {
+  ipc_stats_.state_queries++;
+  *state = fake_os_lookup_state(app_name);
+  return GDIAL_APP_ERROR_NONE;
+}
+
+int gdial_os_system_app(GHashTable *query) {
+  ipc_stats_.notifies++;
+  return GDIAL_APP_ERROR_NONE;
+}
+
+void gdial_os_application_set_state_staleness(unsigned int staleness_ms) {
+}
+
+void gdial_os_get_ipc_stats(GDialPlatIpcStats *stats) {
+  *stats = ipc_stats_;
+}
+
+void gdial_os_application_set_state_changed_cb(gdial_plat_application_state_changed_cb cb, gpointer user_data) {
+  state_changed_cb_ = cb;
+  state_changed_cb_user_data_ = user_data;
+}
@@ -0,0 +1,48 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GDIAL_FAKE_OS_H_
+#define GDIAL_FAKE_OS_H_
+
+#include <glib.h>
+#include "gdial-app.h"
+
+G_BEGIN_DECLS
+
+/*
+ * In-process stand-in for the rtRemote platform layer (rtdial.cpp), linked
+ * with gdial-plat-app.c by the tools that drive the server code without a
+ * device. Launch, hide, resume and stop succeed (or fail with the start
+ * error set) without changing any state; states only change when the tool
+ * pushes them, the way applicationStateChanged events do.
+ */
+void gdial_fake_os_set_start_error(GDialAppError error);
+/*
+ * Record @state for @app_name and report it through the state changed
+ * callback along with @error, on the calling thread.
+ */
+void gdial_fake_os_push_state(const gchar *app_name, GDialAppState state, GDialAppError error);
+/*
+ * Record @state without reporting it.
+ */
+void gdial_fake_os_set_state(const gchar *app_name, GDialAppState state);
+guint gdial_fake_os_get_start_count(void);
+
+G_END_DECLS
+#endif
@@ -0,0 +1,125 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * gdial-rest-router-bench: cost of routing a REST path with
+ * gdial_rest_server_route_path() against the g_strsplit() parse the /apps
+ * callbacks used before it (split, copy the elements to fixed buffers, then
+ * compare the copies with the split to catch truncation). Both are first
+ * checked to agree on the app name and the number of elements.
+ *
+ *   gdial-rest-router-bench [iterations]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "gdial-config.h"
+#include "gdial-rest.h"
+
+#define BENCH_ITERATIONS_DEFAULT 2000000
+
+static const gchar *bench_paths_[] = {
+  "/apps/Netflix",
+  "/apps/YouTube/run",
+  "/apps/Netflix/dial_data",
+  "/apps/YouTube/run/hide",
+  "/apps//YouTube//run",
+};
+
+/*
+ * the old parse, less its logging: returns the number of non-empty
+ * elements, or -1 when a copy was truncated
+ */
+static int bench_split_path(const gchar *path, gchar app_name[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN]) {
+  gchar **elements = g_strsplit(&path[1], "/", 4);
+  gchar base[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN] = {0};
+  gchar instance[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN] = {0};
+  gchar last_elem[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN] = {0};
+  int i, j = 0;
+  app_name[0] = '\0';
+  for (i = 0; elements[i] != NULL; i++) {
+    if (strlen(elements[i]) == 0) continue;
+    if (j == 0) g_strlcpy(base, elements[i], GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN);
+    else if (j == 1) g_strlcpy(app_name, elements[i], GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN);
+    else if (j == 2) g_strlcpy(instance, elements[i], GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN);
+    g_strlcpy(last_elem, elements[i], GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN);
+    j++;
+  }
+  const int element_num = j;
+  const gchar *copied_str[] = {base, app_name, instance, last_elem};
+  gboolean invalid_uri = FALSE;
+  i = 0; j = 0;
+  while (i < element_num && i < (int)G_N_ELEMENTS(copied_str)) {
+    if (strlen(elements[j]) == 0) {
+      j++;
+      continue;
+    }
+    invalid_uri = invalid_uri || g_strcmp0(copied_str[i], elements[j]);
+    j++; i++;
+  }
+  g_strfreev(elements);
+  return invalid_uri ? -1 : element_num;
+}
+
+static int bench_route_elements(const GDialRestRoute *route) {
+  switch (route->type) {
+    case GDIAL_REST_ROUTE_APP: return 2;
+    case GDIAL_REST_ROUTE_APP_INSTANCE:
+    case GDIAL_REST_ROUTE_APP_DIAL_DATA: return 3;
+    case GDIAL_REST_ROUTE_APP_HIDE: return 4;
+    default: return -1;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const long iterations = argc > 1 ? atol(argv[1]) : BENCH_ITERATIONS_DEFAULT;
+  if (iterations <= 0) {
+    g_printerr("usage: %s [iterations]\r\n", argv[0]);
+    return 1;
+  }
+  int status = 0;
+  long sink = 0;
+  for (guint p = 0; p < G_N_ELEMENTS(bench_paths_); p++) {
+    const gchar *path = bench_paths_[p];
+    GDialRestRoute route;
+    gchar app_name[GDIAL_REST_HTTP_PATH_COMPONENT_MAX_LEN];
+    if (!gdial_rest_server_route_path(path, &route) || bench_route_elements(&route) != bench_split_path(path, app_name) ||
+        g_strcmp0(route.app_name, app_name) != 0) {
+      g_printerr("%s: router and g_strsplit disagree\r\n", path);
+      status = 1;
+      continue;
+    }
+
+    gint64 start = g_get_monotonic_time();
+    for (long i = 0; i < iterations; i++) {
+      sink += gdial_rest_server_route_path(path, &route);
+    }
+    gint64 routed = g_get_monotonic_time();
+    for (long i = 0; i < iterations; i++) {
+      sink += bench_split_path(path, app_name);
+    }
+    gint64 split = g_get_monotonic_time();
+    g_print("%-24s router %6.1f ns, g_strsplit %6.1f ns\r\n", path,
+            (routed - start) * 1000.0 / iterations, (split - routed) * 1000.0 / iterations);
+  }
+  /* keeps the results alive */
+  return sink == 0 ? 1 : status;
+}
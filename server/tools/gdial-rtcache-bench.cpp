@@ -0,0 +1,124 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * gdial-rtcache-bench: cost of rtAppStatusCache lookups, with and without
+ * a writer updating the table at the same time.
+ *
+ *   gdial-rtcache-bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "rtcache.hpp"
+
+#define BENCH_ITERATIONS_DEFAULT 10000000
+#define BENCH_READERS 4
+
+static char bench_names_[GDIAL_APP_STATUS_CACHE_SLOTS][32];
+
+static double bench_ns_per_op(std::chrono::steady_clock::time_point start, long iterations)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+static void bench_fill(rtAppStatusCache &cache, int apps)
+{
+    for (int i = 0; i < apps; i++)
+        cache.Update(bench_names_[i], "running", "1234", "none");
+}
+
+static double bench_lookup(const rtAppStatusCache &cache, const char *app_name, long iterations, long *hits)
+{
+    rtAppStatus status;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++)
+        *hits += cache.Lookup(app_name, &status);
+    return bench_ns_per_op(start, iterations);
+}
+
+int main(int argc, char *argv[])
+{
+    const long iterations = argc > 1 ? atol(argv[1]) : BENCH_ITERATIONS_DEFAULT;
+    if (iterations <= 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+    for (int i = 0; i < GDIAL_APP_STATUS_CACHE_SLOTS; i++)
+        snprintf(bench_names_[i], sizeof(bench_names_[i]), "BenchApplication%02d", i);
+    long hits = 0;
+
+    const int table_sizes[] = {2, GDIAL_APP_STATUS_CACHE_SLOTS / 2, GDIAL_APP_STATUS_CACHE_SLOTS};
+    for (int apps : table_sizes) {
+        rtAppStatusCache cache;
+        bench_fill(cache, apps);
+        /* the last app probes furthest on a collision */
+        printf("lookup hit,  %2d apps: %6.1f ns\n", apps, bench_lookup(cache, bench_names_[apps - 1], iterations, &hits));
+        printf("lookup miss, %2d apps: %6.1f ns\n", apps, bench_lookup(cache, "NotAnApplication", iterations, &hits));
+    }
+
+    {
+        rtAppStatusCache cache;
+        bench_fill(cache, 2);
+        auto start = std::chrono::steady_clock::now();
+        long refreshes = 0;
+        for (long i = 0; i < iterations; i++)
+            refreshes += cache.RefreshNeeded(bench_names_[i & 1], std::chrono::milliseconds(60000));
+        printf("refresh check, fresh entry: %6.1f ns (%ld refreshes)\n", bench_ns_per_op(start, iterations), refreshes);
+    }
+
+    {
+        /* readers on other threads while the main context thread keeps updating */
+        rtAppStatusCache cache;
+        bench_fill(cache, GDIAL_APP_STATUS_CACHE_SLOTS / 2);
+        std::atomic<bool> stop(false);
+        long updates = 0;
+        std::thread writer([&]() {
+            const char *states[] = {"running", "suspended"};
+            while (!stop.load(std::memory_order_relaxed)) {
+                cache.Update(bench_names_[updates % (GDIAL_APP_STATUS_CACHE_SLOTS / 2)], states[updates & 1], "1234", "none");
+                updates++;
+            }
+        });
+        std::vector<std::thread> readers;
+        std::vector<double> reader_ns(BENCH_READERS);
+        std::vector<long> reader_hits(BENCH_READERS);
+        for (int r = 0; r < BENCH_READERS; r++) {
+            readers.emplace_back([&, r]() {
+                reader_ns[r] = bench_lookup(cache, bench_names_[r], iterations, &reader_hits[r]);
+            });
+        }
+        double worst = 0;
+        for (int r = 0; r < BENCH_READERS; r++) {
+            readers[r].join();
+            worst = reader_ns[r] > worst ? reader_ns[r] : worst;
+            hits += reader_hits[r];
+        }
+        stop.store(true);
+        writer.join();
+        printf("lookup hit, %d readers and a writer: %6.1f ns worst reader (%ld updates)\n", BENCH_READERS, worst, updates);
+    }
+
+    /* keeps the lookups from being optimized away */
+    return hits == 0;
+}
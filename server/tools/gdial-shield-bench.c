@@ -0,0 +1,216 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * gdial-shield-bench: cost of the shield's per-request bookkeeping under a
+ * burst. Times the timing wheel against one GSource per timer, the way the
+ * shield used to arm its read timeouts, for arming and cancelling and for
+ * firing, then sends bursts of concurrent requests to a loopback SoupServer
+ * with and without a shield (throttle off) in front of it.
+ *
+ *   gdial-shield-bench [requests per burst, 0 skips the server bursts]
+ */
+
+#include <stdlib.h>
+#include <glib.h>
+#include <libsoup/soup.h>
+
+#include "gdial-config.h"
+#include "gdial-timer.h"
+#include "gdial-shield.h"
+
+#define BENCH_TIMER_OPS (4 * 1024 * 1024)
+#define BENCH_FIRE_MS 20
+#define BENCH_REQUESTS_DEFAULT 256
+#define BENCH_BURSTS 4
+
+static const guint bench_timer_counts_[] = {64, 1024, 16384};
+
+static guint fired_ = 0;
+static gint64 fire_due_us_ = 0;
+static gint64 fire_late_us_ = 0;
+
+static void bench_timer_noop(GDialTimer *timer, gpointer user_data) {
+}
+
+static gboolean bench_source_noop(gpointer user_data) {
+  return G_SOURCE_REMOVE;
+}
+
+static void bench_timer_fired(GDialTimer *timer, gpointer user_data) {
+  fired_++;
+  fire_late_us_ += g_get_monotonic_time() - fire_due_us_;
+}
+
+static gboolean bench_source_fired(gpointer user_data) {
+  fired_++;
+  fire_late_us_ += g_get_monotonic_time() - fire_due_us_;
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * requests answered well before their read timeout: every timer is armed,
+ * then cancelled
+ */
+static double bench_wheel_arm_cancel(GDialTimer *timers, guint count) {
+  GDialTimerWheel *wheel = gdial_timer_wheel_new(GDIAL_SHIELD_TIMER_TICK_MS, GDIAL_SHIELD_TIMER_SLOTS);
+  const guint rounds = MAX(BENCH_TIMER_OPS / count, 1);
+  gint64 start = g_get_monotonic_time();
+  for (guint r = 0; r < rounds; r++) {
+    for (guint i = 0; i < count; i++) {
+      gdial_timer_schedule(wheel, &timers[i], GDIAL_SHIELD_READ_TIMEOUT_MS, bench_timer_noop, NULL);
+    }
+    for (guint i = 0; i < count; i++) {
+      gdial_timer_cancel(wheel, &timers[i]);
+    }
+  }
+  double ns = (g_get_monotonic_time() - start) * 1000.0 / ((double)rounds * count);
+  gdial_timer_wheel_free(wheel);
+  return ns;
+}
+
+static double bench_source_arm_cancel(guint *sources, guint count) {
+  const guint rounds = MAX(BENCH_TIMER_OPS / count, 1);
+  gint64 start = g_get_monotonic_time();
+  for (guint r = 0; r < rounds; r++) {
+    for (guint i = 0; i < count; i++) {
+      sources[i] = g_timeout_add(GDIAL_SHIELD_READ_TIMEOUT_MS, bench_source_noop, NULL);
+    }
+    for (guint i = 0; i < count; i++) {
+      g_source_remove(sources[i]);
+    }
+  }
+  return (g_get_monotonic_time() - start) * 1000.0 / ((double)rounds * count);
+}
+
+/*
+ * Arms @count timers due together and dispatches until all have fired.
+ */
+static void bench_fire(GDialTimer *timers, guint count, gboolean wheel_timers) {
+  GDialTimerWheel *wheel = wheel_timers ? gdial_timer_wheel_new(GDIAL_SHIELD_TIMER_TICK_MS, GDIAL_SHIELD_TIMER_SLOTS) : NULL;
+  fired_ = 0;
+  fire_late_us_ = 0;
+  fire_due_us_ = g_get_monotonic_time() + BENCH_FIRE_MS * 1000;
+  for (guint i = 0; i < count; i++) {
+    if (wheel) {
+      gdial_timer_schedule(wheel, &timers[i], BENCH_FIRE_MS, bench_timer_fired, NULL);
+    }
+    else {
+      g_timeout_add(BENCH_FIRE_MS, bench_source_fired, NULL);
+    }
+  }
+  while (fired_ < count) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+  gint64 done_us = g_get_monotonic_time();
+  gdial_timer_wheel_free(wheel);
+  g_print("  %s %5u timers: mean %.2f ms late, last at %.2f ms\r\n", wheel ? "wheel  " : "gsource", count,
+          fire_late_us_ / 1000.0 / count, (done_us - fire_due_us_) / 1000.0);
+}
+
+static void bench_handler(SoupServer *server, SoupMessage *msg, const gchar *path, GHashTable *query,
+                          SoupClientContext *client, gpointer user_data) {
+  soup_message_set_status(msg, SOUP_STATUS_OK);
+  soup_message_set_response(msg, "text/plain", SOUP_MEMORY_STATIC, "ok", 2);
+}
+
+static void bench_response_cb(SoupSession *session, SoupMessage *msg, gpointer user_data) {
+  guint *answered = (guint *)user_data;
+  (*answered)++;
+}
+
+/*
+ * Sends @requests GETs at once and dispatches until all are answered.
+ * Returns the wall time per request in us.
+ */
+static double bench_burst(SoupSession *session, const gchar *url, guint requests) {
+  guint answered = 0;
+  gint64 start = g_get_monotonic_time();
+  for (guint i = 0; i < requests; i++) {
+    soup_session_queue_message(session, soup_message_new(SOUP_METHOD_GET, url), bench_response_cb, &answered);
+  }
+  while (answered < requests) {
+    g_main_context_iteration(NULL, TRUE);
+  }
+  return (double)(g_get_monotonic_time() - start) / requests;
+}
+
+static gboolean bench_server(guint requests, gboolean shielded) {
+  GError *error = NULL;
+  SoupServer *server = soup_server_new(NULL, NULL);
+  GDialShield *shield = NULL;
+  if (shielded) {
+    shield = gdial_shield_new("bench");
+    gdial_shield_set_throttle(shield, 0, 0, 0);
+    gdial_shield_server(shield, server);
+  }
+  soup_server_add_handler(server, "/", bench_handler, NULL, NULL);
+  if (!soup_server_listen_local(server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error)) {
+    g_printerr("listen: %s\r\n", error->message);
+    g_error_free(error);
+    return FALSE;
+  }
+  GSList *uris = soup_server_get_uris(server);
+  gchar *url = soup_uri_to_string((SoupURI *)uris->data, FALSE);
+  g_slist_free_full(uris, (GDestroyNotify)soup_uri_free);
+  SoupSession *session = soup_session_new_with_options(SOUP_SESSION_MAX_CONNS, requests,
+    SOUP_SESSION_MAX_CONNS_PER_HOST, requests, NULL);
+
+  /* the first burst opens the connections and, with a shield, fills its context pool */
+  for (guint b = 0; b < BENCH_BURSTS; b++) {
+    g_print("  %s burst %u: %.1f us/request\r\n", shielded ? "shield   " : "no shield", b, bench_burst(session, url, requests));
+  }
+  if (shield) {
+    gdial_shield_dump_stats(shield);
+  }
+
+  soup_session_abort(session);
+  g_object_unref(session);
+  soup_server_disconnect(server);
+  g_object_unref(server);
+  gdial_shield_free(shield);
+  g_free(url);
+  return TRUE;
+}
+
+int main(int argc, char *argv[]) {
+  const guint requests = argc > 1 ? (guint) g_ascii_strtoull(argv[1], NULL, 10) : BENCH_REQUESTS_DEFAULT;
+  const guint max_timers = bench_timer_counts_[G_N_ELEMENTS(bench_timer_counts_) - 1];
+  GDialTimer *timers = g_new0(GDialTimer, max_timers);
+  guint *sources = g_new0(guint, max_timers);
+
+  g_print("arm and cancel, per timer:\r\n");
+  for (guint i = 0; i < G_N_ELEMENTS(bench_timer_counts_); i++) {
+    const guint count = bench_timer_counts_[i];
+    g_print("  %5u pending: wheel %6.1f ns, gsource %6.1f ns\r\n", count,
+            bench_wheel_arm_cancel(timers, count), bench_source_arm_cancel(sources, count));
+  }
+  g_print("fire %u ms after arming:\r\n", BENCH_FIRE_MS);
+  for (guint i = 0; i < G_N_ELEMENTS(bench_timer_counts_); i++) {
+    bench_fire(timers, bench_timer_counts_[i], TRUE);
+    bench_fire(timers, bench_timer_counts_[i], FALSE);
+  }
+  g_free(sources);
+  g_free(timers);
+
+  if (requests == 0) return 0;
+  g_print("bursts of %u concurrent requests:\r\n", requests);
+  if (!bench_server(requests, FALSE) || !bench_server(requests, TRUE)) return 1;
+  return 0;
+}
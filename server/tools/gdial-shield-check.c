@@ -0,0 +1,211 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * gdial-shield-check: slow-header clients against a shielded loopback
+ * SoupServer. Checks that the shield closes a connection that trickles its
+ * header (closed_slow), one whose header outgrows the budget
+ * (closed_oversize), and the oldest half-read connection once the cap is
+ * reached (evicted). Exits non-zero on the first failed check.
+ *
+ * The byte budgets read the kernel's per-socket receive counter, which
+ * needs Linux 4.1 or later.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <glib.h>
+#include <libsoup/soup.h>
+
+#include "gdial-config.h"
+#include "gdial-shield.h"
+
+/* well under GDIAL_SHIELD_MIN_BYTE_RATE */
+#define CHECK_TRICKLE_MS 100
+#define CHECK_CLOSE_TIMEOUT_MS (GDIAL_SHIELD_BYTE_RATE_GRACE_MS + 4 * GDIAL_SHIELD_BUDGET_CHECK_MS)
+#define CHECK_SETTLE_TIMEOUT_MS 1000
+#define CHECK_REQUEST_LINE "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+
+#define check(expr, ...) do { \
+  if (!(expr)) { \
+    g_printerr("FAIL %s:%d %s: ", __FILE__, __LINE__, #expr); \
+    g_printerr(__VA_ARGS__); \
+    g_printerr("\r\n"); \
+    exit(1); \
+  } \
+} while (0)
+
+static GDialShield *shield_ = NULL;
+static GDialShieldStats stats_;
+static guint port_ = 0;
+
+static void check_handler(SoupServer *server, SoupMessage *msg, const gchar *path, GHashTable *query,
+                          SoupClientContext *client, gpointer user_data) {
+  soup_message_set_status(msg, SOUP_STATUS_OK);
+}
+
+static int check_connect(void) {
+  struct sockaddr_in addr;
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  check(fd >= 0, "socket: %s", g_strerror(errno));
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port_);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  check(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0, "connect: %s", g_strerror(errno));
+  return fd;
+}
+
+static gboolean check_send(int fd, const gchar *data, gsize length) {
+  /* the shield may have closed the connection already */
+  return send(fd, data, length, MSG_NOSIGNAL | MSG_DONTWAIT) == (ssize_t)length;
+}
+
+/*
+ * Whether the server has closed @fd: nothing is ever answered on these
+ * connections, so a read that does not block can only see the close.
+ */
+static gboolean check_closed_by_peer(int fd) {
+  gchar buf[256];
+  ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+  return n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+}
+
+/*
+ * Dispatch the default context for up to @timeout_ms, or until @cond holds
+ * on freshly read stats.
+ */
+#define check_dispatch_until(cond, timeout_ms) ({ \
+  const gint64 deadline_us = g_get_monotonic_time() + (gint64)(timeout_ms) * 1000; \
+  gdial_shield_get_stats(shield_, &stats_); \
+  while (!(cond) && g_get_monotonic_time() < deadline_us) { \
+    if (!g_main_context_iteration(NULL, FALSE)) g_usleep(1000); \
+    gdial_shield_get_stats(shield_, &stats_); \
+  } \
+  (cond); \
+})
+
+static void check_dispatch(guint ms) {
+  const gint64 deadline_us = g_get_monotonic_time() + ms * 1000;
+  while (g_get_monotonic_time() < deadline_us) {
+    if (!g_main_context_iteration(NULL, FALSE)) g_usleep(1000);
+  }
+}
+
+/* every connection of the previous check is gone from the shield */
+static void check_settle(void) {
+  check(check_dispatch_until(stats_.half_read == 0, CHECK_SETTLE_TIMEOUT_MS), "%u connections still half-read", stats_.half_read);
+}
+
+static void check_slow(void) {
+  gdial_shield_get_stats(shield_, &stats_);
+  const guint64 closed_slow = stats_.closed_slow;
+  int fd = check_connect();
+  check(check_send(fd, CHECK_REQUEST_LINE, strlen(CHECK_REQUEST_LINE)), "send: %s", g_strerror(errno));
+  const gint64 deadline_us = g_get_monotonic_time() + CHECK_CLOSE_TIMEOUT_MS * 1000;
+  while (stats_.closed_slow == closed_slow && g_get_monotonic_time() < deadline_us) {
+    check_send(fd, "X", 1);
+    check_dispatch(CHECK_TRICKLE_MS);
+    gdial_shield_get_stats(shield_, &stats_);
+  }
+  check(stats_.closed_slow == closed_slow + 1, "closed_slow %" G_GUINT64_FORMAT ", was %" G_GUINT64_FORMAT, stats_.closed_slow, closed_slow);
+  check(stats_.closed_timeout == 0, "closed by the read timeout instead");
+  check_dispatch(CHECK_TRICKLE_MS);
+  check(check_closed_by_peer(fd), "slow connection still open");
+  close(fd);
+  check_settle();
+  g_print("slow: closed_slow=%" G_GUINT64_FORMAT "\r\n", stats_.closed_slow);
+}
+
+static void check_oversize(void) {
+  gdial_shield_get_stats(shield_, &stats_);
+  const guint64 closed_oversize = stats_.closed_oversize;
+  int fd = check_connect();
+  /* fast, but the header never ends */
+  GString *header = g_string_new(CHECK_REQUEST_LINE);
+  while (header->len <= GDIAL_SHIELD_MAX_HEADER_BYTES) {
+    g_string_append(header, "X-Check-Padding: 0123456789abcdef0123456789abcdef\r\n");
+  }
+  check(check_send(fd, header->str, header->len), "send: %s", g_strerror(errno));
+  g_string_free(header, TRUE);
+  check(check_dispatch_until(stats_.closed_oversize == closed_oversize + 1, CHECK_CLOSE_TIMEOUT_MS),
+        "closed_oversize %" G_GUINT64_FORMAT ", was %" G_GUINT64_FORMAT, stats_.closed_oversize, closed_oversize);
+  check_dispatch(CHECK_TRICKLE_MS);
+  check(check_closed_by_peer(fd), "oversize connection still open");
+  close(fd);
+  check_settle();
+  g_print("oversize: closed_oversize=%" G_GUINT64_FORMAT "\r\n", stats_.closed_oversize);
+}
+
+static void check_evict(void) {
+  int fds[GDIAL_SHIELD_MAX_HALF_READ_CONNS + 1];
+  gdial_shield_get_stats(shield_, &stats_);
+  const guint64 evicted = stats_.evicted;
+  for (guint i = 0; i < G_N_ELEMENTS(fds); i++) {
+    /* one at a time, so that the shield sees them oldest first */
+    fds[i] = check_connect();
+    check(check_dispatch_until(stats_.half_read == MIN(i + 1, GDIAL_SHIELD_MAX_HALF_READ_CONNS), CHECK_SETTLE_TIMEOUT_MS),
+          "%u half-read after %u connections", stats_.half_read, i + 1);
+  }
+  check(check_dispatch_until(stats_.evicted == evicted + 1, CHECK_SETTLE_TIMEOUT_MS),
+        "evicted %" G_GUINT64_FORMAT ", was %" G_GUINT64_FORMAT, stats_.evicted, evicted);
+  check(stats_.half_read == GDIAL_SHIELD_MAX_HALF_READ_CONNS, "%u half-read", stats_.half_read);
+  check_dispatch(CHECK_TRICKLE_MS);
+  check(check_closed_by_peer(fds[0]), "oldest connection not evicted");
+  check(!check_closed_by_peer(fds[G_N_ELEMENTS(fds) - 1]), "newest connection closed");
+  for (guint i = 0; i < G_N_ELEMENTS(fds); i++) {
+    close(fds[i]);
+  }
+  check_settle();
+  g_print("evict: evicted=%" G_GUINT64_FORMAT "\r\n", stats_.evicted);
+}
+
+int main(int argc, char *argv[]) {
+  GError *error = NULL;
+  SoupServer *server = soup_server_new(NULL, NULL);
+  shield_ = gdial_shield_new("check");
+  /* one client makes all the connections, the throttle must not get in the way */
+  gdial_shield_set_throttle(shield_, 0, 0, 0);
+  gdial_shield_server(shield_, server);
+  soup_server_add_handler(server, "/", check_handler, NULL, NULL);
+  if (!soup_server_listen_local(server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error)) {
+    g_printerr("listen: %s\r\n", error->message);
+    g_error_free(error);
+    return 1;
+  }
+  GSList *uris = soup_server_get_uris(server);
+  port_ = soup_uri_get_port((SoupURI *)uris->data);
+  g_slist_free_full(uris, (GDestroyNotify)soup_uri_free);
+
+  check_slow();
+  check_oversize();
+  check_evict();
+
+  gdial_shield_dump_stats(shield_);
+  soup_server_disconnect(server);
+  gdial_shield_free(shield_);
+  g_object_unref(server);
+  g_print("PASS\r\n");
+  return 0;
+}
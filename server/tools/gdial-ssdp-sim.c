@@ -0,0 +1,767 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * gdial-ssdp-sim: SSDP discovery load simulator.
+ *
+ * Sends M-SEARCH requests at a configurable rate, ST mix and MX from a
+ * number of source sockets, matches the replies back to their searches and
+ * optionally fetches the dd.xml each reply points to. Results are written as
+ * JSON so that runs against different builds can be compared.
+ *
+ * Loopback:    gdial-ssdp-sim -i 127.0.0.1 --pid $(pidof gdial-server)
+ *              needs a server listening on lo (-I lo, or lo in the -I list):
+ *              with --native-ssdp only searches that arrive through one of
+ *              the server's interfaces are answered.
+ * Unicast:     gdial-ssdp-sim -t 192.168.1.20 ...
+ * Namespaces:  run the server and the simulator in two network namespaces
+ *              joined by a veth pair, e.g. "ip netns exec sim gdial-ssdp-sim -i 10.0.0.2".
+ * REST load:   gdial-ssdp-sim -f -R http://10.0.0.1:56889/apps/YouTube -c 32 ...
+ *              keeps the REST side saturated while searching, run the
+ *              server with -T 0 so that the load is not throttled away.
+ * Replay:      gdial-ssdp-sim -x 10000 -r 2000 --pid $(pidof gdial-server)
+ *              sends multicast traffic that is not for us (NOTIFYs, search
+ *              replies and M-SEARCHes for other devices) instead of searches
+ *              and reports server CPU and wakeups per 10k packets; compare a
+ *              --native-ssdp server with one also run with --no-ssdp-filter.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <glib.h>
+#include <glib-unix.h>
+#include <libsoup/soup.h>
+#include <json-c/json.h>
+
+#include "gdial-config.h"
+
+#define SIM_TICK_MS 5
+#define SIM_REPLY_GRACE_MS 1000
+#define SIM_FETCH_TIMEOUT_S 5
+#define SIM_REPLAY_PER 10000
+
+typedef struct {
+  const gchar *name;
+  const gchar *st;
+} SimTarget;
+
+enum {
+  SIM_TARGET_DIAL,
+  SIM_TARGET_ROOTDEVICE,
+  SIM_TARGET_ALL,
+  SIM_TARGET_OTHER,
+  SIM_TARGET_COUNT
+};
+
+/*
+ * Reply classes beyond the search targets: ssdp:all may also be answered
+ * with the device's own uuid:<uuid> ST, which no search here asks for alone.
+ */
+enum {
+  SIM_REPLY_UUID = SIM_TARGET_COUNT,
+  SIM_REPLY_NONE
+};
+
+static const SimTarget sim_targets_[SIM_TARGET_COUNT] = {
+  {"dial", "urn:dial-multiscreen-org:service:dial:1"},
+  {"rootdevice", "upnp:rootdevice"},
+  {"all", "ssdp:all"},
+  /* nothing should answer this one, replies to it count as unmatched */
+  {"other", "urn:schemas-upnp-org:device:MediaRenderer:1"},
+};
+
+/*
+ * Replayed round robin. Only the M-SEARCH gets past the server's socket
+ * filter, and its ST is not ours so it is never answered either.
+ */
+static const gchar *sim_replay_packets_[] = {
+  "NOTIFY * HTTP/1.1\r\n"
+  "HOST: 239.255.255.250:1900\r\n"
+  "CACHE-CONTROL: max-age=1800\r\n"
+  "LOCATION: http://192.0.2.10:49152/description.xml\r\n"
+  "NT: urn:schemas-upnp-org:device:MediaRenderer:1\r\n"
+  "NTS: ssdp:alive\r\n"
+  "SERVER: Linux/5.10 UPnP/1.0 sim/1.0\r\n"
+  "USN: uuid:2fac1234-31f8-11b4-a222-08002b34c003::urn:schemas-upnp-org:device:MediaRenderer:1\r\n"
+  "\r\n",
+  "NOTIFY * HTTP/1.1\r\n"
+  "HOST: 239.255.255.250:1900\r\n"
+  "CACHE-CONTROL: max-age=1800\r\n"
+  "LOCATION: http://192.0.2.11:1400/xml/device_description.xml\r\n"
+  "NT: upnp:rootdevice\r\n"
+  "NTS: ssdp:alive\r\n"
+  "SERVER: Linux/5.10 UPnP/1.0 sim/1.0\r\n"
+  "USN: uuid:RINCON_000E58000001400::upnp:rootdevice\r\n"
+  "\r\n",
+  "NOTIFY * HTTP/1.1\r\n"
+  "HOST: 239.255.255.250:1900\r\n"
+  "NT: urn:schemas-upnp-org:service:ContentDirectory:1\r\n"
+  "NTS: ssdp:byebye\r\n"
+  "USN: uuid:4d696e69-444c-164e-9d41-b827eb000001::urn:schemas-upnp-org:service:ContentDirectory:1\r\n"
+  "\r\n",
+  "HTTP/1.1 200 OK\r\n"
+  "CACHE-CONTROL: max-age=1800\r\n"
+  "EXT:\r\n"
+  "LOCATION: http://192.0.2.12:8060/\r\n"
+  "SERVER: Roku/9.4.0 UPnP/1.0 Roku/9.4.0\r\n"
+  "ST: roku:ecp\r\n"
+  "USN: uuid:roku:ecp:P0A070000001\r\n"
+  "\r\n",
+  "M-SEARCH * HTTP/1.1\r\n"
+  "HOST: 239.255.255.250:1900\r\n"
+  "MAN: \"ssdp:discover\"\r\n"
+  "MX: 2\r\n"
+  "ST: urn:schemas-upnp-org:device:InternetGatewayDevice:1\r\n"
+  "\r\n",
+};
+
+typedef struct {
+  gint64 sent_us;
+  gint64 first_reply_us;
+  guint8 target;
+  guint8 mx;
+  /* bit per reply class, ssdp:all collects more than one */
+  guint8 replied;
+  guint replies;
+} SimSearch;
+
+typedef struct {
+  int fd;
+  guint watch;
+  /* searches still inside their MX window, oldest first */
+  GQueue pending;
+} SimSource;
+
+typedef struct {
+  gint64 queued_us;
+} SimFetch;
+
+static gchar *target_ = NULL;
+static gint port_ = GDIAL_SSDP_PORT;
+static gchar *interface_address_ = NULL;
+static gchar *source_addresses_ = NULL;
+static gint sources_count_ = 4;
+static gdouble rate_ = 10;
+static gint duration_s_ = 10;
+static gchar *st_mix_ = NULL;
+static gchar *mx_list_ = NULL;
+static gboolean fetch_ = FALSE;
+static gint server_pid_ = 0;
+static gint seed_ = 1;
+static gchar *output_ = NULL;
+static gchar *rest_url_ = NULL;
+static gint rest_connections_ = 16;
+static gint replay_ = 0;
+
+static GOptionEntry option_entries_[] = {
+  {"target", 't', 0, G_OPTION_ARG_STRING, &target_, "Multicast group or unicast server address [" GDIAL_SSDP_MULTICAST_ADDR "]", "ADDR"},
+  {"port", 'p', 0, G_OPTION_ARG_INT, &port_, "SSDP port [1900]", "PORT"},
+  {"interface-address", 'i', 0, G_OPTION_ARG_STRING, &interface_address_, "Local address multicast searches leave from", "ADDR"},
+  {"source-addresses", 'a', 0, G_OPTION_ARG_STRING, &source_addresses_, "Comma separated local addresses the sources bind to, round robin", "ADDRS"},
+  {"sources", 'n', 0, G_OPTION_ARG_INT, &sources_count_, "Number of source sockets (distinct controllers) [4]", "N"},
+  {"rate", 'r', 0, G_OPTION_ARG_DOUBLE, &rate_, "M-SEARCH requests per second over all sources [10]", "RATE"},
+  {"duration", 'd', 0, G_OPTION_ARG_INT, &duration_s_, "Seconds to send for [10]", "S"},
+  {"st-mix", 's', 0, G_OPTION_ARG_STRING, &st_mix_, "Weighted ST mix out of dial, rootdevice, all and other [dial:8,rootdevice:1,all:1]", "MIX"},
+  {"mx", 'm', 0, G_OPTION_ARG_STRING, &mx_list_, "Comma separated MX values picked at random [1,2,3]", "MX"},
+  {"fetch", 'f', 0, G_OPTION_ARG_NONE, &fetch_, "Fetch the LOCATION of every reply and time it", NULL},
+  {"pid", 'P', 0, G_OPTION_ARG_INT, &server_pid_, "Server process to sample CPU time from", "PID"},
+  {"seed", 0, 0, G_OPTION_ARG_INT, &seed_, "Random seed for ST and MX selection [1]", "SEED"},
+  {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output_, "JSON result file [stdout]", "FILE"},
+  {"rest-url", 'R', 0, G_OPTION_ARG_STRING, &rest_url_, "Keep GET requests to this REST URL in flight until the replies are drained", "URL"},
+  {"rest-connections", 'c', 0, G_OPTION_ARG_INT, &rest_connections_, "Requests kept in flight with --rest-url [16]", "N"},
+  {"replay", 'x', 0, G_OPTION_ARG_INT, &replay_, "Replay N packets of unrelated multicast traffic at --rate instead of searching", "N"},
+  {NULL}
+};
+
+static GMainLoop *loop_ = NULL;
+static GRand *rand_ = NULL;
+static struct sockaddr_in target_address_;
+static SimSource *sources_ = NULL;
+static guint next_source_ = 0;
+static guint st_weights_[SIM_TARGET_COUNT] = {0};
+static guint st_weight_total_ = 0;
+static GArray *mx_values_ = NULL;
+static GPtrArray *searches_ = NULL;
+static guint64 sent_ = 0;
+static guint64 send_errors_ = 0;
+static guint64 replies_ = 0;
+static guint64 unmatched_replies_ = 0;
+static gint64 start_us_ = 0;
+static gint64 stop_us_ = 0;
+static gint64 drain_until_us_ = 0;
+static SoupSession *session_ = NULL;
+static GArray *fetch_ms_ = NULL;
+static guint64 fetch_failed_ = 0;
+static guint fetches_in_flight_ = 0;
+/* REST load, on a session of its own so that it does not queue the dd.xml fetches */
+static SoupSession *rest_session_ = NULL;
+static GArray *rest_ms_ = NULL;
+static guint64 rest_http_errors_ = 0;
+static guint64 rest_transport_errors_ = 0;
+static guint rest_in_flight_ = 0;
+
+static gboolean sim_parse_st_mix(const gchar *mix) {
+  gchar **entries = g_strsplit(mix, ",", -1);
+  gboolean ok = TRUE;
+  for (gchar **entry = entries; *entry && ok; entry++) {
+    gchar **pair = g_strsplit(*entry, ":", 2);
+    ok = FALSE;
+    for (int i = 0; i < SIM_TARGET_COUNT && pair[0]; i++) {
+      if (g_strcmp0(pair[0], sim_targets_[i].name) == 0) {
+        st_weights_[i] = pair[1] ? (guint)g_ascii_strtoull(pair[1], NULL, 10) : 1;
+        st_weight_total_ += st_weights_[i];
+        ok = TRUE;
+      }
+    }
+    if (!ok) g_printerr("unknown ST \"%s\" in --st-mix\r\n", *entry);
+    g_strfreev(pair);
+  }
+  g_strfreev(entries);
+  return ok && st_weight_total_ > 0;
+}
+
+static gboolean sim_parse_mx_list(const gchar *list) {
+  gchar **entries = g_strsplit(list, ",", -1);
+  mx_values_ = g_array_new(FALSE, FALSE, sizeof(guint8));
+  for (gchar **entry = entries; *entry; entry++) {
+    guint8 mx = (guint8)CLAMP(g_ascii_strtoull(*entry, NULL, 10), 1, 120);
+    g_array_append_val(mx_values_, mx);
+  }
+  g_strfreev(entries);
+  return mx_values_->len > 0;
+}
+
+static guint sim_pick_target() {
+  guint pick = g_rand_int_range(rand_, 0, st_weight_total_);
+  guint i = 0;
+  while (pick >= st_weights_[i]) {
+    pick -= st_weights_[i++];
+  }
+  return i;
+}
+
+static const gchar *sim_header_value(const gchar *line, const gchar *name, gsize *length) {
+  const gsize name_len = strlen(name);
+  if (g_ascii_strncasecmp(line, name, name_len) != 0 || line[name_len] != ':') return NULL;
+  const gchar *value = line + name_len + 1;
+  while (*value == ' ' || *value == '\t') value++;
+  const gchar *end = strstr(value, "\r\n");
+  *length = end ? (gsize)(end - value) : strlen(value);
+  return value;
+}
+
+static void sim_fetch_callback(SoupSession *session, SoupMessage *msg, gpointer user_data) {
+  SimFetch *fetch = (SimFetch *)user_data;
+  fetches_in_flight_--;
+  if (SOUP_STATUS_IS_SUCCESSFUL(msg->status_code)) {
+    gdouble ms = (g_get_monotonic_time() - fetch->queued_us) / 1000.0;
+    g_array_append_val(fetch_ms_, ms);
+  }
+  else {
+    fetch_failed_++;
+  }
+  g_free(fetch);
+}
+
+static void sim_fetch(const gchar *location) {
+  SoupMessage *msg = soup_message_new(SOUP_METHOD_GET, location);
+  if (msg == NULL) {
+    fetch_failed_++;
+    return;
+  }
+  SimFetch *fetch = g_new(SimFetch, 1);
+  fetch->queued_us = g_get_monotonic_time();
+  fetches_in_flight_++;
+  soup_session_queue_message(session_, msg, sim_fetch_callback, fetch);
+}
+
+static void sim_rest_request();
+
+static void sim_rest_callback(SoupSession *session, SoupMessage *msg, gpointer user_data) {
+  SimFetch *request = (SimFetch *)user_data;
+  rest_in_flight_--;
+  if (SOUP_STATUS_IS_TRANSPORT_ERROR(msg->status_code)) {
+    rest_transport_errors_++;
+  }
+  else {
+    /* any answer is REST work done, latency is taken over all of them */
+    gdouble ms = (g_get_monotonic_time() - request->queued_us) / 1000.0;
+    g_array_append_val(rest_ms_, ms);
+    if (!SOUP_STATUS_IS_SUCCESSFUL(msg->status_code)) rest_http_errors_++;
+  }
+  g_free(request);
+  /* the load lasts as long as replies may still arrive */
+  if (g_get_monotonic_time() < drain_until_us_) sim_rest_request();
+}
+
+static void sim_rest_request() {
+  SimFetch *request = g_new(SimFetch, 1);
+  request->queued_us = g_get_monotonic_time();
+  rest_in_flight_++;
+  soup_session_queue_message(rest_session_, soup_message_new(SOUP_METHOD_GET, rest_url_), sim_rest_callback, request);
+}
+
+static void sim_expire_pending(SimSource *source, gint64 now_us) {
+  SimSearch *search;
+  while ((search = g_queue_peek_head(&source->pending)) != NULL &&
+         now_us - search->sent_us > search->mx * G_USEC_PER_SEC + SIM_REPLY_GRACE_MS * 1000) {
+    g_queue_pop_head(&source->pending);
+  }
+}
+
+static void sim_handle_reply(SimSource *source, const gchar *reply, gint64 now_us) {
+  if (!g_str_has_prefix(reply, "HTTP/1.1 200")) return;
+  replies_++;
+
+  gchar *st = NULL;
+  gchar *location = NULL;
+  for (const gchar *line = strstr(reply, "\r\n"); line && line[2]; line = strstr(line + 2, "\r\n")) {
+    gsize length = 0;
+    const gchar *value;
+    if ((value = sim_header_value(line + 2, "ST", &length)) != NULL) st = g_strndup(value, length);
+    else if ((value = sim_header_value(line + 2, "LOCATION", &length)) != NULL) location = g_strndup(value, length);
+  }
+
+  guint target = SIM_REPLY_NONE;
+  for (guint i = 0; st && i < SIM_TARGET_COUNT; i++) {
+    if (strcmp(st, sim_targets_[i].st) == 0) target = i;
+  }
+  if (target == SIM_REPLY_NONE && st && g_str_has_prefix(st, "uuid:")) target = SIM_REPLY_UUID;
+
+  /*
+   * replies carry no request id; credit the oldest pending search on this
+   * socket that asked for the reply's ST, or for ssdp:all
+   */
+  SimSearch *matched = NULL;
+  sim_expire_pending(source, now_us);
+  for (GList *link = source->pending.head; link && target != SIM_REPLY_NONE && !matched; link = link->next) {
+    SimSearch *search = link->data;
+    if (search->replied & (1 << target)) continue;
+    if (search->target == target || (search->target == SIM_TARGET_ALL && target != SIM_TARGET_OTHER)) {
+      matched = search;
+    }
+  }
+  if (matched) {
+    matched->replied |= (1 << target);
+    if (matched->replies++ == 0) matched->first_reply_us = now_us;
+    if (fetch_ && location) sim_fetch(location);
+  }
+  else {
+    unmatched_replies_++;
+  }
+  g_free(st);
+  g_free(location);
+}
+
+static gboolean sim_source_recv_cb(gint fd, GIOCondition condition, gpointer user_data) {
+  SimSource *source = (SimSource *)user_data;
+  gchar buffer[GDIAL_SSDP_MAX_DATAGRAM_SIZE + 1];
+  ssize_t length;
+  while ((length = recv(fd, buffer, sizeof(buffer) - 1, MSG_DONTWAIT)) >= 0) {
+    buffer[length] = '\0';
+    sim_handle_reply(source, buffer, g_get_monotonic_time());
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+static void sim_send_search(gint64 now_us) {
+  SimSource *source = &sources_[next_source_++ % sources_count_];
+  SimSearch *search = g_new0(SimSearch, 1);
+  search->target = sim_pick_target();
+  search->mx = g_array_index(mx_values_, guint8, g_rand_int_range(rand_, 0, mx_values_->len));
+
+  gchar *request = g_strdup_printf("M-SEARCH * HTTP/1.1\r\n"
+    "HOST: %s:%d\r\n"
+    "MAN: \"ssdp:discover\"\r\n"
+    "MX: %u\r\n"
+    "ST: %s\r\n"
+    "USER-AGENT: gdial-ssdp-sim/1.0\r\n"
+    "\r\n", target_, port_, search->mx, sim_targets_[search->target].st);
+  search->sent_us = now_us;
+  if (sendto(source->fd, request, strlen(request), 0, (struct sockaddr *)&target_address_, sizeof(target_address_)) < 0) {
+    send_errors_++;
+    g_free(search);
+  }
+  else {
+    sent_++;
+    g_ptr_array_add(searches_, search);
+    g_queue_push_tail(&source->pending, search);
+  }
+  g_free(request);
+}
+
+static void sim_send_replay() {
+  SimSource *source = &sources_[next_source_++ % sources_count_];
+  const gchar *packet = sim_replay_packets_[(sent_ + send_errors_) % G_N_ELEMENTS(sim_replay_packets_)];
+  if (sendto(source->fd, packet, strlen(packet), 0, (struct sockaddr *)&target_address_, sizeof(target_address_)) < 0) {
+    send_errors_++;
+  }
+  else {
+    sent_++;
+  }
+}
+
+static gboolean sim_tick_cb(gpointer user_data) {
+  const gint64 now_us = g_get_monotonic_time();
+  if (replay_) {
+    if (sent_ + send_errors_ < (guint64)replay_) {
+      const guint64 due = MIN((guint64)((now_us - start_us_) * rate_ / G_USEC_PER_SEC), (guint64)replay_);
+      while (sent_ + send_errors_ < due) {
+        sim_send_replay();
+      }
+      /* let the server catch up with its socket before the CPU is read */
+      if (sent_ + send_errors_ == (guint64)replay_) drain_until_us_ = now_us + SIM_REPLY_GRACE_MS * 1000;
+      return G_SOURCE_CONTINUE;
+    }
+  }
+  else if (now_us < stop_us_) {
+    /* keep the average rate exact whatever the tick jitter */
+    const guint64 due = (guint64)((now_us - start_us_) * rate_ / G_USEC_PER_SEC);
+    while (sent_ + send_errors_ < due) {
+      sim_send_search(now_us);
+    }
+    return G_SOURCE_CONTINUE;
+  }
+  if (now_us < drain_until_us_ || ((fetches_in_flight_ || rest_in_flight_) && now_us < drain_until_us_ + SIM_FETCH_TIMEOUT_S * G_USEC_PER_SEC)) {
+    return G_SOURCE_CONTINUE;
+  }
+  g_main_loop_quit(loop_);
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean sim_sources_open() {
+  gchar **addresses = source_addresses_ ? g_strsplit(source_addresses_, ",", -1) : NULL;
+  const guint address_count = addresses ? g_strv_length(addresses) : 0;
+  sources_ = g_new0(SimSource, sources_count_);
+  for (int i = 0; i < sources_count_; i++) {
+    SimSource *source = &sources_[i];
+    g_queue_init(&source->pending);
+    source->fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in local = {0};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (address_count && inet_pton(AF_INET, addresses[i % address_count], &local.sin_addr) != 1) {
+      g_printerr("invalid source address %s\r\n", addresses[i % address_count]);
+      g_strfreev(addresses);
+      return FALSE;
+    }
+    if (source->fd < 0 || bind(source->fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+      g_printerr("source %d: %s\r\n", i, g_strerror(errno));
+      g_strfreev(addresses);
+      return FALSE;
+    }
+    int ttl = GDIAL_SSDP_MULTICAST_TTL;
+    setsockopt(source->fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    if (interface_address_) {
+      struct in_addr interface = {0};
+      inet_pton(AF_INET, interface_address_, &interface);
+      setsockopt(source->fd, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface));
+    }
+    source->watch = g_unix_fd_add(source->fd, G_IO_IN, sim_source_recv_cb, source);
+  }
+  g_strfreev(addresses);
+  return TRUE;
+}
+
+static gboolean sim_read_cpu_ticks(gint pid, guint64 *user, guint64 *system) {
+  gchar *path = g_strdup_printf("/proc/%d/stat", pid);
+  gchar *stat = NULL;
+  gboolean ok = g_file_get_contents(path, &stat, NULL, NULL);
+  g_free(path);
+  /* the command may contain spaces, fields are counted from its closing paren */
+  const gchar *fields = ok ? strrchr(stat, ')') : NULL;
+  ok = fields && sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT, user, system) == 2;
+  g_free(stat);
+  return ok;
+}
+
+/*
+ * Voluntary context switches over all threads: a thread blocked in poll()
+ * counts one every time it goes back to sleep after being woken up.
+ */
+static gboolean sim_read_wakeups(gint pid, guint64 *wakeups) {
+  gchar *path = g_strdup_printf("/proc/%d/task", pid);
+  GDir *tasks = g_dir_open(path, 0, NULL);
+  g_free(path);
+  if (tasks == NULL) return FALSE;
+  const gchar *task;
+  *wakeups = 0;
+  while ((task = g_dir_read_name(tasks)) != NULL) {
+    gchar *status = NULL;
+    path = g_strdup_printf("/proc/%d/task/%s/status", pid, task);
+    /* a thread that exited in between just does not count */
+    if (g_file_get_contents(path, &status, NULL, NULL)) {
+      const gchar *field = strstr(status, "\nvoluntary_ctxt_switches:");
+      if (field) *wakeups += g_ascii_strtoull(field + strlen("\nvoluntary_ctxt_switches:"), NULL, 10);
+    }
+    g_free(status);
+    g_free(path);
+  }
+  g_dir_close(tasks);
+  return TRUE;
+}
+
+static int sim_compare_double(gconstpointer a, gconstpointer b) {
+  const gdouble x = *(const gdouble *)a, y = *(const gdouble *)b;
+  return (x > y) - (x < y);
+}
+
+static struct json_object *sim_percentiles_new(GArray *values) {
+  /* nearest rank on sorted samples */
+  struct json_object *result = json_object_new_object();
+  g_array_sort(values, sim_compare_double);
+  const guint percentiles[] = {50, 90, 99};
+  const gchar *names[] = {"p50", "p90", "p99"};
+  gdouble sum = 0;
+  for (guint i = 0; i < values->len; i++) sum += g_array_index(values, gdouble, i);
+  for (guint i = 0; i < G_N_ELEMENTS(percentiles); i++) {
+    gdouble value = 0;
+    if (values->len) {
+      guint rank = (percentiles[i] * values->len + 99) / 100;
+      value = g_array_index(values, gdouble, CLAMP(rank, 1, values->len) - 1);
+    }
+    json_object_object_add(result, names[i], json_object_new_double(value));
+  }
+  json_object_object_add(result, "max", json_object_new_double(values->len ? g_array_index(values, gdouble, values->len - 1) : 0));
+  json_object_object_add(result, "mean", json_object_new_double(values->len ? sum / values->len : 0));
+  json_object_object_add(result, "samples", json_object_new_int64(values->len));
+  return result;
+}
+
+static gboolean sim_search_complete(const SimSearch *search) {
+  if (search->target == SIM_TARGET_OTHER) return search->replies == 0;
+  /* for ssdp:all the DIAL service reply is the one controllers need */
+  const guint target = search->target == SIM_TARGET_ALL ? SIM_TARGET_DIAL : search->target;
+  return (search->replied & (1 << target)) != 0;
+}
+
+static void sim_searches_result_add(struct json_object *result) {
+  GArray *latency_ms = g_array_new(FALSE, FALSE, sizeof(gdouble));
+  GArray *target_latency_ms[SIM_TARGET_COUNT];
+  guint64 target_sent[SIM_TARGET_COUNT] = {0}, target_complete[SIM_TARGET_COUNT] = {0};
+  guint64 answered = 0, complete = 0;
+  for (int t = 0; t < SIM_TARGET_COUNT; t++) target_latency_ms[t] = g_array_new(FALSE, FALSE, sizeof(gdouble));
+  for (guint i = 0; i < searches_->len; i++) {
+    const SimSearch *search = g_ptr_array_index(searches_, i);
+    target_sent[search->target]++;
+    if (sim_search_complete(search)) {
+      complete++;
+      target_complete[search->target]++;
+    }
+    if (search->replies) {
+      gdouble ms = (search->first_reply_us - search->sent_us) / 1000.0;
+      answered++;
+      g_array_append_val(latency_ms, ms);
+      g_array_append_val(target_latency_ms[search->target], ms);
+    }
+  }
+
+  struct json_object *searches = json_object_new_object();
+  json_object_object_add(searches, "sent", json_object_new_int64(sent_));
+  json_object_object_add(searches, "send_errors", json_object_new_int64(send_errors_));
+  json_object_object_add(searches, "answered", json_object_new_int64(answered));
+  json_object_object_add(searches, "complete", json_object_new_int64(complete));
+  json_object_object_add(searches, "completeness", json_object_new_double(sent_ ? (gdouble)complete / sent_ : 0));
+  json_object_object_add(searches, "replies", json_object_new_int64(replies_));
+  json_object_object_add(searches, "unmatched_replies", json_object_new_int64(unmatched_replies_));
+  json_object_object_add(result, "searches", searches);
+  json_object_object_add(result, "reply_latency_ms", sim_percentiles_new(latency_ms));
+
+  struct json_object *by_st = json_object_new_object();
+  for (int t = 0; t < SIM_TARGET_COUNT; t++) {
+    if (target_sent[t] == 0) continue;
+    struct json_object *st = json_object_new_object();
+    json_object_object_add(st, "sent", json_object_new_int64(target_sent[t]));
+    json_object_object_add(st, "complete", json_object_new_int64(target_complete[t]));
+    json_object_object_add(st, "latency_ms", sim_percentiles_new(target_latency_ms[t]));
+    json_object_object_add(by_st, sim_targets_[t].name, st);
+  }
+  json_object_object_add(result, "by_st", by_st);
+
+  if (fetch_) {
+    struct json_object *dd_xml = sim_percentiles_new(fetch_ms_);
+    json_object_object_add(dd_xml, "failed", json_object_new_int64(fetch_failed_));
+    json_object_object_add(result, "dd_xml_fetch_ms", dd_xml);
+  }
+
+  g_array_free(latency_ms, TRUE);
+  for (int t = 0; t < SIM_TARGET_COUNT; t++) g_array_free(target_latency_ms[t], TRUE);
+}
+
+static struct json_object *sim_result_new(gdouble cpu_ms, guint64 wakeups, gboolean cpu_valid, gdouble wall_s) {
+  struct json_object *result = json_object_new_object();
+
+  struct json_object *config = json_object_new_object();
+  json_object_object_add(config, "target", json_object_new_string(target_));
+  json_object_object_add(config, "port", json_object_new_int(port_));
+  json_object_object_add(config, "sources", json_object_new_int(sources_count_));
+  json_object_object_add(config, "rate", json_object_new_double(rate_));
+  if (replay_) {
+    json_object_object_add(config, "replay", json_object_new_int(replay_));
+  }
+  else {
+    json_object_object_add(config, "duration_s", json_object_new_int(duration_s_));
+    json_object_object_add(config, "st_mix", json_object_new_string(st_mix_));
+    json_object_object_add(config, "mx", json_object_new_string(mx_list_));
+    json_object_object_add(config, "fetch", json_object_new_boolean(fetch_));
+    json_object_object_add(config, "seed", json_object_new_int(seed_));
+  }
+  if (rest_url_) {
+    json_object_object_add(config, "rest_url", json_object_new_string(rest_url_));
+    json_object_object_add(config, "rest_connections", json_object_new_int(rest_connections_));
+  }
+  json_object_object_add(result, "config", config);
+
+  if (replay_) {
+    struct json_object *replay = json_object_new_object();
+    json_object_object_add(replay, "sent", json_object_new_int64(sent_));
+    json_object_object_add(replay, "send_errors", json_object_new_int64(send_errors_));
+    json_object_object_add(result, "replay", replay);
+  }
+  else {
+    sim_searches_result_add(result);
+  }
+  if (rest_url_) {
+    struct json_object *rest = json_object_new_object();
+    json_object_object_add(rest, "answered", json_object_new_int64(rest_ms_->len));
+    json_object_object_add(rest, "per_second", json_object_new_double(rest_ms_->len / wall_s));
+    json_object_object_add(rest, "http_errors", json_object_new_int64(rest_http_errors_));
+    json_object_object_add(rest, "transport_errors", json_object_new_int64(rest_transport_errors_));
+    json_object_object_add(rest, "latency_ms", sim_percentiles_new(rest_ms_));
+    json_object_object_add(result, "rest_load", rest);
+  }
+  if (cpu_valid) {
+    struct json_object *cpu = json_object_new_object();
+    json_object_object_add(cpu, "pid", json_object_new_int(server_pid_));
+    json_object_object_add(cpu, "percent", json_object_new_double(cpu_ms / 10.0 / wall_s));
+    json_object_object_add(cpu, "wakeups", json_object_new_int64(wakeups));
+    if (replay_ && sent_) {
+      json_object_object_add(cpu, "ms_per_10k", json_object_new_double(cpu_ms * SIM_REPLAY_PER / sent_));
+      json_object_object_add(cpu, "wakeups_per_10k", json_object_new_double((gdouble)wakeups * SIM_REPLAY_PER / sent_));
+    }
+    json_object_object_add(result, "server_cpu", cpu);
+  }
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  GError *error = NULL;
+  GOptionContext *option_context = g_option_context_new("- SSDP discovery load simulator");
+  g_option_context_add_main_entries(option_context, option_entries_, NULL);
+  if (!g_option_context_parse(option_context, &argc, &argv, &error)) {
+    g_printerr("%s\r\n", error->message);
+    g_error_free(error);
+    return EXIT_FAILURE;
+  }
+  g_option_context_free(option_context);
+
+  if (!target_) target_ = g_strdup(GDIAL_SSDP_MULTICAST_ADDR);
+  if (!st_mix_) st_mix_ = g_strdup("dial:8,rootdevice:1,all:1");
+  if (!mx_list_) mx_list_ = g_strdup("1,2,3");
+  if (!sim_parse_st_mix(st_mix_) || !sim_parse_mx_list(mx_list_) || sources_count_ <= 0 || rate_ <= 0 || duration_s_ <= 0 ||
+      (rest_url_ && rest_connections_ <= 0) || replay_ < 0 || (replay_ && fetch_)) {
+    g_printerr("invalid arguments\r\n");
+    return EXIT_FAILURE;
+  }
+  target_address_.sin_family = AF_INET;
+  target_address_.sin_port = htons(port_);
+  if (inet_pton(AF_INET, target_, &target_address_.sin_addr) != 1) {
+    g_printerr("invalid target address %s\r\n", target_);
+    return EXIT_FAILURE;
+  }
+
+  rand_ = g_rand_new_with_seed(seed_);
+  searches_ = g_ptr_array_new_with_free_func(g_free);
+  fetch_ms_ = g_array_new(FALSE, FALSE, sizeof(gdouble));
+  rest_ms_ = g_array_new(FALSE, FALSE, sizeof(gdouble));
+  if (rest_url_) {
+    SoupURI *rest_uri = soup_uri_new(rest_url_);
+    if (rest_uri == NULL || !SOUP_URI_VALID_FOR_HTTP(rest_uri)) {
+      g_printerr("invalid REST URL %s\r\n", rest_url_);
+      return EXIT_FAILURE;
+    }
+    soup_uri_free(rest_uri);
+    rest_session_ = soup_session_new_with_options(SOUP_SESSION_TIMEOUT, SIM_FETCH_TIMEOUT_S,
+      SOUP_SESSION_MAX_CONNS, rest_connections_, SOUP_SESSION_MAX_CONNS_PER_HOST, rest_connections_, NULL);
+  }
+  if (fetch_) {
+    session_ = soup_session_new_with_options(SOUP_SESSION_TIMEOUT, SIM_FETCH_TIMEOUT_S, NULL);
+  }
+  if (!sim_sources_open()) {
+    return EXIT_FAILURE;
+  }
+
+  guint mx_max = 0;
+  for (guint i = 0; i < mx_values_->len; i++) mx_max = MAX(mx_max, g_array_index(mx_values_, guint8, i));
+  guint64 user_start = 0, system_start = 0, user_end = 0, system_end = 0, wakeups_start = 0, wakeups_end = 0;
+  gboolean cpu_valid = server_pid_ > 0 && sim_read_cpu_ticks(server_pid_, &user_start, &system_start) &&
+    sim_read_wakeups(server_pid_, &wakeups_start);
+
+  loop_ = g_main_loop_new(NULL, FALSE);
+  start_us_ = g_get_monotonic_time();
+  stop_us_ = start_us_ + duration_s_ * G_USEC_PER_SEC;
+  /* a replay sets its own once the last packet is out */
+  drain_until_us_ = replay_ ? G_MAXINT64 : stop_us_ + mx_max * G_USEC_PER_SEC + SIM_REPLY_GRACE_MS * 1000;
+  for (int i = 0; rest_url_ && i < rest_connections_; i++) {
+    sim_rest_request();
+  }
+  g_timeout_add(SIM_TICK_MS, sim_tick_cb, NULL);
+  g_main_loop_run(loop_);
+
+  /* the drain period is included, replies are sent in it */
+  const gdouble wall_s = (g_get_monotonic_time() - start_us_) / (gdouble)G_USEC_PER_SEC;
+  cpu_valid = cpu_valid && sim_read_cpu_ticks(server_pid_, &user_end, &system_end) && sim_read_wakeups(server_pid_, &wakeups_end);
+  const gdouble cpu_ms = cpu_valid ?
+    1000.0 * ((user_end + system_end) - (user_start + system_start)) / sysconf(_SC_CLK_TCK) : 0;
+
+  struct json_object *result = sim_result_new(cpu_ms, wakeups_end - wakeups_start, cpu_valid, wall_s);
+  const char *json = json_object_to_json_string_ext(result, JSON_C_TO_STRING_PRETTY);
+  if (output_) {
+    if (!g_file_set_contents(output_, json, -1, &error)) {
+      g_printerr("%s\r\n", error->message);
+      g_error_free(error);
+    }
+  }
+  else {
+    printf("%s\n", json);
+  }
+  json_object_put(result);
+
+  for (int i = 0; i < sources_count_; i++) {
+    g_source_remove(sources_[i].watch);
+    g_queue_clear(&sources_[i].pending);
+    close(sources_[i].fd);
+  }
+  g_free(sources_);
+  if (session_) g_object_unref(session_);
+  if (rest_session_) g_object_unref(rest_session_);
+  g_ptr_array_free(searches_, TRUE);
+  g_array_free(fetch_ms_, TRUE);
+  g_array_free(rest_ms_, TRUE);
+  g_array_free(mx_values_, TRUE);
+  g_rand_free(rand_);
+  g_main_loop_unref(loop_);
+  return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * gdial-state-wait-check: runs the REST server against the fake platform
+ * (gdial-fake-os.c) and checks how launch requests held for a state wait
+ * are answered: when the platform confirms the state, when it reports an
+ * error, and when the wait budget runs out. Exits non-zero on the first
+ * failed check.
+ */
+
+#include <stdlib.h>
+#include <glib.h>
+#include <libsoup/soup.h>
+
+#include "gdial-config.h"
+#include "gdial-app.h"
+#include "gdial-rest.h"
+#include "gdial-fake-os.h"
+
+#define CHECK_APP_NAME "StateWaitCheck"
+#define CHECK_STATE_WAIT_MS 200
+/* long enough for the server to have answered a request it does not hold */
+#define CHECK_HELD_MS 50
+#define CHECK_ANSWER_TIMEOUT_MS 2000
+
+#define check(expr, ...) do { \
+  if (!(expr)) { \
+    g_printerr("FAIL %s:%d %s: ", __FILE__, __LINE__, #expr); \
+    g_printerr(__VA_ARGS__); \
+    g_printerr("\r\n"); \
+    exit(1); \
+  } \
+} while (0)
+
+typedef struct {
+  gboolean answered;
+  guint status;
+  gint64 sent_us;
+  gint64 answered_us;
+} CheckResponse;
+
+static SoupSession *session_ = NULL;
+static guint port_ = 0;
+
+static void check_response_cb(SoupSession *session, SoupMessage *msg, gpointer user_data) {
+  CheckResponse *response = (CheckResponse *)user_data;
+  response->answered = TRUE;
+  response->status = msg->status_code;
+  response->answered_us = g_get_monotonic_time();
+}
+
+static void check_post_launch(CheckResponse *response) {
+  gchar *url = g_strdup_printf("http://127.0.0.1:%u%s/%s", port_, GDIAL_REST_HTTP_APPS_URI, CHECK_APP_NAME);
+  SoupMessage *msg = soup_message_new(SOUP_METHOD_POST, url);
+  /* the same payload every time, so that a running singleton is resumed rather than relaunched */
+  soup_message_set_request(msg, "text/plain; charset=utf-8", SOUP_MEMORY_STATIC, "v=1", 3);
+  response->answered = FALSE;
+  response->status = SOUP_STATUS_NONE;
+  response->sent_us = g_get_monotonic_time();
+  soup_session_queue_message(session_, msg, check_response_cb, response);
+  g_free(url);
+}
+
+/*
+ * Dispatch the default context until @response is answered or @timeout_ms
+ * have passed. Returns whether it was answered.
+ */
+static gboolean check_wait_answer(const CheckResponse *response, guint timeout_ms) {
+  const gint64 deadline_us = g_get_monotonic_time() + (gint64)timeout_ms * 1000;
+  while (!response->answered && g_get_monotonic_time() < deadline_us) {
+    if (!g_main_context_iteration(NULL, FALSE)) g_usleep(1000);
+  }
+  return response->answered;
+}
+
+static void check_confirm(void) {
+  CheckResponse response;
+  gdial_fake_os_set_state(CHECK_APP_NAME, GDIAL_APP_STATE_STOPPED);
+  check_post_launch(&response);
+  check(!check_wait_answer(&response, CHECK_HELD_MS), "launch answered with %u before the platform confirmed it", response.status);
+  gdial_fake_os_push_state(CHECK_APP_NAME, GDIAL_APP_STATE_RUNNING, GDIAL_APP_ERROR_NONE);
+  check(check_wait_answer(&response, CHECK_ANSWER_TIMEOUT_MS), "launch not answered once confirmed");
+  check(response.status == SOUP_STATUS_CREATED, "status %u", response.status);
+  check(response.answered_us - response.sent_us < CHECK_STATE_WAIT_MS * 1000, "answered by the timeout, not the confirmation");
+  g_print("confirm: %u after %" G_GINT64_FORMAT " ms\r\n", response.status, (response.answered_us - response.sent_us) / 1000);
+}
+
+static void check_error(void) {
+  CheckResponse response;
+  gdial_fake_os_set_state(CHECK_APP_NAME, GDIAL_APP_STATE_STOPPED);
+  check_post_launch(&response);
+  check(!check_wait_answer(&response, CHECK_HELD_MS), "launch answered with %u before the platform reported", response.status);
+  gdial_fake_os_push_state(CHECK_APP_NAME, GDIAL_APP_STATE_STOPPED, GDIAL_APP_ERROR_FORBIDDEN);
+  check(check_wait_answer(&response, CHECK_ANSWER_TIMEOUT_MS), "launch not answered once failed");
+  check(response.status == SOUP_STATUS_FORBIDDEN, "status %u", response.status);
+  /* the new instance belonged to the failed request */
+  check(gdial_app_find_instance_by_name(CHECK_APP_NAME) == NULL, "failed instance still registered");
+  g_print("error: %u after %" G_GINT64_FORMAT " ms\r\n", response.status, (response.answered_us - response.sent_us) / 1000);
+}
+
+static void check_timeout(void) {
+  CheckResponse response;
+  gdial_fake_os_set_state(CHECK_APP_NAME, GDIAL_APP_STATE_STOPPED);
+  check_post_launch(&response);
+  check(check_wait_answer(&response, CHECK_STATE_WAIT_MS + CHECK_ANSWER_TIMEOUT_MS), "launch not answered after the wait budget");
+  check(response.status == SOUP_STATUS_CREATED, "status %u", response.status);
+  check(response.answered_us - response.sent_us >= CHECK_STATE_WAIT_MS * 1000, "answered before the wait budget ran out");
+  check(gdial_app_find_instance_by_name(CHECK_APP_NAME) != NULL, "timed out instance dropped");
+  g_print("timeout: %u after %" G_GINT64_FORMAT " ms\r\n", response.status, (response.answered_us - response.sent_us) / 1000);
+}
+
+/*
+ * Two launches resuming the hidden singleton left by check_timeout() fail on
+ * the same error. Neither took a reference on the instance, so it must
+ * survive both.
+ */
+static void check_resume_error(void) {
+  CheckResponse responses[2];
+  gdial_fake_os_push_state(CHECK_APP_NAME, GDIAL_APP_STATE_HIDE, GDIAL_APP_ERROR_NONE);
+  GDialApp *app = gdial_app_find_instance_by_name(CHECK_APP_NAME);
+  check(app != NULL, "no instance to resume");
+  g_object_add_weak_pointer(G_OBJECT(app), (gpointer *)&app);
+  const guint starts = gdial_fake_os_get_start_count();
+  for (guint i = 0; i < G_N_ELEMENTS(responses); i++) {
+    check_post_launch(&responses[i]);
+    check(!check_wait_answer(&responses[i], CHECK_HELD_MS), "resume answered with %u before the platform reported", responses[i].status);
+  }
+  check(gdial_fake_os_get_start_count() - starts == G_N_ELEMENTS(responses), "resumes did not reach the platform");
+  check(app != NULL && gdial_app_find_instance_by_name(CHECK_APP_NAME) == app, "resume relaunched the app");
+  gdial_fake_os_push_state(CHECK_APP_NAME, GDIAL_APP_STATE_STOPPED, GDIAL_APP_ERROR_INTERNAL);
+  for (guint i = 0; i < G_N_ELEMENTS(responses); i++) {
+    check(check_wait_answer(&responses[i], CHECK_ANSWER_TIMEOUT_MS), "resume %u not answered once failed", i);
+    check(responses[i].status == SOUP_STATUS_SERVICE_UNAVAILABLE, "resume %u status %u", i, responses[i].status);
+  }
+  check(app != NULL, "failed resumes released the singleton they did not own");
+  g_object_remove_weak_pointer(G_OBJECT(app), (gpointer *)&app);
+  g_print("resume error: %u, %u\r\n", responses[0].status, responses[1].status);
+}
+
+int main(int argc, char *argv[]) {
+  GError *error = NULL;
+  SoupServer *rest_http_server = soup_server_new(NULL, NULL);
+  SoupServer *local_rest_http_server = soup_server_new(NULL, NULL);
+  GDialRestServer *rest_server = gdial_rest_server_new(rest_http_server, local_rest_http_server);
+  gdial_rest_server_register_app(rest_server, CHECK_APP_NAME, NULL, TRUE, FALSE, NULL);
+  gdial_rest_server_set_app_state_wait(rest_server, CHECK_APP_NAME, CHECK_STATE_WAIT_MS);
+  if (!soup_server_listen_local(rest_http_server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error)) {
+    g_printerr("listen: %s\r\n", error->message);
+    g_error_free(error);
+    return 1;
+  }
+  GSList *uris = soup_server_get_uris(rest_http_server);
+  port_ = soup_uri_get_port((SoupURI *)uris->data);
+  g_slist_free_full(uris, (GDestroyNotify)soup_uri_free);
+  session_ = soup_session_new();
+
+  check_confirm();
+  check_error();
+  check_timeout();
+  check_resume_error();
+
+  soup_session_abort(session_);
+  g_object_unref(session_);
+  soup_server_disconnect(rest_http_server);
+  g_object_unref(rest_server);
+  g_object_unref(rest_http_server);
+  g_object_unref(local_rest_http_server);
+  g_print("PASS\r\n");
+  return 0;
+}
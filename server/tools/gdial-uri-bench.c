@@ -0,0 +1,136 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * gdial-uri-bench: cost of validating and URI-encoding a POST body, the
+ * gdial-uri way (one scan, then encoding into an exactly sized buffer)
+ * against the way it used to be done (a byte-wise printable check, then
+ * soup_uri_encode() and a strlen() to learn the size).
+ *
+ * Both sides are first checked to produce the same bytes.
+ *
+ *   gdial-uri-bench [bytes per size]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <glib.h>
+#include <libsoup/soup.h>
+
+#include "gdial-uri.h"
+
+#define BENCH_BYTES_DEFAULT (200 * 1024 * 1024)
+#define BENCH_MAX_PAYLOAD 8192
+/* one '=' every that many bytes in the query style payload */
+#define BENCH_ESCAPE_STRIDE 17
+
+static const gsize bench_sizes_[] = {64, 512, 4096, BENCH_MAX_PAYLOAD};
+
+/*
+ * what gdial_util_is_ascii_printable() did before gdial-uri
+ */
+static gboolean bench_bytewise_is_printable(const gchar *data, gsize length) {
+  while (length--) {
+    if (!g_ascii_isgraph(data[length]) && !g_ascii_isspace(data[length])) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+static gsize bench_gdial(const gchar *data, gsize length) {
+  gsize encoded_length = 0;
+  if (!gdial_uri_scan(data, length, GDIAL_URI_ENCODE_QUERY_VALUE, &encoded_length)) {
+    return 0;
+  }
+  gchar *encoded = g_malloc(encoded_length + 1);
+  *gdial_uri_encode_to(encoded, data, length, GDIAL_URI_ENCODE_QUERY_VALUE) = '\0';
+  g_free(encoded);
+  return encoded_length;
+}
+
+static gsize bench_soup(const gchar *data, gsize length) {
+  if (!bench_bytewise_is_printable(data, length)) {
+    return 0;
+  }
+  gchar *encoded = soup_uri_encode(data, "=&");
+  gsize encoded_length = strlen(encoded);
+  g_free(encoded);
+  return encoded_length;
+}
+
+static gboolean bench_same_encoding(const gchar *data, gsize length) {
+  gsize encoded_length = 0;
+  if (!gdial_uri_scan(data, length, GDIAL_URI_ENCODE_QUERY_VALUE, &encoded_length)) {
+    return FALSE;
+  }
+  gchar *encoded = g_malloc(encoded_length + 1);
+  *gdial_uri_encode_to(encoded, data, length, GDIAL_URI_ENCODE_QUERY_VALUE) = '\0';
+  gchar *expected = soup_uri_encode(data, "=&");
+  gboolean same = g_strcmp0(encoded, expected) == 0 && strlen(expected) == encoded_length;
+  g_free(expected);
+  g_free(encoded);
+  return same;
+}
+
+static double bench_ns_per_byte(gsize (*encode)(const gchar *, gsize), const gchar *data, gsize length, gsize total_bytes, gsize *sink) {
+  const gsize iterations = MAX(total_bytes / length, 1);
+  gint64 start = g_get_monotonic_time();
+  for (gsize i = 0; i < iterations; i++) {
+    *sink += encode(data, length);
+  }
+  return (g_get_monotonic_time() - start) * 1000.0 / ((double)iterations * length);
+}
+
+int main(int argc, char *argv[]) {
+  const gsize total_bytes = argc > 1 ? (gsize) g_ascii_strtoull(argv[1], NULL, 10) : BENCH_BYTES_DEFAULT;
+  if (total_bytes == 0) {
+    g_printerr("usage: %s [bytes per size]\r\n", argv[0]);
+    return 1;
+  }
+
+  static gchar payloads[2][BENCH_MAX_PAYLOAD + 1];
+  static const gchar *payload_names[2] = {"alphanumeric", "query"};
+  for (gsize i = 0; i < BENCH_MAX_PAYLOAD; i++) {
+    payloads[0][i] = "abcdefghijklmnopqrstuvwxyz0123456789"[i % 36];
+    payloads[1][i] = (i % BENCH_ESCAPE_STRIDE == BENCH_ESCAPE_STRIDE - 1) ? '=' : payloads[0][i];
+  }
+
+  int status = 0;
+  gsize sink = 0;
+  for (guint p = 0; p < G_N_ELEMENTS(payloads); p++) {
+    for (guint s = 0; s < G_N_ELEMENTS(bench_sizes_); s++) {
+      const gsize length = bench_sizes_[s];
+      /* soup_uri_encode() wants a C string */
+      gchar *data = g_strndup(payloads[p], length);
+      if (!bench_same_encoding(data, length)) {
+        g_printerr("%s %" G_GSIZE_FORMAT " B: gdial_uri_encode_to and soup_uri_encode differ\r\n", payload_names[p], length);
+        status = 1;
+      }
+      double gdial_ns = bench_ns_per_byte(bench_gdial, data, length, total_bytes, &sink);
+      double soup_ns = bench_ns_per_byte(bench_soup, data, length, total_bytes, &sink);
+      g_print("%-12s %5" G_GSIZE_FORMAT " B: gdial-uri %5.2f ns/B, printable+soup_uri_encode %5.2f ns/B\r\n",
+              payload_names[p], length, gdial_ns, soup_ns);
+      g_free(data);
+    }
+  }
+  /* keeps the results alive */
+  return sink == 0 ? 1 : status;
+}
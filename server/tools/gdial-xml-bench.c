@@ -0,0 +1,133 @@
+/*
+ * If not stated otherwise in this file or this component's Licenses.txt file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2019 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * gdial-xml-bench: cost of building the app state response (the document
+ * gdial_app_state_response_new() writes) with the GDialXmlWriter against
+ * the libxml2 DOM it replaced (xmlNewDoc, xmlNewChild, xmlDocDumpMemory),
+ * with a growing number of dial_data entries. Both are first checked to
+ * produce the same bytes.
+ *
+ *   gdial-xml-bench [iterations]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <libxml/tree.h>
+
+#include "gdial-config.h"
+#include "gdial-xml.h"
+
+#define BENCH_ITERATIONS_DEFAULT 200000
+#define BENCH_MAX_DIAL_DATA 16
+
+static const guint bench_dial_data_counts_[] = {0, 4, BENCH_MAX_DIAL_DATA};
+static gchar bench_keys_[BENCH_MAX_DIAL_DATA][16];
+static gchar bench_values_[BENCH_MAX_DIAL_DATA][32];
+
+static gchar *bench_writer(guint dial_data, int *len) {
+  GDialXmlWriter writer;
+  gdial_xml_writer_init(&writer, GDIAL_APP_STATE_RESPONSE_SIZE_HINT);
+  gdial_xml_writer_start_element(&writer, "service");
+  gdial_xml_writer_attribute(&writer, "xmlns", GDIAL_PROTOCOL_XMLNS_SCHEMA);
+  gdial_xml_writer_attribute(&writer, "dialVer", GDIAL_PROTOCOL_VERSION_STR);
+  gdial_xml_writer_element(&writer, "name", "YouTube");
+  gdial_xml_writer_start_element(&writer, "options");
+  gdial_xml_writer_attribute(&writer, "allowStop", "true");
+  gdial_xml_writer_end_element(&writer);
+  gdial_xml_writer_element(&writer, "state", "running");
+  gdial_xml_writer_start_element(&writer, "link");
+  gdial_xml_writer_attribute(&writer, "rel", "run");
+  gdial_xml_writer_attribute(&writer, "href", "run");
+  gdial_xml_writer_end_element(&writer);
+  gdial_xml_writer_start_element(&writer, "additionalData");
+  for (guint i = 0; i < dial_data; i++) {
+    gdial_xml_writer_element(&writer, bench_keys_[i], bench_values_[i]);
+  }
+  gdial_xml_writer_end_element(&writer);
+  gsize length = 0;
+  gchar *response = gdial_xml_writer_finish(&writer, &length);
+  *len = (int)length;
+  return response;
+}
+
+static gchar *bench_dom(guint dial_data, int *len) {
+  xmlDocPtr xdoc = xmlNewDoc(BAD_CAST "1.0");
+  xmlNodePtr nservice = xmlNewNode(NULL, BAD_CAST "service");
+  xmlDocSetRootElement(xdoc, nservice);
+  xmlNewProp(nservice, BAD_CAST "xmlns", BAD_CAST GDIAL_PROTOCOL_XMLNS_SCHEMA);
+  xmlNewProp(nservice, BAD_CAST "dialVer", BAD_CAST GDIAL_PROTOCOL_VERSION_STR);
+  xmlNewChild(nservice, NULL, BAD_CAST "name", BAD_CAST "YouTube");
+  xmlNodePtr noptions = xmlNewChild(nservice, NULL, BAD_CAST "options", NULL);
+  xmlNewProp(noptions, BAD_CAST "allowStop", BAD_CAST "true");
+  xmlNewChild(nservice, NULL, BAD_CAST "state", BAD_CAST "running");
+  xmlNodePtr nlink = xmlNewChild(nservice, NULL, BAD_CAST "link", NULL);
+  xmlNewProp(nlink, BAD_CAST "rel", BAD_CAST "run");
+  xmlNewProp(nlink, BAD_CAST "href", BAD_CAST "run");
+  xmlNodePtr naddtnl = xmlNewChild(nservice, NULL, BAD_CAST "additionalData", NULL);
+  for (guint i = 0; i < dial_data; i++) {
+    xmlNewChild(naddtnl, NULL, BAD_CAST bench_keys_[i], BAD_CAST bench_values_[i]);
+  }
+  xmlChar *response = NULL;
+  xmlDocDumpMemory(xdoc, &response, len);
+  xmlFreeDoc(xdoc);
+  return (gchar *)response;
+}
+
+int main(int argc, char *argv[]) {
+  const long iterations = argc > 1 ? atol(argv[1]) : BENCH_ITERATIONS_DEFAULT;
+  if (iterations <= 0) {
+    g_printerr("usage: %s [iterations]\r\n", argv[0]);
+    return 1;
+  }
+  for (guint i = 0; i < BENCH_MAX_DIAL_DATA; i++) {
+    g_snprintf(bench_keys_[i], sizeof(bench_keys_[i]), "key%u", i);
+    g_snprintf(bench_values_[i], sizeof(bench_values_[i]), "value%u", i);
+  }
+  xmlInitParser();
+
+  int status = 0;
+  for (guint c = 0; c < G_N_ELEMENTS(bench_dial_data_counts_); c++) {
+    const guint dial_data = bench_dial_data_counts_[c];
+    int writer_len = 0, dom_len = 0;
+    gchar *writer_doc = bench_writer(dial_data, &writer_len);
+    gchar *dom_doc = bench_dom(dial_data, &dom_len);
+    if (writer_len != dom_len || memcmp(writer_doc, dom_doc, writer_len) != 0) {
+      g_printerr("%u dial_data: writer and DOM documents differ\r\n%s\r\n%s\r\n", dial_data, writer_doc, dom_doc);
+      status = 1;
+    }
+    g_free(writer_doc);
+    xmlFree(dom_doc);
+
+    gint64 start = g_get_monotonic_time();
+    for (long i = 0; i < iterations; i++) {
+      g_free(bench_writer(dial_data, &writer_len));
+    }
+    gint64 written = g_get_monotonic_time();
+    for (long i = 0; i < iterations; i++) {
+      xmlFree(bench_dom(dial_data, &dom_len));
+    }
+    gint64 dumped = g_get_monotonic_time();
+    g_print("%2u dial_data, %4d B: writer %7.1f ns, DOM %7.1f ns\r\n", dial_data, writer_len,
+            (written - start) * 1000.0 / iterations, (dumped - written) * 1000.0 / iterations);
+  }
+  xmlCleanupParser();
+  return status;
+}